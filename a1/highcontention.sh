@@ -27,6 +27,26 @@ then
     build/db --contention  --exp_type 1 --max_outstanding 128;   killall db
     echo
 
+    echo '========== ZYGOTE PROCESS PER REQUEST WITH CONTENTION =========='
+    build/db --contention  --exp_type 6 --max_outstanding 1;   killall db
+    build/db --contention  --exp_type 6 --max_outstanding 2;   killall db
+    build/db --contention  --exp_type 6 --max_outstanding 4;   killall db
+    build/db --contention  --exp_type 6 --max_outstanding 8;   killall db
+    build/db --contention  --exp_type 6 --max_outstanding 16;   killall db
+    build/db --contention  --exp_type 6 --max_outstanding 32;   killall db
+    build/db --contention  --exp_type 6 --max_outstanding 64;   killall db
+    build/db --contention  --exp_type 6 --max_outstanding 128;   killall db
+    echo
+
+    echo '========== FIBER PER REQUEST WITH CONTENTION (4 THREADS) =========='
+    build/db --contention  --exp_type 7 --pool_size 4 --max_outstanding 4;   killall db
+    build/db --contention  --exp_type 7 --pool_size 4 --max_outstanding 16;   killall db
+    build/db --contention  --exp_type 7 --pool_size 4 --max_outstanding 64;   killall db
+    build/db --contention  --exp_type 7 --pool_size 4 --max_outstanding 256;   killall db
+    build/db --contention  --exp_type 7 --pool_size 4 --max_outstanding 1024;   killall db
+    build/db --contention  --exp_type 7 --pool_size 4 --max_outstanding 4096;   killall db
+    echo
+
     echo '========== THREAD POOL WITH CONTENTION =========='
     build/db --contention  --exp_type 2 --pool_size 1;   killall db
     build/db --contention  --exp_type 2 --pool_size 2;   killall db
@@ -49,6 +69,28 @@ then
     build/db --contention  --exp_type 3 --max_outstanding 128;   killall db
     echo
 
+    echo '========== THREAD RING POOL WITH CONTENTION =========='
+    build/db --contention  --exp_type 4 --pool_size 1;   killall db
+    build/db --contention  --exp_type 4 --pool_size 2;   killall db
+    build/db --contention  --exp_type 4 --pool_size 4;   killall db
+    build/db --contention  --exp_type 4 --pool_size 8;   killall db
+    build/db --contention  --exp_type 4 --pool_size 16;   killall db
+    build/db --contention  --exp_type 4 --pool_size 32;   killall db
+    build/db --contention  --exp_type 4 --pool_size 64;   killall db
+    build/db --contention  --exp_type 4 --pool_size 128;   killall db
+    echo
+
+    echo '========== PROCESS RING POOL WITH CONTENTION =========='
+    build/db --contention  --exp_type 5 --pool_size 1;   killall db
+    build/db --contention  --exp_type 5 --pool_size 2;   killall db
+    build/db --contention  --exp_type 5 --pool_size 4;   killall db
+    build/db --contention  --exp_type 5 --pool_size 8;   killall db
+    build/db --contention  --exp_type 5 --pool_size 16;   killall db
+    build/db --contention  --exp_type 5 --pool_size 32;   killall db
+    build/db --contention  --exp_type 5 --pool_size 64;   killall db
+    build/db --contention  --exp_type 5 --pool_size 128;   killall db
+    echo
+
     if rmdir $LOCKDIR
     then
         echo "Victory is mine"
@@ -1,8 +1,10 @@
 #ifndef CONFIG_H_
 #define CONFIG_H_
 
+#include <database.h>
 #include <getopt.h>
 #include <stdlib.h>
+#include <string.h>
 #include <cassert>
 #include <iostream>
 #include <unordered_map>
@@ -13,7 +15,16 @@ static struct option long_options[] = {
     {"exp_type", required_argument, NULL, 2},
     {"test", no_argument, NULL, 3},
     {"contention", no_argument, NULL, 4},
-    {NULL, no_argument, NULL, 5},
+    {"db_file", required_argument, NULL, 5},
+    {"huge_pages", no_argument, NULL, 6},
+    {"bench_kernels", no_argument, NULL, 7},
+    {"layout", required_argument, NULL, 8},
+    {"lock_stripes", required_argument, NULL, 9},
+    {"read_pct", required_argument, NULL, 10},
+    {"bench_launchers", no_argument, NULL, 11},
+    {"pin", no_argument, NULL, 12},
+    {"bench_counters", no_argument, NULL, 13},
+    {NULL, no_argument, NULL, 14},
 };
 
 enum exec_model
@@ -22,6 +33,10 @@ enum exec_model
     PROCESS,
     THREAD_POOL,
     THREAD,
+    THREAD_RING,
+    PROCESS_RING,
+    ZYGOTE,
+    FIBER,
 };
 
 enum option_code
@@ -31,6 +46,15 @@ enum option_code
     EXP_TYPE        = 2,
     TEST            = 3,
     CONTENTION      = 4,
+    DB_FILE         = 5,
+    HUGE_PAGES      = 6,
+    BENCH_KERNELS   = 7,
+    LAYOUT          = 8,
+    LOCK_STRIPES    = 9,
+    READ_PCT        = 10,
+    BENCH_LAUNCHERS = 11,
+    PIN             = 12,
+    BENCH_COUNTERS  = 13,
 };
 
 class expt_config
@@ -71,6 +95,12 @@ class expt_config
 
     void init_config()
     {
+        /* The microbenchmarks need no other parameters */
+        _bench_kernels   = (_arg_map.count(BENCH_KERNELS) > 0);
+        _bench_launchers = (_arg_map.count(BENCH_LAUNCHERS) > 0);
+        _bench_counters  = (_arg_map.count(BENCH_COUNTERS) > 0);
+        if (_bench_kernels || _bench_launchers || _bench_counters) return;
+
         if (_arg_map.count(EXP_TYPE) == 0)
         {
             std::cerr << "Error. Missing some required arguments.\n";
@@ -79,11 +109,12 @@ class expt_config
         }
 
         _type = (exec_model)atoi(_arg_map[EXP_TYPE]);
-        if (atoi(_arg_map[EXP_TYPE]) < 0 || atoi(_arg_map[EXP_TYPE]) > 3)
+        if (atoi(_arg_map[EXP_TYPE]) < 0 || atoi(_arg_map[EXP_TYPE]) > 7)
         {
-            std::cerr << "Error. exp_type param must be between 0 and 3.\n";
+            std::cerr << "Error. exp_type param must be between 0 and 7.\n";
             std::cerr << "0 -- PROCESS_POOL\n1 -- PROCESS/REQUEST\n2 -- "
-                         "THREAD_POOL\n3 -- THREAD/REQUEST\n";
+                         "THREAD_POOL\n3 -- THREAD/REQUEST\n4 -- THREAD_RING\n5 -- PROCESS_RING\n"
+                         "6 -- ZYGOTE PROCESS/REQUEST\n7 -- FIBER/REQUEST\n";
             exit(0);
         }
 
@@ -101,10 +132,22 @@ class expt_config
             case 3:
                 _type = THREAD;
                 break;
+            case 4:
+                _type = THREAD_RING;
+                break;
+            case 5:
+                _type = PROCESS_RING;
+                break;
+            case 6:
+                _type = ZYGOTE;
+                break;
+            case 7:
+                _type = FIBER;
+                break;
             default:
                 assert(false); /* Shouldn't get here */
         }
-        if (_type == PROCESS_POOL || _type == THREAD_POOL)
+        if (_type == PROCESS_POOL || _type == THREAD_POOL || _type == THREAD_RING || _type == PROCESS_RING)
         {
             if (_arg_map.count(POOL_SIZE) == 0)
             {
@@ -123,7 +166,7 @@ class expt_config
                 _pool_size = atoi(_arg_map[POOL_SIZE]);
             }
         }
-        else if (_type == THREAD || _type == PROCESS)
+        else if (_type == THREAD || _type == PROCESS || _type == ZYGOTE)
         {
             if (_arg_map.count(MAX_OUTSTANDING) == 0)
             {
@@ -142,12 +185,44 @@ class expt_config
                 max_outstanding_ = atoi(_arg_map[MAX_OUTSTANDING]);
             }
         }
+        else if (_type == FIBER)
+        {
+            if (_arg_map.count(POOL_SIZE) == 0 || _arg_map.count(MAX_OUTSTANDING) == 0)
+            {
+                std::cerr << "--pool_size (threads) and --max_outstanding (fibers) arguments ";
+                std::cerr << "required for fiber experiments.\n";
+                exit(0);
+            }
+            _pool_size       = atoi(_arg_map[POOL_SIZE]);
+            max_outstanding_ = atoi(_arg_map[MAX_OUTSTANDING]);
+        }
         else
         {
             assert(false); /* Shouldn't get here */
         }
         _test       = (_arg_map.count(TEST) > 0);
         _contention = (_arg_map.count(CONTENTION) > 0);
+        _db_file    = (_arg_map.count(DB_FILE) > 0) ? _arg_map[DB_FILE] : NULL;
+        _huge_pages = (_arg_map.count(HUGE_PAGES) > 0);
+        _pin        = (_arg_map.count(PIN) > 0);
+        _layout     = LAYOUT_ROW;
+        if (_arg_map.count(LAYOUT) > 0 && strcmp(_arg_map[LAYOUT], "packed") == 0)
+        {
+            _layout = LAYOUT_PACKED;
+        }
+        else if (_arg_map.count(LAYOUT) > 0 && strcmp(_arg_map[LAYOUT], "row") != 0)
+        {
+            std::cerr << "Error. layout param must be row or packed.\n";
+            exit(0);
+        }
+        _lock_stripes = (_arg_map.count(LOCK_STRIPES) > 0) ? atoi(_arg_map[LOCK_STRIPES]) : 0;
+        _read_pct     = (_arg_map.count(READ_PCT) > 0) ? atoi(_arg_map[READ_PCT]) : 0;
+        if (_lock_stripes < 0 || _read_pct < 0 || _read_pct > 100)
+        {
+            std::cerr << "Error. lock_stripes param must be at least 0 (0 -- a lock per record), ";
+            std::cerr << "and read_pct param between 0 and 100.\n";
+            exit(0);
+        }
     }
 
    public:
@@ -156,6 +231,15 @@ class expt_config
     exec_model _type;
     bool _test;
     bool _contention;
+    char *_db_file;   /* database file to reuse across runs, or NULL */
+    bool _huge_pages; /* back the records with huge pages */
+    bool _pin;        /* pin pool processes to cores */
+    record_layout _layout;
+    int _lock_stripes; /* lock stripes, or 0 for a lock per record */
+    int _read_pct;     /* percentage of read-only requests */
+    bool _bench_kernels;
+    bool _bench_launchers;
+    bool _bench_counters;
 
     expt_config(int argc, char **argv)
     {
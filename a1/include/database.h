@@ -4,7 +4,18 @@
 #define RECORD_SIZE 1000
 #define FIELD_SIZE 100
 
+/* Size of a huge page, and the alignment of each region of a database file */
+#define HUGE_PAGE_SIZE (2UL << 20)
+
+/* Size of a cache line, the alignment of each lock stripe */
+#define CACHE_LINE 64
+
+/* Words in a record's slot of the hot array (LAYOUT_PACKED): 128 bytes */
+#define HOT_WORDS 16
+
+#include <pthread.h>
 #include <semaphore.h>
+#include <stddef.h>
 #include <stdint.h>
 
 struct Record
@@ -12,6 +23,25 @@ struct Record
     char bytes_[RECORD_SIZE];
 };
 
+/*
+ * How a Database lays out its records. Updates only touch the first word of
+ * each field, which LAYOUT_ROW leaves FIELD_SIZE bytes apart: ten words on
+ * ten cache lines per record. LAYOUT_PACKED moves those words into a hot
+ * array, one HOT_WORDS slot per record (two adjacent cache lines), and keeps
+ * the rest of every record, the cold bytes, in the record array.
+ */
+enum record_layout
+{
+    LAYOUT_ROW = 0,
+    LAYOUT_PACKED,
+};
+
+/* A reader-writer lock over every key hashed to it, on its own cache line */
+struct LockStripe
+{
+    pthread_rwlock_t lock_;
+} __attribute__((aligned(CACHE_LINE)));
+
 class Database
 {
    private:
@@ -23,19 +53,61 @@ class Database
    protected:
     uint32_t num_records_;
     Record *records_;
-    pthread_mutex_t *locks_;
+    pthread_mutex_t *locks_; /* one per record, or NULL if striped */
+    LockStripe *stripes_;    /* num_stripes_ stripes, or NULL */
+    uint32_t num_stripes_;
+    record_layout layout_;
+    uint64_t *hot_; /* hot words of each record (LAYOUT_PACKED), else NULL */
+
+    bool huge_pages_; /* records_ and hot_ were mapped for huge pages */
 
-    static void InitRecord(char *buf);
+    static void InitRecord(char *buf, uint64_t seed, uint64_t index);
+    static void PopulateRange(void *arg, uint64_t begin, uint64_t end);
+    static void Populate(Record *records, uint64_t *hot, pthread_mutex_t *locks, uint32_t recordNum,
+                         bool multiProcess, uint64_t seed, uint32_t nthreads);
+    static void *MapRegion(size_t size, bool hugePages);
+    static Database *Allocate(uint32_t recordNum, bool multiProcess, bool hugePages, record_layout layout,
+                              uint32_t lockStripes);
+    void InitStripes(uint32_t lockStripes, bool multiProcess);
 
    public:
-    static Database *Create(uint32_t recordNum, bool multiProcess);
+    static Database *Create(uint32_t recordNum, bool multiProcess, bool hugePages = false, uint64_t seed = 0,
+                            uint32_t nthreads = 1, record_layout layout = LAYOUT_ROW, uint32_t lockStripes = 0);
+    static Database *Open(const char *path, uint32_t recordNum, bool multiProcess, bool hugePages = false,
+                          uint64_t seed = 0, uint32_t nthreads = 1, record_layout layout = LAYOUT_ROW,
+                          uint32_t lockStripes = 0);
     static void Destroy(Database *db);
     static void Compare(Database *db1, Database *db2);
     static void Copy(Database *dst, Database *src);
 
+    /*
+     * A record's bytes, in place. Only LAYOUT_ROW keeps whole records in
+     * place; ReadRecord and WriteRecord work with either layout.
+     */
     Record *GetRecord(uint64_t key);
+    void ReadRecord(uint64_t key, Record *rec);
+    void WriteRecord(uint64_t key, const Record *rec);
+
+    /* The first word of each field of a record, in place (LAYOUT_PACKED) */
+    uint64_t *HotWords(uint64_t key);
+    record_layout Layout() { return layout_; }
+
     void LockRecord(uint64_t key);
     void UnlockRecord(uint64_t key);
+
+    /*
+     * Locks are either one mutex per record, or, with lockStripes > 0,
+     * that many reader-writer locks with keys hashed across them. LockId
+     * names the lock covering a key. Several keys may share one: lock each
+     * id once, in increasing order, and shared locks are only shared with
+     * stripes (a record's mutex is always exclusive).
+     */
+    uint64_t LockId(uint64_t key);
+    void Lock(uint64_t lockId, bool shared);
+    void Unlock(uint64_t lockId);
+
+    /* Take a lock as Lock does if it is free; returns whether it did */
+    bool TryLock(uint64_t lockId, bool shared);
     size_t DBSize();
 };
 
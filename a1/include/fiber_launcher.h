@@ -0,0 +1,107 @@
+#ifndef FIBER_LAUNCHER_H_
+#define FIBER_LAUNCHER_H_
+
+#include <launcher.h>
+#include <pthread.h>
+
+/* Requests each worker's submission ring holds; a power of two */
+#define FIBER_RING_SZ 256
+
+/*
+ * Stack of each fiber. Requests only sort their writeset and take locks.
+ * Each stack has an inaccessible guard page below it, so that overflowing
+ * it faults instead of overwriting the next fiber's stack.
+ */
+#define FIBER_STACK_SZ (64 * 1024)
+
+/* Empty polls of its ring an idle worker makes before it parks */
+#define FIBER_SPINS 1024
+
+struct fiber_worker;
+
+/*
+ * A user-level context that runs requests for one worker thread. A fiber
+ * runs one request at a time and then returns to its worker's reservoir of
+ * idle fibers, keeping its stack for the next request.
+ */
+struct fiber
+{
+    void *sp_;             /* saved stack pointer while switched out */
+    Request *req_;         /* request being run, or NULL once it is done */
+    fiber_worker *worker_; /* the worker thread it always runs on */
+    fiber *link_;          /* next fiber in the worker's idle or ready list */
+};
+
+class FiberLauncher;
+
+/*
+ * A kernel thread and the fibers it multiplexes. The launcher hands it
+ * requests through a single-producer, single-consumer ring; the rest is
+ * only touched by the worker thread.
+ */
+struct fiber_worker
+{
+    FiberLauncher *launcher_;
+    pthread_t thread_id_;
+    uint32_t id_; /* also the worker's txns executed shard */
+
+    /* Padded apart: tail_ and wake_seq_ are written by the launcher, head_ by the worker */
+    Request *ring_[FIBER_RING_SZ];
+    volatile uint64_t tail_; /* next request number to publish */
+    volatile uint32_t wake_seq_;
+    char pad0_[CACHE_LINE_SZ];
+    volatile uint64_t head_; /* next request number to take */
+    volatile uint32_t parked_;
+    char pad1_[CACHE_LINE_SZ];
+
+    void *sp_; /* the worker thread's own context while a fiber runs */
+    fiber *fibers_;
+    char *stacks_; /* num_fibers_ guard pages and stacks, back to back */
+    uint32_t num_fibers_;
+    fiber *idle_;                     /* fibers with no request */
+    fiber *ready_head_, *ready_tail_; /* fibers to run or resume, in order */
+    uint32_t num_ready_;
+};
+
+/*
+ * Requests run as fibers, multiplexed over a fixed set of pool_sz kernel
+ * threads. The launcher spreads requests round-robin over the workers'
+ * rings; a worker starts an idle fiber on each request it takes, and runs
+ * its ready fibers in turn. Fibers switch with a hand-rolled x86-64 context
+ * switch that saves only the callee-saved registers, with no system call.
+ *
+ * A fiber that finds a record's lock taken yields to the next ready fiber
+ * instead of blocking its thread, and tries again when its turn comes back.
+ * A worker with max_outstanding / pool_sz fibers can so have that many
+ * requests outstanding at the cost of one thread. If a whole round of its
+ * fibers only yields, the worker yields its core to the lock holders.
+ * Fibers never move between threads, so a lock is released by the thread
+ * that took it.
+ */
+class FiberLauncher : public Launcher
+{
+   private:
+    uint32_t pool_sz_;
+    uint32_t next_worker_; /* where the launcher sends the next request */
+    fiber_worker *workers_;
+    volatile bool stop_;
+
+    /* Take requests off w's ring while it has idle fibers; returns how many */
+    uint32_t Admit(fiber_worker *w);
+    void Park(fiber_worker *w);
+    void Run(fiber_worker *w);
+
+    /* Executed by threads in the pool */
+    static void *ExecutorFunc(void *arg);
+
+   public:
+    /* Body of every fiber, and what it runs while waiting for a lock */
+    void FiberMain(fiber *f);
+    static void Yield(void *arg);
+
+    FiberLauncher(uint32_t pool_sz, uint32_t max_outstanding);
+    ~FiberLauncher();
+    void ExecuteRequest(Request *req);
+};
+
+#endif  // FIBER_LAUNCHER_H_
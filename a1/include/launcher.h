@@ -8,20 +8,39 @@
 /* Size of a single cache line. 64 bytes */
 #define CACHE_LINE_SZ 64
 
+/* A shard of the # txns completed, alone on its cache line */
+struct txn_counter
+{
+    volatile uint64_t executed_;
+    char pad_[CACHE_LINE_SZ - sizeof(uint64_t)];
+};
+
 class Launcher
 {
    protected:
-    volatile uint64_t *txns_executed_; /* # txns completed */
-    uint64_t _num_requests;            /* # txns issued */
+    /*
+     * # txns completed, sharded so that workers do not all write one cache
+     * line: worker i counts in txns_executed_[i % num_counters_]. The
+     * shards are shared with child processes.
+     */
+    txn_counter *txns_executed_;
+    uint32_t num_counters_;
+    uint64_t _num_requests; /* # txns issued */
+
+    /* Returns the shard that worker i counts in */
+    volatile uint64_t *DoneCounter(uint64_t i) { return &txns_executed_[i % num_counters_].executed_; }
 
     /* Atomically increment the 64-bit int done_ptr points to */
     static void IncrDoneTxns(volatile uint64_t *done_ptr);
 
+    /* Add n to a shard that no other worker writes, without a locked instruction */
+    static void AddDoneTxns(volatile uint64_t *done_ptr, uint64_t n);
+
    public:
-    Launcher();
-    ~Launcher();
+    Launcher(uint32_t num_counters = 1);
+    virtual ~Launcher();
 
-    /* Returns the latest value of *txns_executed_ */
+    /* Returns the latest total of the txns_executed_ shards */
     uint64_t ReadTxnsExecuted();
 
     /* Wait for outstanding requests to finish executing */
@@ -29,6 +48,9 @@ class Launcher
 
     /* Execute a single request */
     virtual void ExecuteRequest(Request *req);
+
+    /* Average ns spent spawning a process per request, or 0 if the launcher does not */
+    virtual double SpawnNs();
 };
 
 #endif  // LAUNCHER_H_
@@ -20,6 +20,10 @@ class ProcessLauncher : public Launcher
     pthread_mutex_t* done_mutex_;
     pthread_cond_t* done_cond_;
 
+    /* Time spent in fork(), mostly copying this process' page tables */
+    double spawn_ns_;
+    uint64_t spawns_;
+
    public:
     ProcessLauncher(int max_outstanding);
 
@@ -27,6 +31,8 @@ class ProcessLauncher : public Launcher
 
     /* Run a single request */
     void ExecuteRequest(Request* req);
+
+    double SpawnNs();
 };
 
 #endif  // PROCESS_LAUNCHER_H_
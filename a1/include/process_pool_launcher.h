@@ -28,7 +28,7 @@ struct proc_state
     bool *proc_done_;             /* notify proc of a request */
 
     proc_mgr *launcher_state_;         /* global pool mgmt state */
-    volatile uint64_t *txns_executed_; /* ptr to txn executed counter */
+    volatile uint64_t *txns_executed_; /* ptr to this worker's txn executed shard */
     proc_state *list_ptr_;             /* links proc states */
 };
 
@@ -0,0 +1,74 @@
+#ifndef PROCESS_RING_LAUNCHER_H_
+#define PROCESS_RING_LAUNCHER_H_
+
+#include <launcher.h>
+#include <process_pool_launcher.h>
+#include <sys/types.h>
+
+/* Requests the shared ring holds; a power of two */
+#define PROC_RING_SZ 256
+
+/* Most requests a pool process takes off the ring at once */
+#define PROC_RING_BATCH 8
+
+/*
+ * A slot of the shared ring: the request is serialized into req_ in place.
+ * seq_ follows the same protocol as ThreadRingLauncher's ring_slot, except
+ * that a slot is only freed once its request has run, since the request
+ * lives in it.
+ */
+struct proc_ring_slot
+{
+    volatile uint64_t seq_;
+    char pad_[CACHE_LINE_SZ - sizeof(uint64_t)];
+    char req_[RQST_BUF_SZ];
+};
+
+/* Ring indices and parking state, in memory shared with the pool */
+struct proc_ring_ctl
+{
+    /* Padded apart: tail_ and wake_seq_ are written by the launcher, the rest by the pool */
+    volatile uint64_t tail_; /* next request number to publish */
+    volatile uint32_t wake_seq_;
+    char pad0_[CACHE_LINE_SZ];
+    volatile uint64_t head_; /* next request number to claim */
+    char pad1_[CACHE_LINE_SZ];
+    volatile uint32_t sleepers_;
+    volatile uint32_t stop_;
+};
+
+/*
+ * A process pool fed through a single-producer, multi-consumer ring in
+ * shared memory. The launcher serializes each request straight into the
+ * next free slot and publishes it; pool processes claim runs of up to
+ * PROC_RING_BATCH published slots with one compare-and-swap, run the
+ * requests where they lie and free the slots. Idle processes spin briefly,
+ * if there is a core for each, and then park on a futex, which the launcher
+ * only wakes if one is parked.
+ *
+ * Each process counts the requests it ran in its own shard of
+ * txns_executed_. With 'pin', pool process i runs on core i modulo the
+ * number of cores.
+ */
+class ProcessRingLauncher : public Launcher
+{
+   private:
+    uint32_t pool_sz_;
+    pid_t *pids_;
+    proc_ring_ctl *ctl_;
+    proc_ring_slot *ring_;
+
+    /* Claim up to PROC_RING_BATCH published slots; returns how many, from *first */
+    uint32_t Claim(uint64_t *first);
+    void Park();
+
+    /* Executed by processes in the pool */
+    void ExecutorFunc(uint32_t id, bool pin);
+
+   public:
+    ProcessRingLauncher(uint32_t pool_sz, bool pin = false);
+    ~ProcessRingLauncher();
+    void ExecuteRequest(Request *req);
+};
+
+#endif  // PROCESS_RING_LAUNCHER_H_
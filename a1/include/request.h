@@ -5,6 +5,18 @@
 #include <stdint.h>
 #include <vector>
 
+/* Implementations of Request::DoWrite, fastest last */
+enum write_kernel
+{
+    KERNEL_SCALAR = 0,
+    KERNEL_AVX2,
+    KERNEL_AVX512,
+    NUM_KERNELS,
+};
+
+/* Called by a request that found a lock taken, before it tries the lock again */
+typedef void (*lock_wait_fn)(void *arg);
+
 class Request
 {
    private:
@@ -17,19 +29,80 @@ class Request
     uint32_t num_writes_;
     uint64_t *writeset_;
     uint64_t *updates_;
+    bool read_only_;     /* sum the records instead of updating them */
+    uint64_t checksum_;  /* what a read-only request read */
 
-    static void DoWrite(char *Record, uint64_t *updates);
+    static void (*write_fn_)(char *record, const uint64_t *updates);
 
-    void LockRecords();
+    void LockRecords(lock_wait_fn wait, void *wait_arg);
     void Txn();
     void UnlockRecords();
 
    public:
-    Request(Database *db, uint32_t nwrites, uint64_t *writeset, uint64_t *updates);
+    /*
+     * A request updates the records of its writeset, or, if 'readOnly',
+     * only reads them, under shared locks where the database has them.
+     */
+    Request(Database *db, uint32_t nwrites, uint64_t *writeset, uint64_t *updates, bool readOnly = false);
+
+    /* Add updates[i] to the first word of each field i of a record */
+    static void DoWrite(char *record, const uint64_t *updates) { write_fn_(record, updates); }
+
+    /*
+     * Add updates[i] to field i of record 'key' of 'db', in either layout.
+     * Packed hot words are contiguous, so they need no gather kernel.
+     */
+    static void UpdateRecord(Database *db, uint64_t key, const uint64_t *updates)
+    {
+        uint64_t *hot;
+        uint32_t i;
+
+        if (db->Layout() == LAYOUT_ROW)
+        {
+            DoWrite(db->GetRecord(key)->bytes_, updates);
+            return;
+        }
+        hot = db->HotWords(key);
+        for (i = 0; i < RECORD_SIZE / FIELD_SIZE; ++i) hot[i] += updates[i];
+    }
+
+    /* Sum of the fields of record 'key' of 'db', in either layout */
+    static uint64_t SumRecord(Database *db, uint64_t key)
+    {
+        uint64_t sum, *hot;
+        char *record;
+        uint32_t i;
+
+        sum = 0;
+        if (db->Layout() == LAYOUT_ROW)
+        {
+            record = db->GetRecord(key)->bytes_;
+            for (i = 0; i < RECORD_SIZE / FIELD_SIZE; ++i) sum += *(uint64_t *)(&record[i * FIELD_SIZE]);
+            return sum;
+        }
+        hot = db->HotWords(key);
+        for (i = 0; i < RECORD_SIZE / FIELD_SIZE; ++i) sum += hot[i];
+        return sum;
+    }
+
+    /*
+     * Whether this CPU can run kernel k, and switch DoWrite to it if so. By
+     * default DoWrite uses the fastest kernel the CPU supports.
+     */
+    static bool KernelSupported(write_kernel k);
+    static bool SelectKernel(write_kernel k);
+    static const char *KernelName(write_kernel k);
 
     static void CopyRequest(char *buf, Request *req);
     static size_t CopySize(Request *req);
     void Execute();
+
+    /*
+     * Execute, but rather than block on a lock that is taken, call
+     * wait(wait_arg) until it is free. Locks are still taken in order, so
+     * callers can run other requests in wait without deadlocking.
+     */
+    void Execute(lock_wait_fn wait, void *wait_arg);
     void SetDatabase(Database *db);
 };
 
@@ -22,7 +22,7 @@ struct thread_arg
     thread_arg *link_;                 /* links together entries in targ_list_ */
     thread_arg **targ_list_;           /* points to launcher's list of executed requests */
 
-    volatile uint64_t *txns_executed_; /* ptr to txns executed counter */
+    volatile uint64_t *txns_executed_; /* ptr to the launcher's txns executed shard for this thread */
 };
 
 class ThreadLauncher : public Launcher
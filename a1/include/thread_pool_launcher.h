@@ -22,7 +22,7 @@ struct thread_state
     thread_state **free_list_;    /* ptr to launcher's free list */
     thread_state *list_ptr_;      /* thread_state free list link */
 
-    volatile uint64_t *txns_executed_; /* ptr to txn executed counter */
+    volatile uint64_t *txns_executed_; /* ptr to this worker's txn executed shard */
 };
 
 class ThreadPoolLauncher : public Launcher
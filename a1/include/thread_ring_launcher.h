@@ -0,0 +1,77 @@
+#ifndef THREAD_RING_LAUNCHER_H_
+#define THREAD_RING_LAUNCHER_H_
+
+#include <launcher.h>
+#include <pthread.h>
+
+/* Requests the submission ring holds; a power of two */
+#define RING_SZ 1024
+
+/* Most requests a worker takes off the ring at once */
+#define RING_BATCH 16
+
+/* Bounds of a worker's spin budget before it parks, in empty polls */
+#define MIN_SPINS 16
+#define MAX_SPINS 16384
+
+/*
+ * A slot of the submission ring. seq_ tells the slot's state for the
+ * launcher's request number n: n while the slot is free for it, n + 1 once
+ * request n is in it, and n + RING_SZ once a worker has taken it out.
+ */
+struct ring_slot
+{
+    volatile uint64_t seq_;
+    Request *req_;
+};
+
+class ThreadRingLauncher;
+
+/* What each worker thread gets to run with */
+struct ring_worker
+{
+    ThreadRingLauncher *launcher_;
+    pthread_t thread_id_;
+    uint32_t id_; /* also the worker's txns executed shard */
+};
+
+/*
+ * A thread pool fed through a bounded lock-free ring. The launcher thread
+ * publishes each request into the next slot and workers claim runs of up to
+ * RING_BATCH published slots with one compare-and-swap. Nothing takes a lock
+ * on the way. An idle worker polls the ring for its spin budget and then
+ * parks on a futex; the launcher only makes a system call to wake it if some
+ * worker is parked. A worker's budget doubles whenever a request turns up
+ * while it spins and halves whenever it has to park.
+ */
+class ThreadRingLauncher : public Launcher
+{
+   private:
+    uint32_t pool_sz_;
+    ring_worker *workers_;
+    ring_slot *ring_;
+
+    /* Padded apart: tail_ and wake_seq_ are written by the launcher, the rest by workers */
+    volatile uint64_t tail_; /* next request number to publish */
+    volatile uint32_t wake_seq_;
+    char pad0_[CACHE_LINE_SZ];
+    volatile uint64_t head_; /* next request number to claim */
+    char pad1_[CACHE_LINE_SZ];
+    volatile uint32_t sleepers_;
+    volatile bool stop_;
+
+    /* Claim up to RING_BATCH requests into reqs; returns how many */
+    uint32_t Claim(Request **reqs);
+    void Park();
+    void Run(uint32_t id);
+
+    /* Executed by threads in the pool */
+    static void *ExecutorFunc(void *arg);
+
+   public:
+    ThreadRingLauncher(int pool_sz);
+    ~ThreadRingLauncher();
+    void ExecuteRequest(Request *req);
+};
+
+#endif  // THREAD_RING_LAUNCHER_H_
@@ -1,8 +1,15 @@
 #ifndef UTILS_H_
 #define UTILS_H_
 
+#include <linux/futex.h>
+#include <pthread.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <cassert>
 
 #if __linux__
 #include <linux/version.h>
@@ -29,4 +36,100 @@ static inline uint64_t fetch_and_increment(volatile uint64_t *var)
     return counter_value + 1;
 }
 
+/* SplitMix64 finalizer: mixes the bits of z, one-to-one */
+static inline uint64_t mix64(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * Counter-based random numbers: returns the counter'th number of the stream
+ * named by seed (SplitMix64 started at mix64(seed)). Numbers are computed,
+ * not drawn from shared state, so work split across any number of threads
+ * sees exactly the numbers a single thread would.
+ */
+static inline uint64_t counter_rand(uint64_t seed, uint64_t counter)
+{
+    return mix64(mix64(seed) + (counter + 1) * 0x9e3779b97f4a7c15ULL);
+}
+
+/* Returns the time in seconds on a monotonic clock */
+static inline double now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Sleep while *addr holds val, until futex_wake. These are the shared
+ * futex operations, so the word may live in memory shared with other
+ * processes.
+ */
+static inline void futex_wait(volatile uint32_t *addr, uint32_t val)
+{
+    syscall(SYS_futex, addr, FUTEX_WAIT, val, NULL, NULL, 0);
+}
+
+/* Wake up to n sleepers in futex_wait on addr */
+static inline void futex_wake(volatile uint32_t *addr, int n) { syscall(SYS_futex, addr, FUTEX_WAKE, n, NULL, NULL, 0); }
+
+/* Returns the number of online CPUs */
+static inline uint32_t num_cpus()
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (uint32_t)n : 1;
+}
+
+struct parallel_range
+{
+    void (*fn_)(void *arg, uint64_t begin, uint64_t end);
+    void *arg_;
+    uint64_t begin_;
+    uint64_t end_;
+};
+
+static inline void *run_parallel_range(void *arg)
+{
+    parallel_range *range = (parallel_range *)arg;
+    range->fn_(range->arg_, range->begin_, range->end_);
+    return NULL;
+}
+
+/*
+ * Calls fn(arg, begin, end) on nthreads threads (the caller's among them),
+ * splitting [0, n) into one contiguous range per thread, and waits for all
+ * of them.
+ */
+static inline void parallel_for(uint32_t nthreads, uint64_t n, void (*fn)(void *arg, uint64_t begin, uint64_t end),
+                                void *arg)
+{
+    parallel_range *ranges;
+    pthread_t *threads;
+    uint32_t i;
+    int err;
+
+    if (nthreads == 0) nthreads = 1;
+    ranges  = (parallel_range *)malloc(sizeof(parallel_range) * nthreads);
+    threads = (pthread_t *)malloc(sizeof(pthread_t) * nthreads);
+    for (i = 0; i < nthreads; ++i)
+    {
+        ranges[i].fn_    = fn;
+        ranges[i].arg_   = arg;
+        ranges[i].begin_ = n * i / nthreads;
+        ranges[i].end_   = n * (i + 1) / nthreads;
+    }
+    for (i = 1; i < nthreads; ++i)
+    {
+        err = pthread_create(&threads[i], NULL, run_parallel_range, &ranges[i]);
+        assert(err == 0);
+    }
+    run_parallel_range(&ranges[0]);
+    for (i = 1; i < nthreads; ++i) pthread_join(threads[i], NULL);
+    free(ranges);
+    free(threads);
+}
+
 #endif  // UTILS_H_
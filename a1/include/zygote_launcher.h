@@ -0,0 +1,67 @@
+#ifndef ZYGOTE_LAUNCHER_H_
+#define ZYGOTE_LAUNCHER_H_
+
+#include <launcher.h>
+#include <process_pool_launcher.h>
+#include <sys/types.h>
+
+/* States of a zygote_slot */
+enum zygote_slot_state
+{
+    SLOT_FREE = 0,
+    SLOT_SUBMITTED, /* holds a request the zygote has yet to spawn a process for */
+    SLOT_RUNNING,
+};
+
+/* Room for one outstanding request, serialized in place */
+struct zygote_slot
+{
+    volatile uint32_t state_;
+    char pad_[CACHE_LINE_SZ - sizeof(uint32_t)];
+    char req_[RQST_BUF_SZ];
+};
+
+/* Coordination between the launcher, the zygote and its children, in shared memory */
+struct zygote_ctl
+{
+    volatile uint32_t submit_seq_; /* bumped by the launcher on every submission */
+    volatile uint32_t stop_;
+    char pad0_[CACHE_LINE_SZ];
+    volatile uint32_t done_seq_; /* bumped by a child when its request is done */
+    char pad1_[CACHE_LINE_SZ];
+    volatile uint64_t spawn_ns_; /* total time the zygote spent in fork() */
+    volatile uint64_t spawns_;
+};
+
+/*
+ * Process-per-request through a zygote: a template process forked when the
+ * launcher is created, which forks a child for each request in turn. fork()
+ * copies the page tables of the forking process, so a zygote created before
+ * the requests are generated spawns children far more cheaply than the
+ * launcher process itself could once it holds millions of requests.
+ *
+ * The launcher serializes each request into a free slot of shared memory
+ * and wakes the zygote, which forks a child to run it; the child frees the
+ * slot when it is done. With max_outstanding slots, at most that many
+ * requests are outstanding.
+ */
+class ZygoteLauncher : public Launcher
+{
+   private:
+    uint32_t max_outstanding_;
+    uint32_t next_slot_; /* where the launcher looks for a free slot first */
+    pid_t zygote_;
+    zygote_ctl *ctl_;
+    zygote_slot *slots_;
+
+    /* Executed by the zygote */
+    void ZygoteFunc();
+
+   public:
+    ZygoteLauncher(uint32_t max_outstanding);
+    ~ZygoteLauncher();
+    void ExecuteRequest(Request *req);
+    double SpawnNs();
+};
+
+#endif  // ZYGOTE_LAUNCHER_H_
@@ -1,25 +1,72 @@
 #include <database.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <utils.h>
 #include <cassert>
 #include <cstddef>
 #include <cstdlib>
 #include <iostream>
 
+/* "A1RECDB2", read as a little-endian uint64_t */
+#define DB_FILE_MAGIC 0x3242444345523141ULL
+
+/*
+ * First page of a database file. The file continues with the records and
+ * then their hot words (LAYOUT_PACKED only), each region starting on a huge
+ * page boundary.
+ */
+struct DatabaseHeader
+{
+    uint64_t magic_;
+    uint32_t num_records_;
+    uint32_t record_size_;
+    uint32_t field_size_;
+    uint32_t initialized_; /* set once every record has been written */
+    uint64_t seed_;        /* seed the records were generated from */
+    uint32_t layout_;
+};
+
+/* Arguments to PopulateRange */
+struct populate_args
+{
+    Record *records_; /* NULL to initialize only the locks */
+    uint64_t *hot_;   /* NULL unless LAYOUT_PACKED */
+    pthread_mutex_t *locks_;
+    pthread_mutexattr_t *mutexattr_;
+    uint64_t seed_;
+};
+
+static inline size_t RoundUp(size_t size, size_t align) { return (size + align - 1) & ~(align - 1); }
+
+/* Size of an anonymous mapping of 'size' bytes */
+static inline size_t AnonSize(size_t size, bool hugePages)
+{
+    return hugePages ? RoundUp(size, HUGE_PAGE_SIZE) : size;
+}
+
+/* Size of the hot array of 'recordNum' records laid out as 'layout' */
+static inline size_t HotSize(uint32_t recordNum, record_layout layout)
+{
+    return layout == LAYOUT_PACKED ? sizeof(uint64_t) * HOT_WORDS * recordNum : 0;
+}
+
 size_t Database::DBSize() { return (size_t)num_records_; }
 void Database::Compare(Database *db1, Database *db2)
 {
     assert(db1->DBSize() == db2->DBSize());
 
     uint32_t i;
-    Record *record1, *record2;
+    Record record1, record2;
     bool cmp;
 
     for (i = 0; i < db1->DBSize(); ++i)
     {
-        record1 = db1->GetRecord(i);
-        record2 = db2->GetRecord(i);
-        cmp     = memcmp(record1->bytes_, record2->bytes_, RECORD_SIZE);
+        db1->ReadRecord(i, &record1);
+        db2->ReadRecord(i, &record2);
+        cmp = memcmp(record1.bytes_, record2.bytes_, RECORD_SIZE);
         if (cmp != 0)
         {
             std::cerr << "Database records do not match!\n";
@@ -33,76 +80,267 @@ void Database::Copy(Database *dst, Database *src)
     assert(dst->DBSize() == src->DBSize());
 
     uint32_t i;
-    Record *to_rec, *from_rec;
+    Record rec;
     for (i = 0; i < dst->DBSize(); ++i)
     {
-        to_rec   = dst->GetRecord(i);
-        from_rec = src->GetRecord(i);
-        memcpy(to_rec->bytes_, from_rec->bytes_, RECORD_SIZE);
+        src->ReadRecord(i, &rec);
+        dst->WriteRecord(i, &rec);
     }
 }
 
-Database *Database::Create(uint32_t recordNum, bool multiProcess)
+/*
+ * Allocate a Database with room for 'recordNum' records, their hot words
+ * (LAYOUT_PACKED only) and their locks, none of them initialized yet.
+ *
+ * Memory is allocated as anonymous mmap'ed buffers. Allocating as anon
+ * mmap'ed buffers allows the allocator (this process) to share memory
+ * with child processes.
+ */
+Database *Database::Allocate(uint32_t recordNum, bool multiProcess, bool hugePages, record_layout layout,
+                             uint32_t lockStripes)
 {
-    assert(RECORD_SIZE % FIELD_SIZE == 0);
-
     Database *db_mem;
-    Record *record_mem;
-    pthread_mutex_t *mutex_mem;
-    uint32_t i;
-    int sem_flag;
-
-    /*
-     * Allocate memory to Database class, records, and their semaphores.
-     *
-     * Memory is allocated as anonymous mmap'ed buffers. Allocating as anon
-     * mmap'ed buffers allows the allocator (this process) to share memory
-     * with child processes.
-     */
+
     db_mem = (Database *)mmap(NULL, sizeof(Database), PROT_FLAGS, MAP_FLAGS, 0, 0);
     assert(db_mem != MAP_FAILED);
-    record_mem = (Record *)mmap(NULL, sizeof(Record) * recordNum, PROT_FLAGS, MAP_FLAGS, 0, 0);
-    assert(record_mem != MAP_FAILED);
-    mutex_mem = (pthread_mutex_t *)mmap(NULL, sizeof(pthread_mutex_t) * recordNum, PROT_FLAGS, MAP_FLAGS, 0, 0);
-    assert(mutex_mem != MAP_FAILED);
-
-    /*
-     * If semaphores are used for inter-process synchronization, sem_flag is 1.
-     * If semaphores are used for inter-thread synchronization, sem_flag is 0.
-     */
-    if (multiProcess)
-        sem_flag = 1;
-    else
-        sem_flag = 0;
-
-    /*
-     * Initialize records and their associated semaphores.
-     *
-     * Each semaphore is initailized to 1. Setting its value to 1 allows it
-     * to function as a mutex lock.
-     */
-    for (i = 0; i < recordNum; ++i)
+    db_mem->num_records_ = recordNum;
+    db_mem->records_     = (Record *)MapRegion(AnonSize(sizeof(Record) * recordNum, hugePages), hugePages);
+    db_mem->hot_         = NULL;
+    if (layout == LAYOUT_PACKED)
+        db_mem->hot_ = (uint64_t *)MapRegion(AnonSize(HotSize(recordNum, layout), hugePages), hugePages);
+    db_mem->locks_ = NULL;
+    if (lockStripes == 0)
+    {
+        db_mem->locks_ =
+            (pthread_mutex_t *)mmap(NULL, sizeof(pthread_mutex_t) * recordNum, PROT_FLAGS, MAP_FLAGS, 0, 0);
+        assert(db_mem->locks_ != MAP_FAILED);
+    }
+    db_mem->layout_     = layout;
+    db_mem->huge_pages_ = hugePages;
+    db_mem->InitStripes(lockStripes, multiProcess);
+    return db_mem;
+}
+
+Database *Database::Create(uint32_t recordNum, bool multiProcess, bool hugePages, uint64_t seed, uint32_t nthreads,
+                           record_layout layout, uint32_t lockStripes)
+{
+    assert(RECORD_SIZE % FIELD_SIZE == 0);
+    assert(RECORD_SIZE / FIELD_SIZE <= HOT_WORDS);
+
+    Database *db_mem;
+
+    db_mem = Allocate(recordNum, multiProcess, hugePages, layout, lockStripes);
+
+    /* Initialize records and their associated locks. */
+    Populate(db_mem->records_, db_mem->hot_, db_mem->locks_, recordNum, multiProcess, seed, nthreads);
+    return db_mem;
+}
+
+/* Read or write 'size' bytes at 'offset' of 'fd', or exit naming 'path' */
+static void FileIO(int fd, const char *path, bool write, void *buf, size_t size, off_t offset)
+{
+    ssize_t n;
+
+    while (size > 0)
     {
-        if (sem_flag == 0)
-            mutex_mem[i] = PTHREAD_MUTEX_INITIALIZER;
-        else
+        n = write ? pwrite(fd, buf, size, offset) : pread(fd, buf, size, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0)
         {
-            pthread_mutexattr_t mutexattr;
-            pthread_mutexattr_init(&mutexattr);
-            pthread_mutexattr_setpshared(&mutexattr, PTHREAD_PROCESS_SHARED);
-            pthread_mutex_init(&mutex_mem[i], &mutexattr);
+            std::cerr << "Error. Cannot " << (write ? "write" : "read") << " database file " << path << ": "
+                      << (n < 0 ? strerror(errno) : "unexpected end of file") << "\n";
+            exit(-1);
         }
-        InitRecord((char *)&record_mem[i]);
+        buf = (char *)buf + n;
+        size -= n;
+        offset += n;
     }
+}
 
-    /* Initialize db class state */
-    db_mem->num_records_ = recordNum;
-    db_mem->records_     = record_mem;
-    db_mem->locks_       = mutex_mem;
+/*
+ * Open the database file at 'path', generating its records first unless it
+ * already holds 'recordNum' fully generated records.
+ *
+ * The records are loaded into anonymous memory, as Create allocates it, and
+ * the file is not mapped: the benchmark's writes then never dirty the page
+ * cache or reach the file, child processes still share the records, and
+ * 'hugePages' applies as it does to Create (the kernel will not back a
+ * mapping of an ext4 or xfs file with huge pages). Records are only written
+ * to the file when they are generated, so the next run with the same file
+ * starts from the same records and skips generating them. Locks are never
+ * persisted, since no process can still hold one.
+ */
+Database *Database::Open(const char *path, uint32_t recordNum, bool multiProcess, bool hugePages, uint64_t seed,
+                         uint32_t nthreads, record_layout layout, uint32_t lockStripes)
+{
+    assert(RECORD_SIZE % FIELD_SIZE == 0);
+    assert(RECORD_SIZE / FIELD_SIZE <= HOT_WORDS);
+
+    Database *db_mem;
+    DatabaseHeader header;
+    size_t records_size, hot_size, file_size;
+    struct stat st;
+    int fd, err;
+
+    records_size = RoundUp(sizeof(Record) * recordNum, HUGE_PAGE_SIZE);
+    hot_size     = RoundUp(HotSize(recordNum, layout), HUGE_PAGE_SIZE);
+    file_size    = HUGE_PAGE_SIZE + records_size + hot_size;
 
+    fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        std::cerr << "Error. Cannot open database file " << path << ": " << strerror(errno) << "\n";
+        exit(-1);
+    }
+
+    /* A file of the wrong size is regenerated from scratch. */
+    if ((size_t)st.st_size != file_size)
+    {
+        err = ftruncate(fd, 0);
+        assert(err == 0);
+        err = ftruncate(fd, file_size);
+        if (err != 0)
+        {
+            std::cerr << "Error. Cannot grow database file " << path << ": " << strerror(errno) << "\n";
+            exit(-1);
+        }
+    }
+
+    db_mem = Allocate(recordNum, multiProcess, hugePages, layout, lockStripes);
+    FileIO(fd, path, false, &header, sizeof(header), 0);
+    if (header.magic_ != DB_FILE_MAGIC || header.num_records_ != recordNum || header.record_size_ != RECORD_SIZE ||
+        header.field_size_ != FIELD_SIZE || header.initialized_ == 0 || header.seed_ != seed ||
+        header.layout_ != (uint32_t)layout)
+    {
+        std::cerr << "Generating database file " << path << "\n";
+        memset(&header, 0, sizeof(header));
+        FileIO(fd, path, true, &header, sizeof(header), 0);
+        Populate(db_mem->records_, db_mem->hot_, NULL, recordNum, multiProcess, seed, nthreads);
+        FileIO(fd, path, true, db_mem->records_, sizeof(Record) * recordNum, HUGE_PAGE_SIZE);
+        FileIO(fd, path, true, db_mem->hot_, HotSize(recordNum, layout), HUGE_PAGE_SIZE + records_size);
+
+        /* The header must not claim records that never reached the file. */
+        err = fdatasync(fd);
+        assert(err == 0);
+        header.magic_       = DB_FILE_MAGIC;
+        header.num_records_ = recordNum;
+        header.record_size_ = RECORD_SIZE;
+        header.field_size_  = FIELD_SIZE;
+        header.seed_        = seed;
+        header.layout_      = layout;
+        header.initialized_ = 1;
+        FileIO(fd, path, true, &header, sizeof(header), 0);
+        err = fdatasync(fd);
+        assert(err == 0);
+    }
+    else
+    {
+        FileIO(fd, path, false, db_mem->records_, sizeof(Record) * recordNum, HUGE_PAGE_SIZE);
+        FileIO(fd, path, false, db_mem->hot_, HotSize(recordNum, layout), HUGE_PAGE_SIZE + records_size);
+    }
+    close(fd);
+
+    if (db_mem->locks_ != NULL) Populate(NULL, NULL, db_mem->locks_, recordNum, multiProcess, seed, nthreads);
     return db_mem;
 }
 
+/*
+ * Map 'size' bytes of anonymous memory that child processes share.
+ *
+ * With 'hugePages', the memory comes from the huge page pool (MAP_HUGETLB)
+ * if the administrator has reserved enough huge pages, and the kernel is
+ * otherwise asked to use transparent huge pages for the range
+ * (MADV_HUGEPAGE). Either way a random 1000-byte record access costs one
+ * TLB entry per 2MB instead of per 4KB.
+ */
+void *Database::MapRegion(size_t size, bool hugePages)
+{
+    void *mem = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    if (hugePages) mem = mmap(NULL, size, PROT_FLAGS, MAP_FLAGS | MAP_HUGETLB, -1, 0);
+#endif
+    if (mem == MAP_FAILED) mem = mmap(NULL, size, PROT_FLAGS, MAP_FLAGS, -1, 0);
+    assert(mem != MAP_FAILED);
+
+#ifdef MADV_HUGEPAGE
+    if (hugePages) madvise(mem, size, MADV_HUGEPAGE);
+#endif
+    return mem;
+}
+
+/* Initialize records [begin, end) and/or their locks */
+void Database::PopulateRange(void *arg, uint64_t begin, uint64_t end)
+{
+    populate_args *args = (populate_args *)arg;
+    uint64_t i;
+    uint32_t j, nfields;
+
+    nfields = RECORD_SIZE / FIELD_SIZE;
+    for (i = begin; i < end; ++i)
+    {
+        if (args->locks_ != NULL) pthread_mutex_init(&args->locks_[i], args->mutexattr_);
+        if (args->records_ == NULL) continue;
+        InitRecord(args->records_[i].bytes_, args->seed_, i);
+
+        /* Move the hot words out, leaving zeros in the cold record. */
+        if (args->hot_ == NULL) continue;
+        for (j = 0; j < nfields; ++j)
+        {
+            memcpy(&args->hot_[i * HOT_WORDS + j], &args->records_[i].bytes_[j * FIELD_SIZE], sizeof(uint64_t));
+            memset(&args->records_[i].bytes_[j * FIELD_SIZE], 0, sizeof(uint64_t));
+        }
+    }
+}
+
+/*
+ * Initialize 'records' (unless NULL) from 'seed', splitting their hot words
+ * out into 'hot' unless it is NULL, and 'locks' (unless NULL)
+ * on 'nthreads' threads. Record contents depend only on the seed and the
+ * record's index, not on how the work is split.
+ *
+ * Locks used across processes must be process-shared; between threads, the
+ * default attributes do.
+ */
+void Database::Populate(Record *records, uint64_t *hot, pthread_mutex_t *locks, uint32_t recordNum,
+                        bool multiProcess, uint64_t seed, uint32_t nthreads)
+{
+    pthread_mutexattr_t mutexattr;
+    populate_args args;
+
+    pthread_mutexattr_init(&mutexattr);
+    if (multiProcess) pthread_mutexattr_setpshared(&mutexattr, PTHREAD_PROCESS_SHARED);
+    args.records_   = records;
+    args.hot_       = hot;
+    args.locks_     = locks;
+    args.mutexattr_ = &mutexattr;
+    args.seed_      = seed;
+    parallel_for(nthreads, recordNum, PopulateRange, &args);
+    pthread_mutexattr_destroy(&mutexattr);
+}
+
+/*
+ * Set up 'lockStripes' lock stripes (none if 0) in memory that child
+ * processes share. At a cache line each, a few thousand stripes take less
+ * memory than a mutex for each of millions of records, and stay cached.
+ */
+void Database::InitStripes(uint32_t lockStripes, bool multiProcess)
+{
+    pthread_rwlockattr_t rwlockattr;
+    uint32_t i;
+
+    num_stripes_ = lockStripes;
+    stripes_     = NULL;
+    if (lockStripes == 0) return;
+
+    stripes_ = (LockStripe *)mmap(NULL, sizeof(LockStripe) * lockStripes, PROT_FLAGS, MAP_FLAGS, 0, 0);
+    assert(stripes_ != MAP_FAILED);
+    pthread_rwlockattr_init(&rwlockattr);
+    if (multiProcess) pthread_rwlockattr_setpshared(&rwlockattr, PTHREAD_PROCESS_SHARED);
+    for (i = 0; i < lockStripes; ++i) pthread_rwlock_init(&stripes_[i].lock_, &rwlockattr);
+    pthread_rwlockattr_destroy(&rwlockattr);
+}
+
 /*
  * Dispose of the memory associated with the Database.
  */
@@ -112,25 +350,40 @@ void Database::Destroy(Database *db)
     int err;
 
     /* OS needs to be explicitly notified of semaphores */
-    for (i = 0; i < db->num_records_; ++i)
+    for (i = 0; db->locks_ != NULL && i < db->num_records_; ++i)
     {
         pthread_mutex_destroy(&db->locks_[i]);
     }
+    if (db->stripes_ != NULL)
+    {
+        for (i = 0; i < db->num_stripes_; ++i) pthread_rwlock_destroy(&db->stripes_[i].lock_);
+        err = munmap(db->stripes_, sizeof(LockStripe) * db->num_stripes_);
+        assert(err == 0);
+    }
 
-    err = munmap(db->locks_, sizeof(sem_t) * db->num_records_);
-    assert(err == 0);
-    err = munmap(db->records_, sizeof(Record) * db->num_records_);
+    if (db->locks_ != NULL)
+    {
+        err = munmap(db->locks_, sizeof(pthread_mutex_t) * db->num_records_);
+        assert(err == 0);
+    }
+    err = munmap(db->records_, AnonSize(sizeof(Record) * db->num_records_, db->huge_pages_));
     assert(err == 0);
+    if (db->hot_ != NULL)
+    {
+        err = munmap(db->hot_, AnonSize(HotSize(db->num_records_, db->layout_), db->huge_pages_));
+        assert(err == 0);
+    }
     err = munmap(db, sizeof(Database));
     assert(err == 0);
 }
 
 /*
- * Initialize a buffer corresponding to a single Record.
+ * Initialize a buffer corresponding to the index'th Record.
  *
- * The buffer's size is RECORD_SIZE. Each field is of size FIELD_SIZE.
+ * The buffer's size is RECORD_SIZE. Each field is of size FIELD_SIZE, and
+ * starts with a number from the counter-based stream named by 'seed'.
  */
-void Database::InitRecord(char *buf)
+void Database::InitRecord(char *buf, uint64_t seed, uint64_t index)
 {
     uint32_t i, nfields;
     uint64_t *field_ptr;
@@ -139,27 +392,93 @@ void Database::InitRecord(char *buf)
     for (i = 0; i < nfields; ++i)
     {
         field_ptr  = (uint64_t *)(&buf[FIELD_SIZE * i]);
-        *field_ptr = (uint64_t)rand();
+        *field_ptr = counter_rand(seed, index * nfields + i);
     }
 }
 
 /*
- * Obtain mutually exclusive access to a Record. Recall that each Record's
- * semaphore is initialized to 1. Thus, only a single process/thread at a time
- * is allowed to obtain the semaphore.
+ * Obtain mutually exclusive access to a Record, by taking the lock covering
+ * it exclusively. Only a single process/thread at a time holds it.
  */
-void Database::LockRecord(uint64_t key)
+void Database::LockRecord(uint64_t key) { Lock(LockId(key), false); }
+
+/* Relinquish mutually exclusive access to a Record. */
+void Database::UnlockRecord(uint64_t key) { Unlock(LockId(key)); }
+
+/* Return the id of the lock covering a record */
+uint64_t Database::LockId(uint64_t key)
 {
     assert(key < (uint64_t)num_records_);
-    pthread_mutex_lock(&locks_[key]);
+    if (stripes_ == NULL) return key;
+    return mix64(key) % num_stripes_;
 }
 
-/* Relinquish mutually exclusive access to a Record. */
-void Database::UnlockRecord(uint64_t key)
+void Database::Lock(uint64_t lockId, bool shared)
 {
-    assert(key < (uint64_t)num_records_);
-    pthread_mutex_unlock(&locks_[key]);
+    if (stripes_ == NULL)
+        pthread_mutex_lock(&locks_[lockId]);
+    else if (shared)
+        pthread_rwlock_rdlock(&stripes_[lockId].lock_);
+    else
+        pthread_rwlock_wrlock(&stripes_[lockId].lock_);
+}
+
+bool Database::TryLock(uint64_t lockId, bool shared)
+{
+    if (stripes_ == NULL)
+        return pthread_mutex_trylock(&locks_[lockId]) == 0;
+    else if (shared)
+        return pthread_rwlock_tryrdlock(&stripes_[lockId].lock_) == 0;
+    else
+        return pthread_rwlock_trywrlock(&stripes_[lockId].lock_) == 0;
+}
+
+void Database::Unlock(uint64_t lockId)
+{
+    if (stripes_ == NULL)
+        pthread_mutex_unlock(&locks_[lockId]);
+    else
+        pthread_rwlock_unlock(&stripes_[lockId].lock_);
 }
 
 /* Return a reference to a record */
-Record *Database::GetRecord(uint64_t key) { return &records_[key]; }
+Record *Database::GetRecord(uint64_t key)
+{
+    assert(layout_ == LAYOUT_ROW);
+    return &records_[key];
+}
+
+/* Return a reference to a record's hot words */
+uint64_t *Database::HotWords(uint64_t key)
+{
+    assert(layout_ == LAYOUT_PACKED);
+    return &hot_[key * HOT_WORDS];
+}
+
+/* Copy a record out, putting its hot words back into their fields */
+void Database::ReadRecord(uint64_t key, Record *rec)
+{
+    uint32_t i, nfields;
+
+    assert(key < (uint64_t)num_records_);
+    memcpy(rec->bytes_, records_[key].bytes_, RECORD_SIZE);
+    if (layout_ == LAYOUT_ROW) return;
+    nfields = RECORD_SIZE / FIELD_SIZE;
+    for (i = 0; i < nfields; ++i) memcpy(&rec->bytes_[i * FIELD_SIZE], &hot_[key * HOT_WORDS + i], sizeof(uint64_t));
+}
+
+/* Overwrite a record, splitting its hot words out */
+void Database::WriteRecord(uint64_t key, const Record *rec)
+{
+    uint32_t i, nfields;
+
+    assert(key < (uint64_t)num_records_);
+    memcpy(records_[key].bytes_, rec->bytes_, RECORD_SIZE);
+    if (layout_ == LAYOUT_ROW) return;
+    nfields = RECORD_SIZE / FIELD_SIZE;
+    for (i = 0; i < nfields; ++i)
+    {
+        memcpy(&hot_[key * HOT_WORDS + i], &rec->bytes_[i * FIELD_SIZE], sizeof(uint64_t));
+        memset(&records_[key].bytes_[i * FIELD_SIZE], 0, sizeof(uint64_t));
+    }
+}
@@ -0,0 +1,315 @@
+#include <fiber_launcher.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utils.h>
+#include <cassert>
+
+/* Polls of a full ring the launcher makes before it yields its core */
+#define FIBER_FULL_SPINS 16
+
+/*
+ * Save the callee-saved registers and stack pointer of the running context
+ * in *save_sp and resume the context saved at sp. A fresh fiber's stack is
+ * laid out by InitFiber so that it resumes in fiber_start with the fiber in
+ * rbx.
+ */
+extern "C" void fiber_switch(void **save_sp, void *sp);
+extern "C" void fiber_start();
+extern "C" void fiber_entry(fiber *f) { f->worker_->launcher_->FiberMain(f); }
+
+asm(".text\n"
+    ".globl fiber_switch\n"
+    ".type fiber_switch, @function\n"
+    "fiber_switch:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size fiber_switch, .-fiber_switch\n"
+    ".globl fiber_start\n"
+    ".type fiber_start, @function\n"
+    "fiber_start:\n"
+    "    movq %rbx, %rdi\n"
+    "    andq $-16, %rsp\n"
+    "    call fiber_entry\n"
+    "    ud2\n"
+    ".size fiber_start, .-fiber_start\n");
+
+/* Bytes from one fiber's guard page and stack to the next's */
+static size_t StackStride() { return FIBER_STACK_SZ + sysconf(_SC_PAGESIZE); }
+
+/* Lay out a fiber's stack as fiber_switch leaves a switched out context */
+static void InitFiber(fiber *f, fiber_worker *w, char *stack)
+{
+    uint64_t *sp;
+
+    sp    = (uint64_t *)(stack + FIBER_STACK_SZ);
+    *--sp = 0;                                /* fiber_start never returns */
+    *--sp = (uint64_t)(uintptr_t)fiber_start; /* where fiber_switch returns to */
+    *--sp = 0;                                /* rbp */
+    *--sp = (uint64_t)(uintptr_t)f;           /* rbx */
+    *--sp = 0;                                /* r12 */
+    *--sp = 0;                                /* r13 */
+    *--sp = 0;                                /* r14 */
+    *--sp = 0;                                /* r15 */
+
+    f->sp_     = sp;
+    f->req_    = NULL;
+    f->worker_ = w;
+    f->link_   = NULL;
+}
+
+FiberLauncher::FiberLauncher(uint32_t pool_sz, uint32_t max_outstanding) : Launcher(pool_sz)
+{
+    assert(pool_sz > 0 && max_outstanding > 0);
+    assert((FIBER_RING_SZ & (FIBER_RING_SZ - 1)) == 0);
+
+    fiber_worker *w;
+    uint32_t i;
+    int err;
+
+    pool_sz_     = pool_sz;
+    next_worker_ = 0;
+    stop_        = false;
+
+    workers_ = (fiber_worker *)malloc(sizeof(fiber_worker) * pool_sz);
+    assert(workers_ != NULL);
+    for (i = 0; i < pool_sz_; ++i)
+    {
+        w              = &workers_[i];
+        w->launcher_   = this;
+        w->id_         = i;
+        w->tail_       = 0;
+        w->wake_seq_   = 0;
+        w->head_       = 0;
+        w->parked_     = 0;
+        w->num_fibers_ = (max_outstanding + pool_sz - 1) / pool_sz;
+        w->fibers_     = NULL;
+        w->stacks_     = NULL;
+    }
+    for (i = 0; i < pool_sz_; ++i)
+    {
+        err = pthread_create(&workers_[i].thread_id_, NULL, FiberLauncher::ExecutorFunc, &workers_[i]);
+        assert(err == 0);
+    }
+}
+
+FiberLauncher::~FiberLauncher()
+{
+    fiber_worker *w;
+    uint32_t i;
+    int err;
+
+    __atomic_store_n(&stop_, true, __ATOMIC_SEQ_CST);
+    for (i = 0; i < pool_sz_; ++i)
+    {
+        __atomic_fetch_add(&workers_[i].wake_seq_, 1, __ATOMIC_SEQ_CST);
+        futex_wake(&workers_[i].wake_seq_, INT_MAX);
+    }
+    for (i = 0; i < pool_sz_; ++i)
+    {
+        w = &workers_[i];
+        pthread_join(w->thread_id_, NULL);
+        err = munmap(w->stacks_, StackStride() * w->num_fibers_);
+        assert(err == 0);
+        free(w->fibers_);
+    }
+    free(workers_);
+}
+
+/*
+ * Publish a request into the next worker's ring, waiting for the worker to
+ * take some if the ring is full, and wake the worker if it is parked.
+ */
+void FiberLauncher::ExecuteRequest(Request *req)
+{
+    fiber_worker *w;
+    uint64_t pos;
+    uint32_t spins;
+
+    Launcher::ExecuteRequest(req);
+
+    w            = &workers_[next_worker_];
+    next_worker_ = (next_worker_ + 1) % pool_sz_;
+
+    pos = w->tail_;
+    for (spins = 0; pos - __atomic_load_n(&w->head_, __ATOMIC_ACQUIRE) >= FIBER_RING_SZ; ++spins)
+    {
+        if (spins < FIBER_FULL_SPINS)
+            asm volatile("pause;" :::);
+        else
+            sched_yield();
+    }
+    w->ring_[pos & (FIBER_RING_SZ - 1)] = req;
+    __atomic_store_n(&w->tail_, pos + 1, __ATOMIC_SEQ_CST);
+
+    /* Pairs with Park: either it sees the request, or we see it parked. */
+    if (__atomic_load_n(&w->parked_, __ATOMIC_SEQ_CST) != 0)
+    {
+        __atomic_fetch_add(&w->wake_seq_, 1, __ATOMIC_SEQ_CST);
+        futex_wake(&w->wake_seq_, 1);
+    }
+}
+
+uint32_t FiberLauncher::Admit(fiber_worker *w)
+{
+    uint64_t pos, tail;
+    uint32_t n;
+    fiber *f;
+
+    pos  = w->head_;
+    tail = __atomic_load_n(&w->tail_, __ATOMIC_ACQUIRE);
+    for (n = 0; w->idle_ != NULL && pos != tail; ++n, ++pos)
+    {
+        f        = w->idle_;
+        w->idle_ = f->link_;
+        f->req_  = w->ring_[pos & (FIBER_RING_SZ - 1)];
+        f->link_ = NULL;
+        if (w->ready_tail_ == NULL)
+            w->ready_head_ = f;
+        else
+            w->ready_tail_->link_ = f;
+        w->ready_tail_ = f;
+        ++w->num_ready_;
+    }
+    if (n > 0) __atomic_store_n(&w->head_, pos, __ATOMIC_RELEASE);
+    return n;
+}
+
+/* Sleep until the launcher publishes a request or shuts down */
+void FiberLauncher::Park(fiber_worker *w)
+{
+    uint32_t seq;
+
+    __atomic_store_n(&w->parked_, 1, __ATOMIC_SEQ_CST);
+    seq = __atomic_load_n(&w->wake_seq_, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&w->tail_, __ATOMIC_SEQ_CST) == w->head_ && !__atomic_load_n(&stop_, __ATOMIC_SEQ_CST))
+    {
+        futex_wait(&w->wake_seq_, seq);
+    }
+    __atomic_store_n(&w->parked_, 0, __ATOMIC_SEQ_CST);
+}
+
+void FiberLauncher::Run(fiber_worker *w)
+{
+    uint32_t started, n, yielded, polls, i;
+    char *guard;
+    fiber *f;
+    int err;
+
+    /* Fibers and their stacks are the worker's own, allocated by its thread. */
+    w->fibers_ = (fiber *)malloc(sizeof(fiber) * w->num_fibers_);
+    assert(w->fibers_ != NULL);
+    w->stacks_ = (char *)mmap(NULL, StackStride() * w->num_fibers_, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(w->stacks_ != MAP_FAILED);
+    w->idle_ = NULL;
+    for (i = w->num_fibers_; i > 0; --i)
+    {
+        guard = &w->stacks_[StackStride() * (i - 1)];
+        err   = mprotect(guard, StackStride() - FIBER_STACK_SZ, PROT_NONE);
+        assert(err == 0);
+        InitFiber(&w->fibers_[i - 1], w, guard + StackStride() - FIBER_STACK_SZ);
+        w->fibers_[i - 1].link_ = w->idle_;
+        w->idle_                = &w->fibers_[i - 1];
+    }
+    w->ready_head_ = NULL;
+    w->ready_tail_ = NULL;
+    w->num_ready_  = 0;
+
+    polls = 0;
+    while (!__atomic_load_n(&stop_, __ATOMIC_ACQUIRE))
+    {
+        started = Admit(w);
+
+        /* One round of the ready fibers: done ones go idle, the rest to the back. */
+        n       = w->num_ready_;
+        yielded = 0;
+        for (i = 0; i < n; ++i)
+        {
+            f              = w->ready_head_;
+            w->ready_head_ = f->link_;
+            if (w->ready_head_ == NULL) w->ready_tail_ = NULL;
+            --w->num_ready_;
+
+            fiber_switch(&w->sp_, f->sp_);
+
+            if (f->req_ == NULL)
+            {
+                f->link_ = w->idle_;
+                w->idle_ = f;
+                continue;
+            }
+            ++yielded;
+            f->link_ = NULL;
+            if (w->ready_tail_ == NULL)
+                w->ready_head_ = f;
+            else
+                w->ready_tail_->link_ = f;
+            w->ready_tail_ = f;
+            ++w->num_ready_;
+        }
+
+        /* Every fiber waits on a lock another thread holds: let it run. */
+        if (n > 0 && yielded == n && started == 0)
+        {
+            sched_yield();
+        }
+        else if (n > 0 || started > 0)
+        {
+            polls = 0;
+        }
+        else if (++polls < FIBER_SPINS)
+        {
+            asm volatile("pause;" :::);
+        }
+        else
+        {
+            polls = 0;
+            Park(w);
+        }
+    }
+}
+
+void FiberLauncher::FiberMain(fiber *f)
+{
+    while (true)
+    {
+        f->req_->Execute(FiberLauncher::Yield, f);
+        f->req_ = NULL;
+        AddDoneTxns(DoneCounter(f->worker_->id_), 1);
+        fiber_switch(&f->sp_, f->worker_->sp_);
+    }
+}
+
+/* Switch back to the worker, which resumes the fiber on its next round */
+void FiberLauncher::Yield(void *arg)
+{
+    fiber *f;
+
+    f = (fiber *)arg;
+    fiber_switch(&f->sp_, f->worker_->sp_);
+}
+
+void *FiberLauncher::ExecutorFunc(void *arg)
+{
+    fiber_worker *w;
+
+    w = (fiber_worker *)arg;
+    w->launcher_->Run(w);
+    return NULL;
+}
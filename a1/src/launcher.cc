@@ -5,39 +5,48 @@
 #include <utils.h>
 #include <cassert>
 
-Launcher::Launcher()
+Launcher::Launcher(uint32_t num_counters)
 {
-    txns_executed_ = (volatile uint64_t *)mmap(NULL, CACHE_LINE_SZ, PROT_FLAGS, MAP_FLAGS, 0, 0);
+    assert(sizeof(txn_counter) == CACHE_LINE_SZ);
+    if (num_counters == 0) num_counters = 1;
+    num_counters_  = num_counters;
+    txns_executed_ = (txn_counter *)mmap(NULL, sizeof(txn_counter) * num_counters, PROT_FLAGS, MAP_FLAGS, 0, 0);
     assert((void *)txns_executed_ != MAP_FAILED);
-    memset((void *)txns_executed_, 0x0, CACHE_LINE_SZ);
-    assert(*txns_executed_ == 0);
+    memset((void *)txns_executed_, 0x0, sizeof(txn_counter) * num_counters);
+    assert(txns_executed_[0].executed_ == 0);
     _num_requests = 0;
 }
 
 Launcher::~Launcher()
 {
     int err;
-    err = munmap((void *)txns_executed_, CACHE_LINE_SZ);
+    err = munmap((void *)txns_executed_, sizeof(txn_counter) * num_counters_);
     assert(err == 0);
 }
 
 uint64_t Launcher::ReadTxnsExecuted()
 {
     uint64_t num_executed;
-    barrier();
-    num_executed = *txns_executed_;
-    barrier();
+    uint32_t i;
+
+    num_executed = 0;
+    for (i = 0; i < num_counters_; ++i) num_executed += __atomic_load_n(&txns_executed_[i].executed_, __ATOMIC_ACQUIRE);
     return num_executed;
 }
 
 void Launcher::IncrDoneTxns(volatile uint64_t *done_ptr) { fetch_and_increment(done_ptr); }
+void Launcher::AddDoneTxns(volatile uint64_t *done_ptr, uint64_t n)
+{
+    __atomic_store_n(done_ptr, *done_ptr + n, __ATOMIC_RELEASE);
+}
 void Launcher::ExecuteRequest(__attribute__((unused)) Request *req) { _num_requests += 1; }
+double Launcher::SpawnNs() { return 0; }
 void Launcher::WaitOutstanding()
 {
     while (true)
     {
         barrier();
-        if (*txns_executed_ == _num_requests) break;
+        if (ReadTxnsExecuted() == _num_requests) break;
         barrier();
         asm volatile("pause;" :::);
     }
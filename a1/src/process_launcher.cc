@@ -9,7 +9,7 @@
 #include <cstdlib>
 #include <iostream>
 
-ProcessLauncher::ProcessLauncher(int max_outstanding) : Launcher()
+ProcessLauncher::ProcessLauncher(int max_outstanding) : Launcher(max_outstanding)
 {
     assert(max_outstanding < INT_MAX && max_outstanding > 0);
 
@@ -52,6 +52,9 @@ ProcessLauncher::ProcessLauncher(int max_outstanding) : Launcher()
     pthread_condattr_init(&condattr);
     pthread_condattr_setpshared(&condattr, PTHREAD_PROCESS_SHARED);
     pthread_cond_init(done_cond_, &condattr);
+
+    spawn_ns_ = 0;
+    spawns_   = 0;
 }
 
 ProcessLauncher::~ProcessLauncher()
@@ -73,6 +76,7 @@ void ProcessLauncher::ExecuteRequest(Request *req)
 {
     /* Child process identifier */
     pid_t pid;
+    double start;
 
     /*
      * Track the number of requests issued. launcher::ExecuteRequest is
@@ -88,6 +92,7 @@ void ProcessLauncher::ExecuteRequest(Request *req)
      * fork() returns a non-zero pid to the parent process (the code-path
      * corresponding to the "else" branch).
      */
+    start = now_seconds();
     if ((pid = fork()) == 0)
     { /* This code is executed in the child */
 
@@ -98,8 +103,11 @@ void ProcessLauncher::ExecuteRequest(Request *req)
          */
         req->Execute();
 
-        /* Atomically increment the number of executed transactions */
-        fetch_and_increment(this->txns_executed_);
+        /*
+         * Atomically increment the number of executed transactions, in
+         * the shard for this request's slot among the outstanding ones
+         */
+        fetch_and_increment(DoneCounter(_num_requests));
 
         /*
          * Increment the value of max_outstanding_, which tells the
@@ -120,6 +128,8 @@ void ProcessLauncher::ExecuteRequest(Request *req)
          * negative pid on an error.
          */
         assert(pid != -1);
+        spawn_ns_ += (now_seconds() - start) * 1e9;
+        ++spawns_;
 
         /*
          * Wait until the value of max_outstanding_ is greater than
@@ -136,3 +146,6 @@ void ProcessLauncher::ExecuteRequest(Request *req)
         pthread_mutex_unlock(done_mutex_);
     }
 }
+
+/* Average ns the launcher spends forking a child */
+double ProcessLauncher::SpawnNs() { return spawns_ == 0 ? 0 : spawn_ns_ / spawns_; }
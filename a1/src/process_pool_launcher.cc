@@ -6,7 +6,7 @@
 #include <cassert>
 #include <iostream>
 
-ProcessPoolLauncher::ProcessPoolLauncher(uint32_t nprocs) : Launcher()
+ProcessPoolLauncher::ProcessPoolLauncher(uint32_t nprocs) : Launcher(nprocs)
 {
     uint32_t i;
     char *req_bufs;
@@ -88,7 +88,7 @@ ProcessPoolLauncher::ProcessPoolLauncher(uint32_t nprocs) : Launcher()
         pstates[i].proc_mutex_     = &proc_mutexs[i];
         pstates[i].proc_cond_      = &proc_condis[i];
         pstates[i].launcher_state_ = launcher_state_;
-        pstates[i].txns_executed_  = txns_executed_;
+        pstates[i].txns_executed_  = DoneCounter(i);
         pstates[i].list_ptr_       = &pstates[i + 1];
     }
     pstates[i - 1].list_ptr_    = NULL;
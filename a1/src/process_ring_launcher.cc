@@ -0,0 +1,187 @@
+#include <limits.h>
+#include <process_ring_launcher.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <utils.h>
+#include <cassert>
+
+/* Empty polls of the ring before an idle pool process parks */
+#define PROC_SPINS 1024
+
+ProcessRingLauncher::ProcessRingLauncher(uint32_t pool_sz, bool pin) : Launcher(pool_sz)
+{
+    assert(pool_sz > 0);
+    assert((PROC_RING_SZ & (PROC_RING_SZ - 1)) == 0);
+
+    uint32_t i;
+    pid_t pid;
+
+    pool_sz_ = pool_sz;
+
+    /* Everything the pool touches is mapped shared before forking. */
+    ctl_ = (proc_ring_ctl *)mmap(NULL, sizeof(proc_ring_ctl), PROT_FLAGS, MAP_FLAGS, 0, 0);
+    assert(ctl_ != MAP_FAILED);
+    memset((void *)ctl_, 0x0, sizeof(proc_ring_ctl));
+
+    ring_ = (proc_ring_slot *)mmap(NULL, sizeof(proc_ring_slot) * PROC_RING_SZ, PROT_FLAGS, MAP_FLAGS, 0, 0);
+    assert(ring_ != MAP_FAILED);
+    for (i = 0; i < PROC_RING_SZ; ++i) ring_[i].seq_ = i;
+
+    pids_ = (pid_t *)malloc(sizeof(pid_t) * pool_sz);
+    for (i = 0; i < pool_sz; ++i)
+    {
+        pid = fork();
+        assert(pid >= 0);
+        if (pid == 0) ExecutorFunc(i, pin);
+        pids_[i] = pid;
+    }
+}
+
+ProcessRingLauncher::~ProcessRingLauncher()
+{
+    uint32_t i;
+    int err;
+
+    __atomic_store_n(&ctl_->stop_, 1, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&ctl_->wake_seq_, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&ctl_->wake_seq_, INT_MAX);
+
+    /* Children may already be reaped if SIGCHLD is ignored. */
+    for (i = 0; i < pool_sz_; ++i) waitpid(pids_[i], NULL, 0);
+    free(pids_);
+
+    err = munmap((void *)ring_, sizeof(proc_ring_slot) * PROC_RING_SZ);
+    assert(err == 0);
+    err = munmap((void *)ctl_, sizeof(proc_ring_ctl));
+    assert(err == 0);
+}
+
+/*
+ * Serialize a request into the next slot, waiting for the pool to free it
+ * if the ring is full, publish it, and wake a pool process if any is parked.
+ */
+void ProcessRingLauncher::ExecuteRequest(Request *req)
+{
+    proc_ring_slot *slot;
+    uint64_t pos;
+    uint32_t spins;
+
+    Launcher::ExecuteRequest(req);
+    assert(Request::CopySize(req) <= RQST_BUF_SZ);
+
+    pos  = ctl_->tail_;
+    slot = &ring_[pos & (PROC_RING_SZ - 1)];
+    for (spins = 0; __atomic_load_n(&slot->seq_, __ATOMIC_ACQUIRE) != pos; ++spins)
+    {
+        if (spins < PROC_SPINS)
+            asm volatile("pause;" :::);
+        else
+            sched_yield();
+    }
+    Request::CopyRequest(slot->req_, req);
+    __atomic_store_n(&slot->seq_, pos + 1, __ATOMIC_SEQ_CST);
+    ctl_->tail_ = pos + 1;
+
+    /* Pairs with Park: either it sees the slot, or we see the sleeper. */
+    if (__atomic_load_n(&ctl_->sleepers_, __ATOMIC_SEQ_CST) > 0)
+    {
+        __atomic_fetch_add(&ctl_->wake_seq_, 1, __ATOMIC_SEQ_CST);
+        futex_wake(&ctl_->wake_seq_, 1);
+    }
+}
+
+uint32_t ProcessRingLauncher::Claim(uint64_t *first)
+{
+    uint64_t pos;
+    uint32_t n;
+
+    while (true)
+    {
+        pos = __atomic_load_n(&ctl_->head_, __ATOMIC_ACQUIRE);
+        for (n = 0; n < PROC_RING_BATCH; ++n)
+        {
+            if (__atomic_load_n(&ring_[(pos + n) & (PROC_RING_SZ - 1)].seq_, __ATOMIC_ACQUIRE) != pos + n + 1) break;
+        }
+        if (n == 0) return 0;
+        if (__atomic_compare_exchange_n(&ctl_->head_, &pos, pos + n, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            *first = pos;
+            return n;
+        }
+    }
+}
+
+/* Sleep until the launcher publishes a request or shuts down */
+void ProcessRingLauncher::Park()
+{
+    uint32_t seq;
+    uint64_t pos;
+
+    __atomic_fetch_add(&ctl_->sleepers_, 1, __ATOMIC_SEQ_CST);
+    seq = __atomic_load_n(&ctl_->wake_seq_, __ATOMIC_SEQ_CST);
+    pos = __atomic_load_n(&ctl_->head_, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring_[pos & (PROC_RING_SZ - 1)].seq_, __ATOMIC_SEQ_CST) != pos + 1 &&
+        __atomic_load_n(&ctl_->stop_, __ATOMIC_SEQ_CST) == 0)
+    {
+        futex_wait(&ctl_->wake_seq_, seq);
+    }
+    __atomic_fetch_sub(&ctl_->sleepers_, 1, __ATOMIC_SEQ_CST);
+}
+
+void ProcessRingLauncher::ExecutorFunc(uint32_t id, bool pin)
+{
+    proc_ring_slot *slot;
+    uint64_t first;
+    uint32_t n, i, polls, spins;
+    cpu_set_t cpus;
+    int err;
+
+    /* Die with the launcher process rather than park on the ring forever. */
+    err = prctl(PR_SET_PDEATHSIG, SIGKILL);
+    assert(err == 0);
+    if (getppid() == 1) _exit(0);
+
+    if (pin)
+    {
+        CPU_ZERO(&cpus);
+        CPU_SET(id % num_cpus(), &cpus);
+        sched_setaffinity(0, sizeof(cpus), &cpus);
+    }
+
+    /* Spinning only pays off if no other pool process wants this core. */
+    spins = (pool_sz_ <= num_cpus()) ? PROC_SPINS : 1;
+    polls = 0;
+    while (__atomic_load_n(&ctl_->stop_, __ATOMIC_ACQUIRE) == 0)
+    {
+        n = Claim(&first);
+        if (n == 0)
+        {
+            if (++polls < spins)
+            {
+                asm volatile("pause;" :::);
+            }
+            else
+            {
+                polls = 0;
+                Park();
+            }
+            continue;
+        }
+
+        /* Run the requests in place, freeing each slot once it is done. */
+        polls = 0;
+        for (i = 0; i < n; ++i)
+        {
+            slot = &ring_[(first + i) & (PROC_RING_SZ - 1)];
+            ((Request *)slot->req_)->Execute();
+            __atomic_store_n(&slot->seq_, first + i + PROC_RING_SZ, __ATOMIC_RELEASE);
+        }
+        AddDoneTxns(DoneCounter(id), n);
+    }
+    _exit(0);
+}
@@ -1,3 +1,4 @@
+#include <immintrin.h>
 #include <request.h>
 #include <string.h>
 #include <algorithm>
@@ -5,12 +6,14 @@
 
 #define ROUNDUP(n, v) ((n)-1 + (v) - ((n)-1) % (v))
 
-Request::Request(Database *db, uint32_t nwrites, uint64_t *writeset, uint64_t *updates)
+Request::Request(Database *db, uint32_t nwrites, uint64_t *writeset, uint64_t *updates, bool readOnly)
 {
     db_         = db;
     num_writes_ = nwrites;
     writeset_   = writeset;
     updates_    = updates;
+    read_only_  = readOnly;
+    checksum_   = 0;
 }
 
 void Request::SetDatabase(Database *db) { db_ = db; }
@@ -53,7 +56,13 @@ void Request::CopyRequest(char *buf, Request *req)
     buf_req->updates_ = array_ptr;
 }
 
-void Request::DoWrite(char *Record, uint64_t *updates)
+/*
+ * Update kernels. A record's fields are FIELD_SIZE (100) bytes apart, so the
+ * ten words to update are spread over the record, and every other one is
+ * only 4-byte aligned. The vector kernels gather the words by byte offset,
+ * add the updates in one instruction, and put the words back.
+ */
+static void DoWriteScalar(char *record, const uint64_t *updates)
 {
     uint32_t nfields, i;
     uint64_t *rec_ptr;
@@ -61,14 +70,95 @@ void Request::DoWrite(char *Record, uint64_t *updates)
     nfields = RECORD_SIZE / FIELD_SIZE;
     for (i = 0; i < nfields; ++i)
     {
-        rec_ptr = (uint64_t *)(&Record[i * FIELD_SIZE]);
+        rec_ptr = (uint64_t *)(&record[i * FIELD_SIZE]);
         *rec_ptr += updates[i];
     }
 }
 
-void Request::Execute()
+/* AVX2 can gather but not scatter: stores go out one lane at a time. */
+__attribute__((target("avx2"))) static void DoWriteAVX2(char *record, const uint64_t *updates)
 {
-    LockRecords();
+    const __m256i offsets = _mm256_set_epi64x(3 * FIELD_SIZE, 2 * FIELD_SIZE, FIELD_SIZE, 0);
+    uint32_t nfields, i;
+    __m256i words;
+
+    nfields = RECORD_SIZE / FIELD_SIZE;
+    for (i = 0; i + 4 <= nfields; i += 4)
+    {
+        char *base = &record[i * FIELD_SIZE];
+        words      = _mm256_i64gather_epi64((const long long *)base, offsets, 1);
+        words      = _mm256_add_epi64(words, _mm256_loadu_si256((const __m256i *)&updates[i]));
+        *(uint64_t *)(base)                  = _mm256_extract_epi64(words, 0);
+        *(uint64_t *)(base + FIELD_SIZE)     = _mm256_extract_epi64(words, 1);
+        *(uint64_t *)(base + 2 * FIELD_SIZE) = _mm256_extract_epi64(words, 2);
+        *(uint64_t *)(base + 3 * FIELD_SIZE) = _mm256_extract_epi64(words, 3);
+    }
+    for (; i < nfields; ++i) *(uint64_t *)(&record[i * FIELD_SIZE]) += updates[i];
+}
+
+__attribute__((target("avx512f"))) static void DoWriteAVX512(char *record, const uint64_t *updates)
+{
+    const __m512i offsets = _mm512_set_epi64(7 * FIELD_SIZE, 6 * FIELD_SIZE, 5 * FIELD_SIZE, 4 * FIELD_SIZE,
+                                             3 * FIELD_SIZE, 2 * FIELD_SIZE, FIELD_SIZE, 0);
+    uint32_t nfields, i;
+    __m512i words;
+
+    nfields = RECORD_SIZE / FIELD_SIZE;
+    for (i = 0; i + 8 <= nfields; i += 8)
+    {
+        char *base = &record[i * FIELD_SIZE];
+        words      = _mm512_mask_i64gather_epi64(_mm512_setzero_si512(), 0xff, offsets, base, 1);
+        words      = _mm512_add_epi64(words, _mm512_loadu_si512(&updates[i]));
+        _mm512_i64scatter_epi64(base, offsets, words, 1);
+    }
+    for (; i < nfields; ++i) *(uint64_t *)(&record[i * FIELD_SIZE]) += updates[i];
+}
+
+static void (*const kernels[NUM_KERNELS])(char *, const uint64_t *) = {DoWriteScalar, DoWriteAVX2, DoWriteAVX512};
+static const char *const kernel_names[NUM_KERNELS] = {"scalar", "avx2", "avx512"};
+
+/* Pick the fastest kernel the CPU supports, once, before main runs. */
+static void (*BestKernel())(char *, const uint64_t *)
+{
+    int k;
+    for (k = NUM_KERNELS - 1; k > KERNEL_SCALAR && !Request::KernelSupported((write_kernel)k); --k)
+    {
+    }
+    return kernels[k];
+}
+
+void (*Request::write_fn_)(char *record, const uint64_t *updates) = BestKernel();
+
+bool Request::KernelSupported(write_kernel k)
+{
+    __builtin_cpu_init();
+    switch (k)
+    {
+        case KERNEL_SCALAR:
+            return true;
+        case KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case KERNEL_AVX512:
+            return __builtin_cpu_supports("avx512f");
+        default:
+            return false;
+    }
+}
+
+bool Request::SelectKernel(write_kernel k)
+{
+    if (!KernelSupported(k)) return false;
+    write_fn_ = kernels[k];
+    return true;
+}
+
+const char *Request::KernelName(write_kernel k) { return kernel_names[k]; }
+
+void Request::Execute() { Execute(NULL, NULL); }
+
+void Request::Execute(lock_wait_fn wait, void *wait_arg)
+{
+    LockRecords(wait, wait_arg);
     Txn();
     UnlockRecords();
 }
@@ -77,24 +167,61 @@ void Request::Txn()
 {
     assert(RECORD_SIZE % FIELD_SIZE == 0);
     uint32_t i;
-    Record *rec;
 
     for (i = 0; i < num_writes_; ++i)
     {
         if (i > 0) assert(writeset_[i - 1] != writeset_[i]);
-        rec = db_->GetRecord(writeset_[i]);
-        Request::DoWrite(rec->bytes_, updates_);
+        if (read_only_)
+            checksum_ += Request::SumRecord(db_, writeset_[i]);
+        else
+            Request::UpdateRecord(db_, writeset_[i], updates_);
     }
 }
 
-void Request::LockRecords()
+/* Orders keys by the lock covering them, then by key */
+struct lock_order
+{
+    Database *db_;
+    bool operator()(uint64_t a, uint64_t b) const
+    {
+        uint64_t lock_a = db_->LockId(a), lock_b = db_->LockId(b);
+        return lock_a < lock_b || (lock_a == lock_b && a < b);
+    }
+};
+
+void Request::LockRecords(lock_wait_fn wait, void *wait_arg)
 {
-    /* TODO: why you need to sort locks here? */
-    std::sort(writeset_, &writeset_[num_writes_]);
-    for (uint32_t i = 0; i < num_writes_; ++i) db_->LockRecord(writeset_[i]);
+    lock_order order = {db_};
+    uint64_t id, prev;
+    uint32_t i;
+
+    /* All requests lock in one global stripe order, so none can deadlock. */
+    std::sort(writeset_, &writeset_[num_writes_], order);
+
+    /* Keys sharing a lock stripe are adjacent now; take each lock once. */
+    prev = 0;
+    for (i = 0; i < num_writes_; ++i)
+    {
+        id = db_->LockId(writeset_[i]);
+        if (i > 0 && id == prev) continue;
+        if (wait == NULL)
+            db_->Lock(id, read_only_);
+        else
+            while (!db_->TryLock(id, read_only_)) wait(wait_arg);
+        prev = id;
+    }
 }
 
 void Request::UnlockRecords()
 {
-    for (uint32_t i = 0; i < num_writes_; ++i) db_->UnlockRecord(writeset_[i]);
+    uint64_t id, prev;
+    uint32_t i;
+
+    prev = 0;
+    for (i = 0; i < num_writes_; ++i)
+    {
+        id = db_->LockId(writeset_[i]);
+        if (i == 0 || id != prev) db_->Unlock(id);
+        prev = id;
+    }
 }
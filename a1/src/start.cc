@@ -1,77 +1,153 @@
 #include <config.h>
 #include <database.h>
+#include <fiber_launcher.h>
 #include <launcher.h>
+#include <linux/perf_event.h>
 #include <perf_monitor.h>
 #include <process_launcher.h>
 #include <process_pool_launcher.h>
+#include <process_ring_launcher.h>
 #include <request.h>
+#include <string.h>
+#include <sys/syscall.h>
 #include <thread_launcher.h>
 #include <thread_pool_launcher.h>
+#include <thread_ring_launcher.h>
 #include <unistd.h>
 #include <utils.h>
+#include <x86intrin.h>
+#include <zygote_launcher.h>
 #include <fstream>
 #include <iostream>
-#include <set>
+#include <new>
 
 #define TXN_SZ 50
 #define LOW_DATABASE_SZ 5000000
 #define HIGH_DATABASE_SZ 500
 #define DRY_RUN_SZ 1000
 #define NUM_REQS 2000000
+#define BENCH_DATABASE_SZ 500000
+#define BENCH_UPDATES 2000000
+#define BENCH_LAUNCHER_DATABASE_SZ 50000
+#define BENCH_LAUNCHER_REQS 100000
+#define BENCH_SPAWN_REQS 10000
+#define BENCH_LAUNCHER_SIZES 8 /* 1 to 128 */
+#define BENCH_FIBERS_MAX 4096
+#define BENCH_COUNTS 1000000
+#define BENCH_COUNTER_READS 100000
 
 const uint32_t rand_seed = 0xdeadbeef;
 const char *output_file  = "results.txt";
 
-uint64_t gen_unique(uint64_t max, std::set<uint64_t> *seen)
+/* Ways for bench_counters' workers to count */
+enum count_mode
+{
+    COUNT_SHARED = 0, /* locked increments of one counter */
+    COUNT_SHARDED,    /* locked increments of the worker's own shard */
+    COUNT_OWNED,      /* plain stores to the worker's own shard */
+    NUM_COUNT_MODES,
+};
+
+/* Arguments to count_range */
+struct count_args
+{
+    txn_counter *counters_;
+    count_mode mode_;
+};
+
+/* Arguments to generate_range */
+struct generate_args
+{
+    Database *db_;
+    uint64_t seed_;
+    Request *requests_; /* Request objects, in the arena */
+    uint64_t *keys_;    /* TXN_SZ keys per request, in the arena */
+    uint64_t *updates_; /* one update per field per request, in the arena */
+    uint32_t read_pct_;
+};
+
+/*
+ * Draw keys below max from the counter-based stream 'seed', starting at
+ * *counter, until one is not among the n keys in 'keys'.
+ */
+uint64_t gen_unique(uint64_t max, const uint64_t *keys, uint32_t n, uint64_t seed, uint64_t *counter)
 {
     uint64_t gen;
+    uint32_t i;
 
     while (true)
     {
-        gen = ((uint64_t)rand()) % max;
-        if (seen->count(gen) == 0)
+        gen = counter_rand(seed, (*counter)++) % max;
+        for (i = 0; i < n && keys[i] != gen; ++i)
         {
-            seen->insert(gen);
-            break;
         }
+        if (i == n) break;
     }
-    assert(seen->count(gen) > 0);
     assert(gen < max);
     return gen;
 }
 
-Request *generate_single_request(Database *db)
+/*
+ * Generate requests [begin, end). Request r draws its keys and updates from
+ * its own stream, so its contents depend only on the seed and r.
+ */
+void generate_range(void *arg, uint64_t begin, uint64_t end)
 {
-    std::set<uint64_t> seen_keys;
-    uint64_t *writeset, *updates;
+    generate_args *args = (generate_args *)arg;
+    uint64_t *writeset, *updates, counter, seed, r;
     uint32_t i, nfields;
-    Request *rqst;
+    bool read_only;
 
-    seen_keys.clear();
-    /* Generate writeset */
-    writeset = (uint64_t *)malloc(sizeof(uint64_t) * TXN_SZ);
-    for (i = 0; i < TXN_SZ; ++i)
+    nfields = RECORD_SIZE / FIELD_SIZE;
+    for (r = begin; r < end; ++r)
     {
-        writeset[i] = gen_unique(db->DBSize(), &seen_keys);
-    }
+        seed     = mix64(args->seed_) + r;
+        counter  = 0;
+        writeset = &args->keys_[r * TXN_SZ];
+        updates  = &args->updates_[r * nfields];
 
-    /* Generate updates */
-    nfields = RECORD_SIZE / FIELD_SIZE;
-    updates = (uint64_t *)malloc(sizeof(uint64_t) * nfields);
-    for (i = 0; i < nfields; ++i) updates[i] = (uint64_t)rand();
+        /* Generate writeset */
+        for (i = 0; i < TXN_SZ; ++i) writeset[i] = gen_unique(args->db_->DBSize(), writeset, i, seed, &counter);
+
+        /* Generate updates */
+        for (i = 0; i < nfields; ++i) updates[i] = counter_rand(seed, counter++);
 
-    /* Generate request */
-    rqst = new Request(db, TXN_SZ, writeset, updates);
-    return rqst;
+        /* Generate request, read-only read_pct% of the time */
+        read_only = counter_rand(seed, counter++) % 100 < args->read_pct_;
+        new (&args->requests_[r]) Request(args->db_, TXN_SZ, writeset, updates, read_only);
+    }
 }
 
-Request **generate_requests(Database *db, uint32_t num_requests)
+/*
+ * Generate num_requests requests on nthreads threads, read_pct% of them
+ * read-only. The requests, their writesets and their updates all live in one
+ * arena, allocated at once.
+ */
+Request **generate_requests(Database *db, uint32_t num_requests, uint64_t seed, uint32_t nthreads,
+                            uint32_t read_pct)
 {
     Request **ret;
+    generate_args args;
+    size_t requests_sz, keys_sz, updates_sz;
+    char *arena;
     uint32_t i;
 
+    requests_sz = ((sizeof(Request) * num_requests + sizeof(uint64_t) - 1) / sizeof(uint64_t)) * sizeof(uint64_t);
+    keys_sz     = sizeof(uint64_t) * TXN_SZ * num_requests;
+    updates_sz  = sizeof(uint64_t) * (RECORD_SIZE / FIELD_SIZE) * num_requests;
+    arena       = (char *)malloc(requests_sz + keys_sz + updates_sz);
+    assert(arena != NULL);
+
+    args.db_       = db;
+    args.seed_     = seed;
+    args.requests_ = (Request *)arena;
+    args.keys_     = (uint64_t *)(arena + requests_sz);
+    args.updates_  = (uint64_t *)(arena + requests_sz + keys_sz);
+    args.read_pct_ = read_pct;
+    parallel_for(nthreads, num_requests, generate_range, &args);
+
     ret = (Request **)malloc(sizeof(Request *) * num_requests);
-    for (i = 0; i < num_requests; ++i) ret[i] = generate_single_request(db);
+    for (i = 0; i < num_requests; ++i) ret[i] = &args.requests_[i];
     return ret;
 }
 
@@ -120,16 +196,17 @@ void run_test(expt_config conf)
 
     /* Use a small db to guarantee conflicts */
     test_db_sz   = 500;
-    multiProcess = (conf._type == PROCESS_POOL || conf._type == PROCESS);
+    multiProcess = (conf._type == PROCESS_POOL || conf._type == PROCESS || conf._type == PROCESS_RING ||
+                    conf._type == ZYGOTE);
 
-    /* Create database */
-    db_test   = Database::Create(test_db_sz, multiProcess);
+    /* Create database; the sequential run checks the layout under test too */
+    db_test   = Database::Create(test_db_sz, multiProcess, false, 0, 1, conf._layout, conf._lock_stripes);
     db_simple = Database::Create(test_db_sz, multiProcess);
     Database::Copy(db_simple, db_test);
 
     /* Gen requests */
     num_requests = 10000;
-    reqs         = generate_requests(db_test, num_requests);
+    reqs         = generate_requests(db_test, num_requests, rand_seed, num_cpus(), conf._read_pct);
 
     /* Create launcher */
     switch (conf._type)
@@ -146,6 +223,18 @@ void run_test(expt_config conf)
         case THREAD_POOL:
             test = new ThreadPoolLauncher(conf._pool_size);
             break;
+        case THREAD_RING:
+            test = new ThreadRingLauncher(conf._pool_size);
+            break;
+        case PROCESS_RING:
+            test = new ProcessRingLauncher(conf._pool_size, conf._pin);
+            break;
+        case ZYGOTE:
+            test = new ZygoteLauncher(conf.max_outstanding_);
+            break;
+        case FIBER:
+            test = new FiberLauncher(conf._pool_size, conf.max_outstanding_);
+            break;
         default:
             assert(false); /* Shouldn't get here */
     }
@@ -165,6 +254,226 @@ void run_test(expt_config conf)
     /* Compare databases to ensure they're the same */
     Database::Compare(db_test, db_simple);
     std::cerr << "Test passed!\n";
+    delete test;
+}
+
+/* Open a counter of this thread's cache misses, or return -1 if the kernel won't */
+int open_miss_counter()
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/*
+ * Returns TSC cycles taken to apply BENCH_UPDATES updates to keys[i % nkeys],
+ * and adds the cache misses they took to *misses if 'counter' is open.
+ */
+uint64_t time_updates(Database *db, const uint64_t *keys, uint32_t nkeys, const uint64_t *updates, int counter,
+                      uint64_t *misses)
+{
+    uint64_t start, before, after;
+    uint32_t i;
+
+    before = after = 0;
+    if (counter >= 0 && read(counter, &before, sizeof(before)) != sizeof(before)) before = 0;
+    start = __rdtsc();
+    for (i = 0; i < BENCH_UPDATES; ++i) Request::UpdateRecord(db, keys[i % nkeys], updates);
+    start = __rdtsc() - start;
+    if (counter >= 0 && read(counter, &after, sizeof(after)) != sizeof(after)) after = before;
+    *misses += after - before;
+    return start;
+}
+
+/* Print one line of bench_kernels' table */
+void bench_line(const char *name, Database *db, const uint64_t *keys, const uint64_t *updates, int counter)
+{
+    uint64_t bytes, misses;
+
+    bytes  = (uint64_t)BENCH_UPDATES * (RECORD_SIZE / FIELD_SIZE) * sizeof(uint64_t);
+    misses = 0;
+    std::cerr << name << "\t";
+    std::cerr << (double)bytes / time_updates(db, keys, 16, updates, -1, &misses) << "\t";
+    std::cerr << (double)bytes / time_updates(db, keys, BENCH_UPDATES, updates, counter, &misses) << "\t";
+    if (counter >= 0)
+        std::cerr << (double)misses / BENCH_UPDATES << "\n";
+    else
+        std::cerr << "n/a\n";
+}
+
+/*
+ * Time every update kernel the CPU supports on row records, and updates to
+ * packed records, in bytes of fields updated per TSC cycle: over a few
+ * records that stay in L1, and over random records of a database too large
+ * for the caches. Random updates also report cache misses per update, where
+ * the kernel lets this process count them.
+ */
+void bench_kernels()
+{
+    uint64_t updates[RECORD_SIZE / FIELD_SIZE], *keys;
+    uint32_t nfields, i;
+    Database *db;
+    int k, counter;
+
+    nfields = RECORD_SIZE / FIELD_SIZE;
+    for (i = 0; i < nfields; ++i) updates[i] = counter_rand(rand_seed, i);
+    keys = (uint64_t *)malloc(sizeof(uint64_t) * BENCH_UPDATES);
+    for (i = 0; i < BENCH_UPDATES; ++i) keys[i] = counter_rand(rand_seed + 1, i) % BENCH_DATABASE_SZ;
+    counter = open_miss_counter();
+
+    std::cerr << "kernel\tL1 bytes/cycle\trandom bytes/cycle\tmisses/update\n";
+    db = Database::Create(BENCH_DATABASE_SZ, false, false, rand_seed, num_cpus(), LAYOUT_ROW);
+    for (k = 0; k < NUM_KERNELS; ++k)
+    {
+        if (!Request::SelectKernel((write_kernel)k)) continue;
+        bench_line(Request::KernelName((write_kernel)k), db, keys, updates, counter);
+    }
+    Database::Destroy(db);
+
+    db = Database::Create(BENCH_DATABASE_SZ, false, false, rand_seed, num_cpus(), LAYOUT_PACKED);
+    bench_line("packed", db, keys, updates, counter);
+    Database::Destroy(db);
+
+    if (counter >= 0) close(counter);
+    free(keys);
+}
+
+/*
+ * Print how fast lnchr takes and runs n requests: submission ns/request,
+ * requests/s, and ns per process spawn where it spawns them.
+ */
+void bench_launcher(const char *name, uint32_t size, Launcher *lnchr, Request **reqs, uint32_t n)
+{
+    double start, submitted, done;
+    uint32_t i;
+
+    start = now_seconds();
+    for (i = 0; i < n; ++i) lnchr->ExecuteRequest(reqs[i]);
+    submitted = now_seconds();
+    lnchr->WaitOutstanding();
+    done = now_seconds();
+    std::cerr << name << "\t" << size << "\t" << (submitted - start) * 1e9 / n << "\t" << n / (done - start)
+              << "\t" << lnchr->SpawnNs() << "\n";
+}
+
+/*
+ * Run the same requests through the ring-fed thread and process pools,
+ * through a thread per request, through a process per request forked by
+ * this process or by a zygote, and through a fiber per request on a thread
+ * per core, at pool sizes (and max outstanding) 1 to 128. Fibers go on to
+ * BENCH_FIBERS_MAX outstanding. As in main, the zygotes are forked before
+ * the requests exist.
+ */
+void bench_launchers()
+{
+    ZygoteLauncher *zygotes[BENCH_LAUNCHER_SIZES];
+    Database *db;
+    Request **reqs;
+    Launcher *lnchr;
+    uint32_t size, i;
+
+    db = Database::Create(BENCH_LAUNCHER_DATABASE_SZ, true, false, rand_seed, num_cpus());
+    for (i = 0; i < BENCH_LAUNCHER_SIZES; ++i) zygotes[i] = new ZygoteLauncher(1 << i);
+    reqs = generate_requests(db, BENCH_LAUNCHER_REQS, rand_seed + 1, num_cpus(), 0);
+    std::cerr << "launcher\tsize\tsubmit ns/request\trequests/s\tspawn ns\n";
+    for (i = 0; i < BENCH_LAUNCHER_SIZES; ++i)
+    {
+        size = 1 << i;
+        lnchr = new ThreadRingLauncher(size);
+        bench_launcher("thread_ring", size, lnchr, reqs, BENCH_LAUNCHER_REQS);
+        delete lnchr;
+        lnchr = new ProcessRingLauncher(size);
+        bench_launcher("process_ring", size, lnchr, reqs, BENCH_LAUNCHER_REQS);
+        delete lnchr;
+        lnchr = new ThreadLauncher(size);
+        bench_launcher("thread", size, lnchr, reqs, BENCH_LAUNCHER_REQS);
+        delete lnchr;
+        lnchr = new ProcessLauncher(size);
+        bench_launcher("process", size, lnchr, reqs, BENCH_SPAWN_REQS);
+        delete lnchr;
+        bench_launcher("zygote", size, zygotes[i], reqs, BENCH_SPAWN_REQS);
+        delete zygotes[i];
+        lnchr = new FiberLauncher(num_cpus(), size);
+        bench_launcher("fiber", size, lnchr, reqs, BENCH_LAUNCHER_REQS);
+        delete lnchr;
+    }
+    for (size = 1 << BENCH_LAUNCHER_SIZES; size <= BENCH_FIBERS_MAX; size *= 2)
+    {
+        lnchr = new FiberLauncher(num_cpus(), size);
+        bench_launcher("fiber", size, lnchr, reqs, BENCH_LAUNCHER_REQS);
+        delete lnchr;
+    }
+    Database::Destroy(db);
+}
+
+/* Workers [begin, end) each count BENCH_COUNTS completions */
+void count_range(void *arg, uint64_t begin, uint64_t end)
+{
+    count_args *args = (count_args *)arg;
+    volatile uint64_t *counter;
+    uint64_t w;
+    uint32_t i;
+
+    for (w = begin; w < end; ++w)
+    {
+        counter = &args->counters_[args->mode_ == COUNT_SHARED ? 0 : w].executed_;
+        for (i = 0; i < BENCH_COUNTS; ++i)
+        {
+            if (args->mode_ == COUNT_OWNED)
+                __atomic_store_n(counter, *counter + 1, __ATOMIC_RELEASE);
+            else
+                fetch_and_increment(counter);
+        }
+    }
+}
+
+/*
+ * Time completion counting as workers scale from 1 to 128 threads: ns per
+ * completion counted in one shared counter, in padded per-worker shards, and
+ * in shards without locked instructions, and ns for a reader to sum the
+ * shards as the launchers' ReadTxnsExecuted does.
+ */
+void bench_counters()
+{
+    txn_counter *counters;
+    count_args args;
+    uint64_t sum;
+    uint32_t nworkers, i, j;
+    double start;
+    int mode;
+
+    counters = (txn_counter *)mmap(NULL, sizeof(txn_counter) * 128, PROT_FLAGS, MAP_FLAGS, 0, 0);
+    assert(counters != MAP_FAILED);
+    args.counters_ = counters;
+    std::cerr << "workers\tshared ns\tsharded ns\towned ns\tread ns\n";
+    for (nworkers = 1; nworkers <= 128; nworkers *= 2)
+    {
+        std::cerr << nworkers;
+        for (mode = 0; mode < NUM_COUNT_MODES; ++mode)
+        {
+            memset((void *)counters, 0x0, sizeof(txn_counter) * 128);
+            args.mode_ = (count_mode)mode;
+            start      = now_seconds();
+            parallel_for(nworkers, nworkers, count_range, &args);
+            std::cerr << "\t" << (now_seconds() - start) * 1e9 / ((double)nworkers * BENCH_COUNTS);
+        }
+
+        sum   = 0;
+        start = now_seconds();
+        for (j = 0; j < BENCH_COUNTER_READS; ++j)
+        {
+            for (i = 0; i < nworkers; ++i) sum += __atomic_load_n(&counters[i].executed_, __ATOMIC_ACQUIRE);
+        }
+        std::cerr << "\t" << (now_seconds() - start) * 1e9 / BENCH_COUNTER_READS << "\n";
+        assert(sum == (uint64_t)BENCH_COUNTER_READS * nworkers * BENCH_COUNTS);
+    }
+    munmap(counters, sizeof(txn_counter) * 128);
 }
 
 void write_results(expt_config conf, double *results)
@@ -199,6 +508,24 @@ void write_results(expt_config conf, double *results)
             result_file << "thread ";
             result_file << "max_outstanding:" << conf.max_outstanding_ << " ";
             break;
+        case THREAD_RING:
+            result_file << "thread_ring ";
+            result_file << "pool_size:" << conf._pool_size << " ";
+            break;
+        case PROCESS_RING:
+            result_file << "process_ring ";
+            result_file << "pool_size:" << conf._pool_size << " ";
+            if (conf._pin) result_file << "pinned ";
+            break;
+        case ZYGOTE:
+            result_file << "zygote ";
+            result_file << "max_outstanding:" << conf.max_outstanding_ << " ";
+            break;
+        case FIBER:
+            result_file << "fiber ";
+            result_file << "pool_size:" << conf._pool_size << " ";
+            result_file << "max_outstanding:" << conf.max_outstanding_ << " ";
+            break;
         default:
             assert(false);
     }
@@ -208,6 +535,8 @@ void write_results(expt_config conf, double *results)
         result_file << "low_contention ";
     else
         result_file << "high_contention ";
+    if (conf._lock_stripes > 0) result_file << "lock_stripes:" << conf._lock_stripes << " ";
+    if (conf._read_pct > 0) result_file << "read_pct:" << conf._read_pct << " ";
     result_file << "\n";
     result_file.close();
 }
@@ -230,7 +559,26 @@ int main(int argc, char **argv)
 
     volatile uint64_t done;
 
-    srand(rand_seed);
+    uint32_t setup_threads;
+    double start, db_done, reqs_done;
+
+    if (conf._bench_kernels == true)
+    {
+        bench_kernels();
+        return 0;
+    }
+
+    if (conf._bench_launchers == true)
+    {
+        bench_launchers();
+        return 0;
+    }
+
+    if (conf._bench_counters == true)
+    {
+        bench_counters();
+        return 0;
+    }
 
     if (conf._test == true)
     {
@@ -239,18 +587,27 @@ int main(int argc, char **argv)
     }
 
     /* Initialize database */
-    multiProcess = (conf._type == PROCESS || conf._type == PROCESS_POOL);
+    multiProcess = (conf._type == PROCESS || conf._type == PROCESS_POOL || conf._type == PROCESS_RING ||
+                    conf._type == ZYGOTE);
     if (conf._contention == true)
         dbSize = HIGH_DATABASE_SZ;
     else
         dbSize = LOW_DATABASE_SZ;
-    db         = Database::Create(dbSize, multiProcess);
-
-    /* Generate requests to process */
-    txns[0] = generate_requests(db, DRY_RUN_SZ);
-    txns[1] = generate_requests(db, NUM_REQS);
+    setup_threads = num_cpus();
+    start         = now_seconds();
+    if (conf._db_file != NULL)
+        db = Database::Open(conf._db_file, dbSize, multiProcess, conf._huge_pages, rand_seed, setup_threads,
+                            conf._layout, conf._lock_stripes);
+    else
+        db = Database::Create(dbSize, multiProcess, conf._huge_pages, rand_seed, setup_threads, conf._layout,
+                              conf._lock_stripes);
+    db_done = now_seconds();
 
-    /* Initialize the appropriate launcher */
+    /*
+     * Initialize the appropriate launcher. Launchers that fork when created
+     * do so before the requests exist, keeping them out of their children's
+     * page tables.
+     */
     if (conf._type == PROCESS)
         lnchr = new ProcessLauncher(conf.max_outstanding_);
     else if (conf._type == PROCESS_POOL)
@@ -259,9 +616,24 @@ int main(int argc, char **argv)
         lnchr = new ThreadLauncher(conf.max_outstanding_);
     else if (conf._type == THREAD_POOL)
         lnchr = new ThreadPoolLauncher(conf._pool_size);
+    else if (conf._type == THREAD_RING)
+        lnchr = new ThreadRingLauncher(conf._pool_size);
+    else if (conf._type == PROCESS_RING)
+        lnchr = new ProcessRingLauncher(conf._pool_size, conf._pin);
+    else if (conf._type == ZYGOTE)
+        lnchr = new ZygoteLauncher(conf.max_outstanding_);
+    else if (conf._type == FIBER)
+        lnchr = new FiberLauncher(conf._pool_size, conf.max_outstanding_);
     else
         assert(false);
 
+    /* Generate requests to process, from streams distinct from the records' */
+    txns[0]   = generate_requests(db, DRY_RUN_SZ, rand_seed + 1, setup_threads, conf._read_pct);
+    txns[1]   = generate_requests(db, NUM_REQS, rand_seed + 2, setup_threads, conf._read_pct);
+    reqs_done = now_seconds();
+    std::cerr << "Setup on " << setup_threads << " threads: database " << db_done - start << "s, requests "
+              << reqs_done - db_done << "s\n";
+
     sleep(1);
 
     /* Measure throughput, and report results */
@@ -270,6 +642,13 @@ int main(int argc, char **argv)
     barrier();
     monitor        = new PerfMonitor(results, &done, lnchr);
     monitor_thread = run_experiment(monitor, lnchr, txns, &done);
+    pthread_join(*monitor_thread, NULL);
     free(monitor_thread);
+    if (lnchr->SpawnNs() > 0) std::cerr << "Spawn: " << lnchr->SpawnNs() / 1000 << "us per process\n";
     write_results(conf, results);
+
+    /* Stop the launcher's pool, if it has one, once its requests are done */
+    lnchr->WaitOutstanding();
+    delete lnchr;
+    return 0;
 }
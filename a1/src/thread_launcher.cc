@@ -3,7 +3,7 @@
 #include <utils.h>
 #include <cassert>
 
-ThreadLauncher::ThreadLauncher(int max_outstanding) : Launcher()
+ThreadLauncher::ThreadLauncher(int max_outstanding) : Launcher(max_outstanding)
 {
     /*
      * max_outstanding_ ensures that the number of outstanding requests never
@@ -44,7 +44,7 @@ void ThreadLauncher::ExecuteRequest(Request *req)
 
     /* Setup the thread's thread_arg struct. */
     arg = GenThreadArg(req, thread, &max_outstanding_, &max_outstanding_cond_, &max_outstanding_mutex_,
-                       &targ_list_mutex_, &targ_list_, txns_executed_);
+                       &targ_list_mutex_, &targ_list_, DoneCounter(_num_requests));
 
     /* Create a thread to execute the request */
     err = pthread_create(thread, NULL, ThreadLauncher::ExecutorFunc, arg);
@@ -5,7 +5,7 @@
 #include <cassert>
 #include <iostream>
 
-ThreadPoolLauncher::ThreadPoolLauncher(int pool_sz) : Launcher()
+ThreadPoolLauncher::ThreadPoolLauncher(int pool_sz) : Launcher(pool_sz)
 {
     assert(pool_sz > 0);
 
@@ -55,7 +55,7 @@ ThreadPoolLauncher::ThreadPoolLauncher(int pool_sz) : Launcher()
         states[i].nthreads_idle_cond_  = &nthreads_idle_cond_;
         states[i].thread_id_           = thread;
         states[i].list_mutex_          = &free_list_mutex_;
-        states[i].txns_executed_       = txns_executed_;
+        states[i].txns_executed_       = DoneCounter(i);
         states[i].list_ptr_            = &states[i + 1];
         states[i].free_list_           = &free_list_;
     }
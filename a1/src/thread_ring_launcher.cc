@@ -0,0 +1,170 @@
+#include <limits.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <thread_ring_launcher.h>
+#include <unistd.h>
+#include <utils.h>
+#include <cassert>
+
+ThreadRingLauncher::ThreadRingLauncher(int pool_sz) : Launcher(pool_sz)
+{
+    assert(pool_sz > 0);
+    assert((RING_SZ & (RING_SZ - 1)) == 0);
+
+    uint32_t i;
+    int err;
+
+    pool_sz_  = pool_sz;
+    tail_     = 0;
+    head_     = 0;
+    wake_seq_ = 0;
+    sleepers_ = 0;
+    stop_     = false;
+
+    ring_ = (ring_slot *)malloc(sizeof(ring_slot) * RING_SZ);
+    assert(ring_ != NULL);
+    for (i = 0; i < RING_SZ; ++i)
+    {
+        ring_[i].seq_ = i;
+        ring_[i].req_ = NULL;
+    }
+
+    workers_ = (ring_worker *)malloc(sizeof(ring_worker) * pool_sz);
+    assert(workers_ != NULL);
+    for (i = 0; i < pool_sz_; ++i)
+    {
+        workers_[i].launcher_ = this;
+        workers_[i].id_       = i;
+        err = pthread_create(&workers_[i].thread_id_, NULL, ThreadRingLauncher::ExecutorFunc, &workers_[i]);
+        assert(err == 0);
+    }
+}
+
+ThreadRingLauncher::~ThreadRingLauncher()
+{
+    uint32_t i;
+
+    __atomic_store_n(&stop_, true, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&wake_seq_, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&wake_seq_, INT_MAX);
+    for (i = 0; i < pool_sz_; ++i) pthread_join(workers_[i].thread_id_, NULL);
+    free(workers_);
+    free(ring_);
+}
+
+/*
+ * Publish a request into the next slot, waiting for a worker to free it if
+ * the ring is full, and wake a worker if any is parked.
+ */
+void ThreadRingLauncher::ExecuteRequest(Request *req)
+{
+    ring_slot *slot;
+    uint64_t pos;
+    uint32_t spins;
+
+    Launcher::ExecuteRequest(req);
+
+    pos  = tail_;
+    slot = &ring_[pos & (RING_SZ - 1)];
+    for (spins = 0; __atomic_load_n(&slot->seq_, __ATOMIC_ACQUIRE) != pos; ++spins)
+    {
+        if (spins < MIN_SPINS)
+            asm volatile("pause;" :::);
+        else
+            sched_yield();
+    }
+    slot->req_ = req;
+    __atomic_store_n(&slot->seq_, pos + 1, __ATOMIC_SEQ_CST);
+    tail_ = pos + 1;
+
+    /* Pairs with Park: either it sees the slot, or we see the sleeper. */
+    if (__atomic_load_n(&sleepers_, __ATOMIC_SEQ_CST) > 0)
+    {
+        __atomic_fetch_add(&wake_seq_, 1, __ATOMIC_SEQ_CST);
+        futex_wake(&wake_seq_, 1);
+    }
+}
+
+uint32_t ThreadRingLauncher::Claim(Request **reqs)
+{
+    uint64_t pos;
+    uint32_t n, i;
+
+    while (true)
+    {
+        /* Count the run of published slots from the head. */
+        pos = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+        for (n = 0; n < RING_BATCH; ++n)
+        {
+            if (__atomic_load_n(&ring_[(pos + n) & (RING_SZ - 1)].seq_, __ATOMIC_ACQUIRE) != pos + n + 1) break;
+        }
+        if (n == 0) return 0;
+        if (!__atomic_compare_exchange_n(&head_, &pos, pos + n, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            continue;
+
+        /* The run is ours: copy the requests out and free the slots. */
+        for (i = 0; i < n; ++i)
+        {
+            reqs[i] = ring_[(pos + i) & (RING_SZ - 1)].req_;
+            __atomic_store_n(&ring_[(pos + i) & (RING_SZ - 1)].seq_, pos + i + RING_SZ, __ATOMIC_RELEASE);
+        }
+        return n;
+    }
+}
+
+/* Sleep until the launcher publishes a request or shuts down */
+void ThreadRingLauncher::Park()
+{
+    uint32_t seq;
+    uint64_t pos;
+
+    __atomic_fetch_add(&sleepers_, 1, __ATOMIC_SEQ_CST);
+    seq = __atomic_load_n(&wake_seq_, __ATOMIC_SEQ_CST);
+    pos = __atomic_load_n(&head_, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring_[pos & (RING_SZ - 1)].seq_, __ATOMIC_SEQ_CST) != pos + 1 &&
+        !__atomic_load_n(&stop_, __ATOMIC_SEQ_CST))
+    {
+        futex_wait(&wake_seq_, seq);
+    }
+    __atomic_fetch_sub(&sleepers_, 1, __ATOMIC_SEQ_CST);
+}
+
+void ThreadRingLauncher::Run(uint32_t id)
+{
+    Request *reqs[RING_BATCH];
+    uint32_t n, i, polls, spins;
+
+    /* The spin budget adapts between the bounds, see the class comment. */
+    spins = MIN_SPINS;
+    polls = 0;
+    while (!__atomic_load_n(&stop_, __ATOMIC_ACQUIRE))
+    {
+        n = Claim(reqs);
+        if (n > 0)
+        {
+            if (polls > 0 && spins < MAX_SPINS) spins *= 2;
+            polls = 0;
+            for (i = 0; i < n; ++i) reqs[i]->Execute();
+            AddDoneTxns(DoneCounter(id), n);
+        }
+        else if (++polls < spins)
+        {
+            asm volatile("pause;" :::);
+        }
+        else
+        {
+            if (spins > MIN_SPINS) spins /= 2;
+            polls = 0;
+            Park();
+        }
+    }
+}
+
+void *ThreadRingLauncher::ExecutorFunc(void *arg)
+{
+    ring_worker *w;
+
+    w = (ring_worker *)arg;
+    w->launcher_->Run(w->id_);
+    return NULL;
+}
@@ -0,0 +1,137 @@
+#include <limits.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <utils.h>
+#include <zygote_launcher.h>
+#include <cassert>
+
+ZygoteLauncher::ZygoteLauncher(uint32_t max_outstanding) : Launcher(max_outstanding)
+{
+    assert(max_outstanding > 0);
+
+    max_outstanding_ = max_outstanding;
+    next_slot_       = 0;
+
+    ctl_ = (zygote_ctl *)mmap(NULL, sizeof(zygote_ctl), PROT_FLAGS, MAP_FLAGS, 0, 0);
+    assert(ctl_ != MAP_FAILED);
+    memset((void *)ctl_, 0x0, sizeof(zygote_ctl));
+
+    slots_ = (zygote_slot *)mmap(NULL, sizeof(zygote_slot) * max_outstanding, PROT_FLAGS, MAP_FLAGS, 0, 0);
+    assert(slots_ != MAP_FAILED);
+    memset((void *)slots_, 0x0, sizeof(zygote_slot) * max_outstanding);
+
+    zygote_ = fork();
+    assert(zygote_ >= 0);
+    if (zygote_ == 0) ZygoteFunc();
+}
+
+ZygoteLauncher::~ZygoteLauncher()
+{
+    int err;
+
+    __atomic_store_n(&ctl_->stop_, 1, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&ctl_->submit_seq_, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&ctl_->submit_seq_, INT_MAX);
+    waitpid(zygote_, NULL, 0);
+
+    err = munmap((void *)slots_, sizeof(zygote_slot) * max_outstanding_);
+    assert(err == 0);
+    err = munmap((void *)ctl_, sizeof(zygote_ctl));
+    assert(err == 0);
+}
+
+/*
+ * Serialize a request into a free slot, waiting for a child to free one if
+ * max_outstanding_ requests are out, and hand it to the zygote.
+ */
+void ZygoteLauncher::ExecuteRequest(Request *req)
+{
+    zygote_slot *slot;
+    uint32_t seq, i;
+
+    Launcher::ExecuteRequest(req);
+    assert(Request::CopySize(req) <= RQST_BUF_SZ);
+
+    slot = NULL;
+    while (slot == NULL)
+    {
+        seq = __atomic_load_n(&ctl_->done_seq_, __ATOMIC_SEQ_CST);
+        for (i = 0; i < max_outstanding_ && slot == NULL; ++i)
+        {
+            slot = &slots_[(next_slot_ + i) % max_outstanding_];
+            if (__atomic_load_n(&slot->state_, __ATOMIC_ACQUIRE) != SLOT_FREE) slot = NULL;
+        }
+        if (slot == NULL) futex_wait(&ctl_->done_seq_, seq);
+    }
+    next_slot_ = (slot - slots_ + 1) % max_outstanding_;
+
+    Request::CopyRequest(slot->req_, req);
+    __atomic_store_n(&slot->state_, SLOT_SUBMITTED, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&ctl_->submit_seq_, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&ctl_->submit_seq_, 1);
+}
+
+/* Average ns the zygote spends forking a child */
+double ZygoteLauncher::SpawnNs()
+{
+    uint64_t spawns;
+
+    spawns = __atomic_load_n(&ctl_->spawns_, __ATOMIC_ACQUIRE);
+    return spawns == 0 ? 0 : (double)ctl_->spawn_ns_ / spawns;
+}
+
+void ZygoteLauncher::ZygoteFunc()
+{
+    struct sigaction sigchild_action;
+    zygote_slot *slot;
+    uint32_t seq, i;
+    double start;
+    pid_t pid;
+    int err;
+
+    /*
+     * Launchers are not always deleted before the experiment exits; die with
+     * the launcher process rather than outlive it.
+     */
+    err = prctl(PR_SET_PDEATHSIG, SIGKILL);
+    assert(err == 0);
+    if (getppid() == 1) _exit(0);
+
+    /* Let the kernel reap children as they exit. */
+    sigchild_action.sa_handler = SIG_IGN;
+    sigemptyset(&sigchild_action.sa_mask);
+    sigchild_action.sa_flags = 0;
+    err                      = sigaction(SIGCHLD, &sigchild_action, 0);
+    assert(err == 0);
+
+    while (__atomic_load_n(&ctl_->stop_, __ATOMIC_ACQUIRE) == 0)
+    {
+        seq = __atomic_load_n(&ctl_->submit_seq_, __ATOMIC_SEQ_CST);
+        for (i = 0; i < max_outstanding_; ++i)
+        {
+            slot = &slots_[i];
+            if (__atomic_load_n(&slot->state_, __ATOMIC_ACQUIRE) != SLOT_SUBMITTED) continue;
+            slot->state_ = SLOT_RUNNING;
+
+            start = now_seconds();
+            if ((pid = fork()) == 0)
+            {
+                /* The child: run the request, count it and free its slot. */
+                ((Request *)slot->req_)->Execute();
+                fetch_and_increment(DoneCounter(i));
+                __atomic_store_n(&slot->state_, SLOT_FREE, __ATOMIC_SEQ_CST);
+                __atomic_fetch_add(&ctl_->done_seq_, 1, __ATOMIC_SEQ_CST);
+                futex_wake(&ctl_->done_seq_, 1);
+                _exit(0);
+            }
+            assert(pid != -1);
+            ctl_->spawn_ns_ += (uint64_t)((now_seconds() - start) * 1e9);
+            __atomic_store_n(&ctl_->spawns_, ctl_->spawns_ + 1, __ATOMIC_RELEASE);
+        }
+        futex_wait(&ctl_->submit_seq_, seq);
+    }
+    _exit(0);
+}
@@ -0,0 +1,220 @@
+#include "txn/checkpoint.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+using std::pair;
+using std::vector;
+
+// "TXNCKPT1", read as a little-endian uint64.
+static const uint64 kCheckpointMagic = 0x3154504b434e5854ull;
+
+struct CheckpointHeader
+{
+    uint64 magic_;
+    uint64 lsn_;
+    uint64 dense_;
+    uint64 sparse_;
+};
+
+// Runs 'work(thread, begin, end)' on 'threads' threads, splitting [0, n)
+// into one contiguous range per thread.
+static void ParallelFor(int threads, uint64 n, const std::function<void(int, uint64, uint64)>& work)
+{
+    if (threads < 1) threads = 1;
+    if (static_cast<uint64>(threads) > n) threads = (n == 0) ? 1 : static_cast<int>(n);
+
+    struct Task
+    {
+        const std::function<void(int, uint64, uint64)>* work_;
+        int thread_;
+        uint64 begin_;
+        uint64 end_;
+        static void* Run(void* arg)
+        {
+            Task* task = reinterpret_cast<Task*>(arg);
+            (*task->work_)(task->thread_, task->begin_, task->end_);
+            return NULL;
+        }
+    };
+
+    vector<Task> tasks(threads);
+    vector<pthread_t> ids(threads);
+    for (int i = 0; i < threads; i++)
+    {
+        tasks[i].work_   = &work;
+        tasks[i].thread_ = i;
+        tasks[i].begin_  = n * i / threads;
+        tasks[i].end_    = n * (i + 1) / threads;
+    }
+    // The calling thread takes the first range itself.
+    for (int i = 1; i < threads; i++) pthread_create(&ids[i], NULL, Task::Run, &tasks[i]);
+    Task::Run(&tasks[0]);
+    for (int i = 1; i < threads; i++) pthread_join(ids[i], NULL);
+}
+
+static void WriteFully(int fd, const char* data, size_t size, const string& path)
+{
+    while (size > 0)
+    {
+        ssize_t written = write(fd, data, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0) DIE("write failed on checkpoint " << path << ": " << strerror(errno));
+        data += written;
+        size -= written;
+    }
+}
+
+void WriteCheckpoint(Storage* storage, const string& path, uint64 lsn, WriteAheadLog* log)
+{
+    string temp = path + ".tmp";
+    int fd      = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) DIE("Cannot create checkpoint " << temp << ": " << strerror(errno));
+
+    // Stream the dense run out as it is scanned; the header goes in last.
+    CheckpointHeader header;
+    header.magic_ = kCheckpointMagic;
+    header.lsn_   = lsn;
+    header.dense_ = 0;
+    string buffer(reinterpret_cast<const char*>(&header), sizeof(header));
+    vector<pair<Key, Value> > sparse;
+    const size_t kBufferSize = 1 << 20;
+
+    storage->ForEach([&](Key key, Value value) {
+        if (key == header.dense_ && sparse.empty())
+        {
+            buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+            header.dense_++;
+            if (buffer.size() >= kBufferSize)
+            {
+                WriteFully(fd, buffer.data(), buffer.size(), temp);
+                buffer.clear();
+            }
+        }
+        else
+        {
+            sparse.push_back(std::make_pair(key, value));
+        }
+    });
+    uint64 scanned = (log == NULL) ? 0 : log->AppendedLSN();
+
+    // Storages that visit keys out of order (Storage's hash table) leave
+    // the dense run in 'sparse'; move whatever continues it back.
+    std::sort(sparse.begin(), sparse.end());
+    size_t moved = 0;
+    while (moved < sparse.size() && sparse[moved].first == header.dense_)
+    {
+        buffer.append(reinterpret_cast<const char*>(&sparse[moved].second), sizeof(Value));
+        header.dense_++;
+        moved++;
+    }
+    header.sparse_ = sparse.size() - moved;
+    for (size_t i = moved; i < sparse.size(); i++)
+    {
+        buffer.append(reinterpret_cast<const char*>(&sparse[i]), sizeof(sparse[i]));
+    }
+    WriteFully(fd, buffer.data(), buffer.size(), temp);
+    if (pwrite(fd, &header, sizeof(header), 0) != sizeof(header))
+    {
+        DIE("write failed on checkpoint " << temp << ": " << strerror(errno));
+    }
+    if (fdatasync(fd) != 0) DIE("fdatasync failed on checkpoint " << temp << ": " << strerror(errno));
+    close(fd);
+
+    if (log != NULL)
+    {
+        for (int spins = 0; log->DurableLSN() < scanned; spins++)
+        {
+            if (spins > 64) sched_yield();
+        }
+    }
+
+    if (rename(temp.c_str(), path.c_str()) != 0)
+    {
+        DIE("Cannot rename checkpoint " << temp << " to " << path << ": " << strerror(errno));
+    }
+    size_t slash = path.rfind('/');
+    string dir   = (slash == string::npos) ? "." : path.substr(0, slash + 1);
+    int dirfd    = open(dir.c_str(), O_RDONLY);
+    if (dirfd >= 0)
+    {
+        fsync(dirfd);
+        close(dirfd);
+    }
+}
+
+bool LoadCheckpoint(const string& path, Storage* storage, uint64* lsn, int threads)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(CheckpointHeader))
+    {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    const CheckpointHeader* header = reinterpret_cast<const CheckpointHeader*>(data);
+    uint64 size = sizeof(CheckpointHeader) + header->dense_ * sizeof(Value) +
+                  header->sparse_ * sizeof(pair<Key, Value>);
+    if (header->magic_ != kCheckpointMagic || size != static_cast<uint64>(st.st_size))
+    {
+        munmap(data, st.st_size);
+        return false;
+    }
+
+    // Each thread faults in and loads its own stretch of the dense run.
+    const Value* values = reinterpret_cast<const Value*>(header + 1);
+    if (!storage->ConcurrentWrites()) threads = 1;
+    ParallelFor(threads, header->dense_,
+                [&](int thread, uint64 begin, uint64 end) { storage->Load(begin, values + begin, end - begin); });
+
+    const pair<Key, Value>* sparse = reinterpret_cast<const pair<Key, Value>*>(values + header->dense_);
+    for (uint64 i = 0; i < header->sparse_; i++) storage->Load(sparse[i].first, &sparse[i].second, 1);
+
+    *lsn = header->lsn_;
+    munmap(data, st.st_size);
+    return true;
+}
+
+uint64 ReplayLog(const string& path, uint64 lsn, Storage* storage, int threads, uint64* end)
+{
+    vector<LogRecord> records;
+    if (!WriteAheadLog::ReadLog(path, &records, lsn, end)) return 0;
+    if (!storage->ConcurrentWrites()) threads = 1;
+    if (threads < 1) threads = 1;
+
+    // Every thread walks the whole log and applies the writes to its keys,
+    // in stripes of 64 so that threads do not share cache lines. Each write
+    // takes a fresh timestamp, so MVCC versions are ordered as the log is.
+    ParallelFor(threads, threads, [&](int thread, uint64, uint64) {
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            const vector<pair<Key, Value> >& writes = records[i].writes_;
+            for (size_t j = 0; j < writes.size(); j++)
+            {
+                Key key = writes[j].first;
+                if (static_cast<int>((key >> 6) % threads) != thread) continue;
+                storage->Lock(key);
+                storage->Write(key, writes[j].second, storage->Clock()->Tick());
+                storage->Unlock(key);
+            }
+        }
+    });
+    return records.size();
+}
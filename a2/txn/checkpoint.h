@@ -0,0 +1,57 @@
+
+// Fuzzy checkpoints of a Storage, and restart from a checkpoint plus the
+// write-ahead log.
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <string>
+
+#include "txn/common.h"
+#include "txn/storage.h"
+#include "txn/wal.h"
+
+using std::string;
+
+// A checkpoint is a snapshot file of every record in a Storage, laid out so
+// that it can be mapped into memory and loaded without parsing:
+//
+//     header | values of keys [0, dense) | 'sparse' <key, value> pairs
+//
+// The header holds a magic number, the checkpoint's LSN, 'dense' and
+// 'sparse' (uint64 each, host byte order). The dense run covers the keys
+// every storage here starts with; any other key goes in the sorted sparse
+// tail.
+//
+// Checkpoints are fuzzy: the snapshot is taken while txns keep committing, so
+// it may hold some of a txn's writes and not others. It is stamped with an
+// LSN such that every txn logged before that LSN had applied all of its
+// writes before the scan began. Replaying the log from there on top of the
+// snapshot gives every key the last value logged for it, which is the state
+// the log describes.
+
+// Writes a snapshot of 'storage' to 'path', stamped with 'lsn' (see above).
+// The snapshot goes to a temporary file which replaces 'path' once complete
+// and synced, so a crash leaves either the old checkpoint or the new one.
+// With a 'log', waits before that for the log to be flushed past every
+// record appended during the scan: the snapshot may hold any write applied by
+// then, and must not be installed before the log can replay it.
+void WriteCheckpoint(Storage* storage, const string& path, uint64 lsn, WriteAheadLog* log);
+
+// Loads the checkpoint at 'path' into 'storage', using up to 'threads'
+// threads, and sets '*lsn' to the LSN it is stamped with. Returns false, and
+// leaves 'storage' untouched, if there is no valid checkpoint at 'path'.
+//
+// Requires: no other thread accesses 'storage' meanwhile.
+bool LoadCheckpoint(const string& path, Storage* storage, uint64* lsn, int threads);
+
+// Applies the writes of every intact record in the log at 'path' from LSN
+// 'lsn' on to 'storage', using up to 'threads' threads, each of which owns a
+// share of the keys and applies their writes in log order. Sets '*end' to
+// the LSN just past the last intact record, and returns the number of
+// records replayed.
+//
+// Requires: no other thread accesses 'storage' meanwhile.
+uint64 ReplayLog(const string& path, uint64 lsn, Storage* storage, int threads, uint64* end);
+
+#endif  // _CHECKPOINT_H_
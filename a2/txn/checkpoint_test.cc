@@ -0,0 +1,252 @@
+#include "txn/checkpoint.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <map>
+#include <sstream>
+
+#include "txn/dense_storage.h"
+#include "txn/mvcc_storage.h"
+#include "txn/txn_processor.h"
+#include "txn/txn_types.h"
+#include "utils/testing.h"
+
+using std::map;
+
+// Returns a fresh file path for this process.
+static string TempPath(const string& name)
+{
+    std::ostringstream path;
+    path << "/tmp/checkpoint_test_" << getpid() << "_" << name;
+    unlink(path.str().c_str());
+    return path.str();
+}
+
+static Storage* NewStorage(int kind)
+{
+    if (kind == 0) return new Storage();
+    if (kind == 1) return new DenseStorage(100);
+    return new MVCCStorage(100);
+}
+
+TEST(Checkpoint_RoundTrip)
+{
+    string path = TempPath("round_trip");
+    for (int kind = 0; kind < 3; kind++)
+    {
+        // Keys past the dense storages' capacity, and one past a gap, which
+        // ends up in the sparse tail.
+        Storage* storage = NewStorage(kind);
+        for (Key key = 0; key < 150; key++) storage->Write(key, key * 10, 1);
+        storage->Write(1000, 7, 1);
+        WriteCheckpoint(storage, path, 42, NULL);
+        delete storage;
+
+        storage    = NewStorage(kind);
+        uint64 lsn = 0;
+        EXPECT_TRUE(LoadCheckpoint(path, storage, &lsn, 4));
+        EXPECT_EQ(42, lsn);
+        Value value;
+        bool intact = true;
+        for (Key key = 0; key < 150; key++) intact = intact && storage->Read(key, &value, 1) && value == key * 10;
+        EXPECT_TRUE(intact);
+        EXPECT_TRUE(storage->Read(1000, &value, 1));
+        EXPECT_EQ(7, value);
+        EXPECT_FALSE(storage->Read(999, &value, 1));
+        delete storage;
+    }
+
+    // Anything but a whole checkpoint is refused.
+    Storage storage;
+    uint64 lsn;
+    EXPECT_EQ(0, truncate(path.c_str(), 100));
+    EXPECT_FALSE(LoadCheckpoint(path, &storage, &lsn, 1));
+    EXPECT_FALSE(LoadCheckpoint(path + ".missing", &storage, &lsn, 1));
+
+    unlink(path.c_str());
+    END;
+}
+
+TEST(Checkpoint_ReplayFromLSN)
+{
+    string path = TempPath("replay.log");
+    uint64 lsn1, lsn2;
+    {
+        WriteAheadLog log(path, WAL_SYNC_NONE);
+        KeyValueMap writes;
+        writes[1] = 1;
+        lsn1      = log.Append(1, writes);
+        writes[1] = 2;
+        writes[2] = 5;
+        lsn2      = log.Append(2, writes);
+
+        // Many writes to a few keys, so that threads share records but no
+        // key has more than one owner.
+        for (int i = 0; i < 1000; i++)
+        {
+            writes.clear();
+            writes[100 + i % 300] = i;
+            writes[1000 + i % 7]  = i;
+            log.Append(3 + i, writes);
+        }
+    }
+
+    for (int threads = 1; threads <= 4; threads += 3)
+    {
+        for (int kind = 0; kind < 3; kind++)
+        {
+            Storage* storage = NewStorage(kind);
+            uint64 end;
+            EXPECT_EQ(1001, ReplayLog(path, lsn1, storage, threads, &end));
+            EXPECT_TRUE(end > lsn2);
+
+            // The record before 'lsn1' was skipped; later writes won.
+            Value value;
+            EXPECT_TRUE(storage->Read(1, &value, ~0ull));
+            EXPECT_EQ(2, value);
+            EXPECT_TRUE(storage->Read(2, &value, ~0ull));
+            EXPECT_EQ(5, value);
+            bool last = true;
+            for (Value i = 700; i < 1000; i++)
+            {
+                last = last && storage->Read(100 + i % 300, &value, ~0ull) && value == i;
+            }
+            for (Value i = 993; i < 1000; i++)
+            {
+                last = last && storage->Read(1000 + i % 7, &value, ~0ull) && value == i;
+            }
+            EXPECT_TRUE(last);
+            delete storage;
+        }
+    }
+
+    unlink(path.c_str());
+    END;
+}
+
+// Returns the database that replaying the whole log at 'path' over keys
+// [0, 20) at 0 describes.
+static map<Key, Value> Replayed(const string& path)
+{
+    map<Key, Value> expected;
+    for (Key key = 0; key < 20; key++) expected[key] = 0;
+    vector<LogRecord> records;
+    WriteAheadLog::ReadLog(path, &records);
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        for (size_t j = 0; j < records[i].writes_.size(); j++)
+        {
+            expected[records[i].writes_[j].first] = records[i].writes_[j].second;
+        }
+    }
+    return expected;
+}
+
+static void RunIncrements(TxnProcessor* p, int count)
+{
+    for (int i = 0; i < count; i++) p->NewTxnRequest(new RMW(20, 0, 3));
+}
+
+static void CollectResults(TxnProcessor* p, int count)
+{
+    for (int i = 0; i < count; i++) delete p->GetTxnResult();
+}
+
+static bool Holds(TxnProcessor* p, const map<Key, Value>& expected)
+{
+    Txn* check = new Expect(expected);
+    p->NewTxnRequest(check);
+    p->GetTxnResult();
+    bool holds = (check->Status() == COMMITTED);
+    delete check;
+    return holds;
+}
+
+// Takes a checkpoint while txns run in each mode (and in LOCKING mode on both
+// storages), then restarts from it and the log, with a torn record at the end
+// of the log.
+TEST(TxnProcessor_RestartsFromCheckpoint)
+{
+    CCMode modes[] = {SERIAL, LOCKING, LOCKING_PARTITIONED, P_OCC, MVCC, LOCKING_ONLINE};
+    for (int m = 0; m < 7; m++)
+    {
+        TxnProcessorConfig config;
+        config.wal_path        = TempPath("processor.log");
+        config.checkpoint_path = TempPath("processor.ckpt");
+        config.wal_sync        = WAL_SYNC_NONE;
+        config.lock_table      = LOCK_TABLE_FLAT;
+        CCMode mode            = (m < 6) ? modes[m] : LOCKING;
+        if (m == 6 || mode == LOCKING_PARTITIONED || mode == LOCKING_ONLINE) config.storage = STORAGE_DENSE;
+
+        TxnProcessor* p = new TxnProcessor(mode, config);
+        RunIncrements(p, 300);
+        EXPECT_TRUE(p->Checkpoint());
+        CollectResults(p, 300);
+        RunIncrements(p, 200);
+        CollectResults(p, 200);
+        EXPECT_EQ(1, p->Checkpoints());
+        delete p;
+
+        int fd = open(config.wal_path.c_str(), O_WRONLY | O_APPEND);
+        EXPECT_EQ(7, write(fd, "garbage", 7));
+        close(fd);
+
+        // Only the tail written since the checkpoint began is replayed.
+        map<Key, Value> expected = Replayed(config.wal_path);
+        p                        = new TxnProcessor(mode, config);
+        EXPECT_TRUE(p->RecoveredRecords() >= 200 && p->RecoveredRecords() <= 500);
+        EXPECT_TRUE(Holds(p, expected));
+
+        // The torn record was cut off, so what is logged now survives too.
+        RunIncrements(p, 50);
+        CollectResults(p, 50);
+        delete p;
+        expected = Replayed(config.wal_path);
+        p        = new TxnProcessor(mode, config);
+        EXPECT_TRUE(Holds(p, expected));
+        delete p;
+
+        unlink(config.wal_path.c_str());
+        unlink(config.checkpoint_path.c_str());
+    }
+
+    END;
+}
+
+// Checkpoints from a background thread while txns run.
+TEST(TxnProcessor_PeriodicCheckpoints)
+{
+    TxnProcessorConfig config;
+    config.wal_path            = TempPath("periodic.log");
+    config.checkpoint_path     = TempPath("periodic.ckpt");
+    config.wal_sync            = WAL_SYNC_NONE;
+    config.checkpoint_interval = 0.01;
+
+    TxnProcessor* p = new TxnProcessor(LOCKING, config);
+    double start    = GetTime();
+    while (p->Checkpoints() < 3 && GetTime() - start < 10)
+    {
+        RunIncrements(p, 100);
+        CollectResults(p, 100);
+    }
+    EXPECT_TRUE(p->Checkpoints() >= 3);
+    delete p;
+
+    map<Key, Value> expected = Replayed(config.wal_path);
+    config.checkpoint_interval = 0;
+    p                          = new TxnProcessor(LOCKING, config);
+    EXPECT_TRUE(Holds(p, expected));
+    delete p;
+
+    unlink(config.wal_path.c_str());
+    unlink(config.checkpoint_path.c_str());
+    END;
+}
+
+int main(int argc, char** argv)
+{
+    Checkpoint_RoundTrip();
+    Checkpoint_ReplayFromLSN();
+    TxnProcessor_RestartsFromCheckpoint();
+    TxnProcessor_PeriodicCheckpoints();
+}
@@ -5,6 +5,7 @@
 #include <assert.h>
 #include <stdint.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 #include <cstdio>
 #include <cstdlib>
@@ -57,6 +58,14 @@ static inline double GetTime()
     return tv.tv_sec + tv.tv_usec / 1e6;
 }
 
+// Returns a monotonic time in nanoseconds, for timing short operations.
+static inline uint64 GetNanos()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
 // Returns a random double in [0, max] (flat distribution).
 static inline double RandomDouble(double max)
 {
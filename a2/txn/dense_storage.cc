@@ -0,0 +1,152 @@
+#include "txn/dense_storage.h"
+
+DenseStorage::DenseStorage(Key capacity) : capacity_(capacity) { records_ = new Record[capacity_]; }
+
+DenseStorage::~DenseStorage()
+{
+    delete[] records_;
+    for (unordered_map<Key, Record*>::iterator it = fallback_.begin(); it != fallback_.end(); ++it)
+    {
+        delete it->second;
+    }
+}
+
+DenseStorage::Record* DenseStorage::Find(Key key, bool create)
+{
+    if (key < capacity_) return &records_[key];
+
+    fallback_mutex_.ReadLock();
+    unordered_map<Key, Record*>::iterator it = fallback_.find(key);
+    Record* record = (it == fallback_.end()) ? NULL : it->second;
+    fallback_mutex_.Unlock();
+    if (record != NULL || !create) return record;
+
+    fallback_mutex_.WriteLock();
+    Record*& slot = fallback_[key];
+    if (slot == NULL) slot = new Record();
+    record = slot;
+    fallback_mutex_.Unlock();
+    return record;
+}
+
+bool DenseStorage::Read(Key key, Value* result, uint64 txn_unique_id)
+{
+    Record* record = Find(key, false);
+    if (record == NULL) return false;
+
+    while (true)
+    {
+        uint64 seq = record->seq_.load(std::memory_order_acquire);
+        if (seq == 0) return false;
+        if (seq & 1) continue;  // Write in progress.
+
+        Value value = record->value_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (record->seq_.load(std::memory_order_relaxed) == seq)
+        {
+            *result = value;
+            return true;
+        }
+    }
+}
+
+uint64 DenseStorage::Claim(Record* record)
+{
+    // Concurrent writers to one key take turns.
+    uint64 seq = record->seq_.load(std::memory_order_relaxed);
+    while ((seq & 1) || !record->seq_.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire))
+    {
+        seq = record->seq_.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    return seq;
+}
+
+void DenseStorage::Write(Key key, Value value, uint64 txn_unique_id)
+{
+    Record* record = Find(key, true);
+    uint64 seq     = Claim(record);
+
+    record->value_.store(value, std::memory_order_relaxed);
+    record->timestamp_.store(clock_.Tick(), std::memory_order_relaxed);
+    record->seq_.store(seq + 2, std::memory_order_release);
+}
+
+void DenseStorage::WriteBatch(const vector<pair<Key, Value> >& writes)
+{
+    if (writes.empty()) return;
+    for (size_t i = 0; i < writes.size(); i++)
+    {
+        Record* record = Find(writes[i].first, true);
+        Claim(record);
+        record->value_.store(writes[i].second, std::memory_order_relaxed);
+    }
+
+    // Every value is stored before the clock ticks (see Write). Records are
+    // never moved, so looking them up again finds the ones we claimed.
+    uint64 timestamp = clock_.Tick();
+    for (size_t i = 0; i < writes.size(); i++)
+    {
+        Record* record = Find(writes[i].first, false);
+        record->timestamp_.store(timestamp, std::memory_order_relaxed);
+        record->seq_.store(record->seq_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+}
+
+uint64 DenseStorage::Timestamp(Key key)
+{
+    Record* record = Find(key, false);
+    if (record == NULL) return 0;
+    return record->timestamp_.load(std::memory_order_acquire);
+}
+
+// Init the storage
+void DenseStorage::InitStorage()
+{
+    // Like Storage, start with keys [0, 1000000) holding value 0. Records in
+    // the array are marked written directly, at logical time 0.
+    for (Key i = 0; i < 1000000; i++)
+    {
+        if (i < capacity_)
+            records_[i].seq_.store(2, std::memory_order_relaxed);
+        else
+            Write(i, 0, 0);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void DenseStorage::ForEach(const std::function<void(Key, Value)>& visit)
+{
+    Value value;
+    for (Key key = 0; key < capacity_; key++)
+    {
+        if (Read(key, &value)) visit(key, value);
+    }
+
+    fallback_mutex_.ReadLock();
+    vector<Key> keys;
+    keys.reserve(fallback_.size());
+    for (unordered_map<Key, Record*>::iterator it = fallback_.begin(); it != fallback_.end(); ++it)
+    {
+        keys.push_back(it->first);
+    }
+    fallback_mutex_.Unlock();
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        if (Read(keys[i], &value)) visit(keys[i], value);
+    }
+}
+
+void DenseStorage::Load(Key first, const Value* values, Key count)
+{
+    // Like InitStorage, mark the records written directly, at logical time 0.
+    for (Key i = 0; i < count; i++)
+    {
+        Record* record = Find(first + i, true);
+        uint64 seq     = record->seq_.load(std::memory_order_relaxed);
+        record->value_.store(values[i], std::memory_order_relaxed);
+        record->timestamp_.store(0, std::memory_order_relaxed);
+        record->seq_.store(seq + 2, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+}
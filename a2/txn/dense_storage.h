@@ -0,0 +1,84 @@
+
+#ifndef _DENSE_STORAGE_H_
+#define _DENSE_STORAGE_H_
+
+#include <atomic>
+#include <unordered_map>
+
+#include "txn/storage.h"
+#include "utils/mutex.h"
+
+using std::unordered_map;
+
+// Single-version storage for dense integer key spaces.
+//
+// Keys below 'capacity' live in one flat array of records, each holding the
+// value and the record's timestamp next to a sequence counter. Any other key
+// falls back to a hash table of individually allocated records. Records are
+// never freed or moved, so once located they are read and written without
+// holding any table-wide lock:
+//
+//  - Writers claim a record by bumping its (even) sequence number to odd,
+//    store the value, stamp the record, then bump the sequence back to even.
+//  - Readers retry until they see the same even sequence number before and
+//    after loading the value (a seqlock), so any number of threads may read
+//    while others write, without going through the scheduler thread.
+//
+// Timestamps come from the storage's logical clock, which ticks once per
+// write. A record's timestamp is taken after its value has been
+// stored, so a txn that read Now() before reading the record sees either the
+// new value or a timestamp greater than its start time.
+class DenseStorage : public Storage
+{
+   public:
+    explicit DenseStorage(Key capacity = 1000000);
+    virtual ~DenseStorage();
+
+    virtual bool Read(Key key, Value* result, uint64 txn_unique_id = 0);
+    virtual void Write(Key key, Value value, uint64 txn_unique_id = 0);
+
+    // Claims every record first (in key order, so concurrent batches cannot
+    // deadlock), then stamps them all with a single tick of the clock.
+    virtual void WriteBatch(const vector<pair<Key, Value> >& writes);
+
+    // Returns the logical time of the record's last write (0 if never written).
+    virtual uint64 Timestamp(Key key);
+
+    virtual void InitStorage();
+
+    // Visits the record array in key order, then the fallback records.
+    virtual void ForEach(const std::function<void(Key, Value)>& visit);
+
+    virtual void Load(Key first, const Value* values, Key count);
+
+    virtual bool ConcurrentWrites() const { return true; }
+
+   private:
+    // One record. Sequence 0 means "never written"; odd means "being written".
+    struct Record
+    {
+        Record() : seq_(0), value_(0), timestamp_(0) {}
+        std::atomic<uint64> seq_;
+        std::atomic<Value> value_;
+        std::atomic<uint64> timestamp_;
+        uint64 pad_;  // Two records per cache line.
+    };
+
+    // Returns the record for 'key', or NULL if 'key' is out of range and has
+    // never been written. With 'create', allocates a fallback record instead
+    // of returning NULL.
+    Record* Find(Key key, bool create);
+
+    // Waits for and claims 'record' for writing. Returns its (even) sequence
+    // number from before the claim.
+    uint64 Claim(Record* record);
+
+    Key capacity_;
+    Record* records_;
+
+    // Records for keys >= capacity_, guarded by 'fallback_mutex_'.
+    unordered_map<Key, Record*> fallback_;
+    MutexRW fallback_mutex_;
+};
+
+#endif  // _DENSE_STORAGE_H_
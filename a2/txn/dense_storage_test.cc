@@ -0,0 +1,211 @@
+#include "txn/dense_storage.h"
+
+#include <pthread.h>
+#include <atomic>
+#include <vector>
+
+#include "utils/testing.h"
+
+using std::vector;
+
+TEST(DenseStorage_ReadWrite)
+{
+    DenseStorage storage(100);
+    Value v;
+
+    // Nothing exists before InitStorage.
+    EXPECT_FALSE(storage.Read(5, &v));
+    EXPECT_FALSE(storage.Read(1000, &v));
+
+    storage.InitStorage();
+    EXPECT_TRUE(storage.Read(5, &v));
+    EXPECT_EQ(0, v);
+    EXPECT_EQ(0, storage.Timestamp(5));
+
+    // In-range and fallback keys behave the same.
+    storage.Write(5, 42);
+    storage.Write(5000, 43);
+    storage.Write(2000000, 44);
+    EXPECT_TRUE(storage.Read(5, &v));
+    EXPECT_EQ(42, v);
+    EXPECT_TRUE(storage.Read(5000, &v));
+    EXPECT_EQ(43, v);
+    EXPECT_TRUE(storage.Read(2000000, &v));
+    EXPECT_EQ(44, v);
+    EXPECT_FALSE(storage.Read(3000000, &v));
+
+    END;
+}
+
+TEST(DenseStorage_LogicalClock)
+{
+    DenseStorage storage(100);
+    storage.InitStorage();
+
+    uint64 start = storage.Now();
+    EXPECT_TRUE(storage.Timestamp(7) <= start);
+
+    storage.Write(7, 1);
+    uint64 first = storage.Timestamp(7);
+    EXPECT_TRUE(first > start);
+    EXPECT_EQ(first, storage.Now());
+
+    // Every write ticks the clock, whatever the key.
+    storage.Write(8, 1);
+    storage.Write(7, 2);
+    EXPECT_TRUE(storage.Timestamp(8) > first);
+    EXPECT_TRUE(storage.Timestamp(7) > storage.Timestamp(8));
+
+    END;
+}
+
+TEST(DenseStorage_WriteBatch)
+{
+    DenseStorage storage(100);
+    storage.InitStorage();
+
+    vector<pair<Key, Value> > writes;
+    writes.push_back(std::make_pair(3, 30));
+    writes.push_back(std::make_pair(9, 90));
+    writes.push_back(std::make_pair(5000, 50));
+    uint64 start = storage.Now();
+    storage.WriteBatch(writes);
+
+    // One tick for the whole batch.
+    EXPECT_EQ(start + 1, storage.Now());
+    Value v;
+    for (size_t i = 0; i < writes.size(); i++)
+    {
+        EXPECT_TRUE(storage.Read(writes[i].first, &v));
+        EXPECT_EQ(writes[i].second, v);
+        EXPECT_EQ(storage.Now(), storage.Timestamp(writes[i].first));
+    }
+
+    // Records are released: plain writes to them still go through.
+    storage.Write(9, 91);
+    EXPECT_TRUE(storage.Read(9, &v));
+    EXPECT_EQ(91, v);
+
+    END;
+}
+
+// Shared state for the concurrent reader/writer test.
+struct SeqlockRun
+{
+    DenseStorage* storage;
+    Value writes;
+    std::atomic<bool> done;
+    std::atomic<bool> ok;
+};
+
+// Writes 1, 2, 3, ... to keys 0 and 1 (in range) and 10000 (fallback).
+static void* Writer(void* arg)
+{
+    SeqlockRun* run = reinterpret_cast<SeqlockRun*>(arg);
+    for (Value i = 1; i <= run->writes; i++)
+    {
+        run->storage->Write(0, i);
+        run->storage->Write(1, i);
+        run->storage->Write(10000, i);
+    }
+    run->done = true;
+    return NULL;
+}
+
+// Readers must never see a key go backwards, nor key 1 ahead of key 0.
+static void* Reader(void* arg)
+{
+    SeqlockRun* run = reinterpret_cast<SeqlockRun*>(arg);
+    Value last = 0;
+    while (!run->done)
+    {
+        Value v0, v1, v2;
+        run->storage->Read(1, &v1);
+        run->storage->Read(0, &v0);
+        run->storage->Read(10000, &v2);
+        if (v0 < last || v1 > v0 || v2 > run->writes) run->ok = false;
+        last = v0;
+    }
+    return NULL;
+}
+
+TEST(DenseStorage_ConcurrentReaders)
+{
+    DenseStorage storage(100);
+    storage.InitStorage();
+    storage.Write(10000, 0);
+
+    SeqlockRun run;
+    run.storage = &storage;
+    run.writes  = 200000;
+    run.done    = false;
+    run.ok      = true;
+
+    vector<pthread_t> threads(4);
+    pthread_create(&threads[0], NULL, Writer, &run);
+    for (int i = 1; i < 4; i++) pthread_create(&threads[i], NULL, Reader, &run);
+    for (int i = 0; i < 4; i++) pthread_join(threads[i], NULL);
+
+    EXPECT_TRUE(run.ok.load());
+    Value v;
+    EXPECT_TRUE(storage.Read(0, &v));
+    EXPECT_EQ(run.writes, v);
+
+    END;
+}
+
+// Times InitStorage plus random reads and writes over the 1,000,000 initial
+// keys. Returns millions of operations per second.
+double RunStorage(Storage* storage, double* init_seconds)
+{
+    const int kOps = 4000000;
+
+    double start = GetTime();
+    storage->InitStorage();
+    *init_seconds = GetTime() - start;
+
+    srand(0);
+    Value v;
+    start = GetTime();
+    for (int i = 0; i < kOps; i++)
+    {
+        Key key = rand() % 1000000;
+        if (i % 4 == 0)
+        {
+            storage->Write(key, i);
+        }
+        else
+        {
+            storage->Read(key, &v);
+        }
+    }
+    double end = GetTime();
+    return kOps / (end - start) / 1e6;
+}
+
+void Benchmark()
+{
+    cout << "\t\t---------------------------------------------------" << endl;
+    cout << "\t\t  1M keys: InitStorage (s), 3:1 read/write (M ops/s)" << endl;
+    cout << "\t\t---------------------------------------------------" << endl;
+
+    double init;
+    Storage* hashed = new Storage();
+    double ops = RunStorage(hashed, &init);
+    delete hashed;
+    cout << "\t\tStorage\t\t" << init << "\t" << ops << endl;
+
+    DenseStorage* dense = new DenseStorage();
+    ops = RunStorage(dense, &init);
+    delete dense;
+    cout << "\t\tDenseStorage\t" << init << "\t" << ops << endl;
+}
+
+int main(int argc, char** argv)
+{
+    DenseStorage_ReadWrite();
+    DenseStorage_LogicalClock();
+    DenseStorage_WriteBatch();
+    DenseStorage_ConcurrentReaders();
+    Benchmark();
+}
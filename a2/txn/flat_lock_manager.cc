@@ -0,0 +1,323 @@
+#include "txn/flat_lock_manager.h"
+
+#include <algorithm>
+
+#include "utils/hash.h"
+
+// Returns the smallest power of two >= n (and >= 1).
+static size_t RoundUpToPowerOfTwo(size_t n)
+{
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+Txn* FlatLockManager::LockEntry::TxnAt(uint32_t i) const
+{
+    if (i < kInlineRequests) return txns_[i];
+    SpilledRequest* r = spilled_;
+    for (i -= kInlineRequests; i > 0; i--) r = r->next_;
+    return r->txn_;
+}
+
+LockMode FlatLockManager::LockEntry::ModeAt(uint32_t i) const
+{
+    if (i < kInlineRequests) return static_cast<LockMode>(modes_[i]);
+    SpilledRequest* r = spilled_;
+    for (i -= kInlineRequests; i > 0; i--) r = r->next_;
+    return r->mode_;
+}
+
+FlatLockManager::FlatLockManager(deque<Txn*>* ready_txns, size_t buckets)
+    : buckets_(RoundUpToPowerOfTwo(buckets)),
+      bucket_mask_(RoundUpToPowerOfTwo(buckets) - 1),
+      wait_buckets_(RoundUpToPowerOfTwo(buckets / 4 + 1)),
+      wait_mask_(RoundUpToPowerOfTwo(buckets / 4 + 1) - 1)
+{
+    ready_txns_ = ready_txns;
+}
+
+FlatLockManager::~FlatLockManager()
+{
+    // All nodes (spilled requests, chained entries, chained wait counts) are
+    // owned by the pools.
+}
+
+FlatLockManager::Bucket* FlatLockManager::BucketOf(const Key& key)
+{
+    return &buckets_[(HashKey(key) >> 20) & bucket_mask_];
+}
+
+FlatLockManager::LockEntry* FlatLockManager::Find(Bucket* bucket, const Key& key)
+{
+    for (int i = 0; i < kEntriesPerBucket; i++)
+    {
+        if (bucket->entries_[i].size_ != 0 && bucket->entries_[i].key_ == key) return &bucket->entries_[i];
+    }
+    for (LockEntry* e = bucket->chained_; e != NULL; e = e->next_)
+    {
+        if (e->key_ == key) return e;
+    }
+    return NULL;
+}
+
+FlatLockManager::LockEntry* FlatLockManager::FindOrInsert(Bucket* bucket, const Key& key)
+{
+    LockEntry* entry = Find(bucket, key);
+    if (entry != NULL) return entry;
+
+    for (int i = 0; i < kEntriesPerBucket && entry == NULL; i++)
+    {
+        if (bucket->entries_[i].size_ == 0) entry = &bucket->entries_[i];
+    }
+    if (entry == NULL)
+    {
+        entry           = entry_pool_.Get();
+        entry->next_    = bucket->chained_;
+        bucket->chained_ = entry;
+    }
+    entry->key_       = key;
+    entry->exclusive_ = 0;
+    entry->spilled_   = NULL;
+    return entry;
+}
+
+void FlatLockManager::Free(Bucket* bucket, LockEntry* entry)
+{
+    if (entry >= bucket->entries_ && entry < bucket->entries_ + kEntriesPerBucket) return;
+
+    // Unlink a chained entry and hand it back to the pool.
+    LockEntry** link = &bucket->chained_;
+    while (*link != entry) link = &(*link)->next_;
+    *link = entry->next_;
+    entry_pool_.Put(entry);
+}
+
+void FlatLockManager::Append(LockEntry* entry, Txn* txn, LockMode mode)
+{
+    if (entry->size_ < kInlineRequests)
+    {
+        entry->txns_[entry->size_]  = txn;
+        entry->modes_[entry->size_] = mode;
+    }
+    else
+    {
+        SpilledRequest* r = request_pool_.Get();
+        r->txn_           = txn;
+        r->mode_          = mode;
+        SpilledRequest** tail = &entry->spilled_;
+        while (*tail != NULL) tail = &(*tail)->next_;
+        *tail = r;
+    }
+    entry->size_++;
+    if (mode == EXCLUSIVE) entry->exclusive_++;
+}
+
+void FlatLockManager::Erase(LockEntry* entry, uint32_t i)
+{
+    if (entry->ModeAt(i) == EXCLUSIVE) entry->exclusive_--;
+
+    if (i < kInlineRequests)
+    {
+        // Shift the inline requests left and refill the last inline slot from
+        // the spilled list.
+        for (uint32_t j = i; j + 1 < kInlineRequests && j + 1 < entry->size_; j++)
+        {
+            entry->txns_[j]  = entry->txns_[j + 1];
+            entry->modes_[j] = entry->modes_[j + 1];
+        }
+        if (entry->spilled_ != NULL)
+        {
+            SpilledRequest* r                    = entry->spilled_;
+            entry->txns_[kInlineRequests - 1]  = r->txn_;
+            entry->modes_[kInlineRequests - 1] = r->mode_;
+            entry->spilled_                      = r->next_;
+            request_pool_.Put(r);
+        }
+    }
+    else
+    {
+        SpilledRequest** link = &entry->spilled_;
+        for (i -= kInlineRequests; i > 0; i--) link = &(*link)->next_;
+        SpilledRequest* r = *link;
+        *link             = r->next_;
+        request_pool_.Put(r);
+    }
+    entry->size_--;
+}
+
+uint32_t FlatLockManager::GrantedPrefix(const LockEntry& entry)
+{
+    if (entry.size_ == 0) return 0;
+    if (entry.ModeAt(0) == EXCLUSIVE) return 1;
+    if (entry.exclusive_ == 0) return entry.size_;
+    uint32_t n = 0;
+    while (n < entry.size_ && entry.ModeAt(n) == SHARED) n++;
+    return n;
+}
+
+bool FlatLockManager::Lock(Txn* txn, const Key& key, LockMode mode)
+{
+    Bucket* bucket = BucketOf(key);
+    bucket->latch_.Lock();
+    LockEntry* entry = FindOrInsert(bucket, key);
+
+    // Exclusive requests need an empty queue; shared ones a queue of shared
+    // requests only.
+    bool granted = (mode == EXCLUSIVE) ? (entry->size_ == 0) : (entry->exclusive_ == 0);
+    Append(entry, txn, mode);
+
+    // Count the wait while still holding the bucket latch, so that a
+    // concurrent Release of this key cannot grant the request first.
+    if (!granted) AdjustWaits(txn, 1);
+    bucket->latch_.Unlock();
+    return granted;
+}
+
+bool FlatLockManager::ReadLock(Txn* txn, const Key& key) { return Lock(txn, key, SHARED); }
+
+bool FlatLockManager::WriteLock(Txn* txn, const Key& key) { return Lock(txn, key, EXCLUSIVE); }
+
+void FlatLockManager::Release(Txn* txn, const Key& key)
+{
+    Bucket* bucket = BucketOf(key);
+    bucket->latch_.Lock();
+    ReleaseLocked(bucket, txn, key);
+    bucket->latch_.Unlock();
+}
+
+void FlatLockManager::ReleaseAll(vector<HeldLock>* locks)
+{
+    std::sort(locks->begin(), locks->end(), [this](const HeldLock& a, const HeldLock& b) {
+        return BucketOf(a.key_) < BucketOf(b.key_);
+    });
+
+    for (size_t i = 0; i < locks->size();)
+    {
+        Bucket* bucket = BucketOf((*locks)[i].key_);
+        bucket->latch_.Lock();
+        for (; i < locks->size() && BucketOf((*locks)[i].key_) == bucket; i++)
+        {
+            ReleaseLocked(bucket, (*locks)[i].txn_, (*locks)[i].key_);
+        }
+        bucket->latch_.Unlock();
+    }
+}
+
+void FlatLockManager::ReleaseLocked(Bucket* bucket, Txn* txn, const Key& key)
+{
+    LockEntry* entry = Find(bucket, key);
+    if (entry == NULL) return;
+
+    uint32_t position = 0;
+    while (position < entry->size_ && entry->TxnAt(position) != txn) position++;
+    if (position == entry->size_) return;
+
+    uint32_t granted_before = GrantedPrefix(*entry);
+    Erase(entry, position);
+
+    // See LockManagerB::Release.
+    uint32_t already_granted = granted_before - (position < granted_before ? 1 : 0);
+    uint32_t granted_after   = GrantedPrefix(*entry);
+    for (uint32_t i = already_granted; i < granted_after; i++) GrantLock(entry->TxnAt(i));
+
+    if (entry->size_ == 0) Free(bucket, entry);
+}
+
+// NOTE: The owners input vector is NOT assumed to be empty.
+LockMode FlatLockManager::Status(const Key& key, vector<Txn*>* owners)
+{
+    owners->clear();
+    Bucket* bucket = BucketOf(key);
+    bucket->latch_.Lock();
+    LockEntry* entry = Find(bucket, key);
+    LockMode mode    = UNLOCKED;
+    if (entry != NULL)
+    {
+        uint32_t granted = GrantedPrefix(*entry);
+        for (uint32_t i = 0; i < granted; i++) owners->push_back(entry->TxnAt(i));
+        mode = entry->ModeAt(0);
+    }
+    bucket->latch_.Unlock();
+    return mode;
+}
+
+int FlatLockManager::AdjustWaits(Txn* txn, int delta)
+{
+    WaitBucket* bucket = &wait_buckets_[(HashKey(reinterpret_cast<uintptr_t>(txn)) >> 20) & wait_mask_];
+    bucket->latch_.Lock();
+
+    WaitEntry* entry = NULL;
+    WaitEntry* free  = NULL;
+    for (int i = 0; i < kWaitsPerBucket && entry == NULL; i++)
+    {
+        if (bucket->entries_[i].txn_ == txn)
+            entry = &bucket->entries_[i];
+        else if (bucket->entries_[i].txn_ == NULL && free == NULL)
+            free = &bucket->entries_[i];
+    }
+    for (WaitEntry* e = bucket->chained_; e != NULL && entry == NULL; e = e->next_)
+    {
+        if (e->txn_ == txn) entry = e;
+    }
+
+    if (entry == NULL)
+    {
+        if (delta < 0)
+        {
+            bucket->latch_.Unlock();
+            return -1;
+        }
+        if (free == NULL)
+        {
+            free             = wait_pool_.Get();
+            free->next_      = bucket->chained_;
+            bucket->chained_ = free;
+        }
+        entry         = free;
+        entry->txn_   = txn;
+        entry->count_ = 0;
+    }
+
+    int count = (entry->count_ += delta);
+    if (count == 0)
+    {
+        entry->txn_ = NULL;
+        if (!(entry >= bucket->entries_ && entry < bucket->entries_ + kWaitsPerBucket))
+        {
+            WaitEntry** link = &bucket->chained_;
+            while (*link != entry) link = &(*link)->next_;
+            *link = entry->next_;
+            wait_pool_.Put(entry);
+        }
+    }
+    bucket->latch_.Unlock();
+    return count;
+}
+
+void FlatLockManager::GrantLock(Txn* txn)
+{
+    if (AdjustWaits(txn, -1) == 0)
+    {
+        ready_latch_.Lock();
+        ready_txns_->push_back(txn);
+        ready_latch_.Unlock();
+    }
+}
+
+void FlatLockManager::BeginRequests(Txn* txn) { AdjustWaits(txn, 1); }
+
+bool FlatLockManager::EndRequests(Txn* txn) { return AdjustWaits(txn, -1) == 0; }
+
+bool FlatLockManager::PopReady(Txn** txn)
+{
+    ready_latch_.Lock();
+    bool found = !ready_txns_->empty();
+    if (found)
+    {
+        *txn = ready_txns_->front();
+        ready_txns_->pop_front();
+    }
+    ready_latch_.Unlock();
+    return found;
+}
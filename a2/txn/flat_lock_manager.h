@@ -0,0 +1,219 @@
+
+// Cache-friendly, concurrently usable implementation of the LockManager
+// interface.
+
+#ifndef _FLAT_LOCK_MANAGER_H_
+#define _FLAT_LOCK_MANAGER_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "txn/lock_manager.h"
+#include "utils/mutex.h"
+
+using std::vector;
+
+// Free list of fixed-size nodes, carved out of chunks that are only returned
+// to the heap when the pool is destroyed. T must have a 'next_' pointer.
+template <typename T>
+class NodePool
+{
+   public:
+    NodePool() : free_(NULL) {}
+    ~NodePool()
+    {
+        for (size_t i = 0; i < chunks_.size(); i++) delete[] chunks_[i];
+    }
+
+    T* Get()
+    {
+        latch_.Lock();
+        if (free_ == NULL)
+        {
+            T* chunk = new T[kChunkSize];
+            chunks_.push_back(chunk);
+            for (int i = 0; i < kChunkSize; i++)
+            {
+                chunk[i].next_ = free_;
+                free_          = &chunk[i];
+            }
+        }
+        T* node = free_;
+        free_   = node->next_;
+        latch_.Unlock();
+        node->next_ = NULL;
+        return node;
+    }
+
+    void Put(T* node)
+    {
+        latch_.Lock();
+        node->next_ = free_;
+        free_       = node;
+        latch_.Unlock();
+    }
+
+   private:
+    static const int kChunkSize = 64;
+
+    SpinLatch latch_;
+    T* free_;
+    vector<T*> chunks_;
+};
+
+// Version of LockManagerB (shared and exclusive locks, same queueing rules)
+// that keeps its lock table in a flat array of latched buckets instead of an
+// unordered_map of heap-allocated deques.
+//
+// A key hashes to one bucket, which holds kEntriesPerBucket lock entries
+// inline and chains any further entries from a pool. Each entry stores the
+// first kInlineRequests requests of its queue inline and spills the rest into
+// pooled request nodes. Txn wait counts are kept in a second bucketed table of
+// the same shape instead of 'txn_waits_'. Once the pools are warm, locking and
+// releasing allocate nothing.
+//
+// Every call latches only the bucket of the key it touches (and, if needed,
+// the bucket of a txn's wait count), so several threads may use one
+// FlatLockManager concurrently. In that case a txn's lock requests may race
+// with releases that grant them: bracket the requests with BeginRequests()
+// and EndRequests() so the txn cannot be reported ready before its last
+// request has been enqueued, and take ready txns with PopReady() rather than
+// reading 'ready_txns' directly.
+class FlatLockManager : public LockManager
+{
+   public:
+    // 'buckets' is rounded up to a power of two. It bounds the number of keys
+    // that can be locked at once without chaining, not the number of keys.
+    explicit FlatLockManager(deque<Txn*>* ready_txns, size_t buckets = 1 << 14);
+    virtual ~FlatLockManager();
+    virtual bool ReadLock(Txn* txn, const Key& key);
+    virtual bool WriteLock(Txn* txn, const Key& key);
+    virtual void Release(Txn* txn, const Key& key);
+
+    // Groups the locks by bucket and latches each bucket once.
+    virtual void ReleaseAll(vector<HeldLock>* locks);
+    virtual LockMode Status(const Key& key, vector<Txn*>* owners);
+
+    // Marks the start of 'txn's lock requests. Until the matching
+    // EndRequests(), 'txn' is never appended to 'ready_txns'.
+    void BeginRequests(Txn* txn);
+
+    // Marks the end of 'txn's lock requests. Returns true if 'txn' now holds
+    // every lock it requested, in which case the caller is responsible for
+    // running it; otherwise 'txn' is appended to 'ready_txns' once its last
+    // lock is granted.
+    bool EndRequests(Txn* txn);
+
+    // Pops the next txn off 'ready_txns' under the manager's latch. Returns
+    // false if there is none.
+    bool PopReady(Txn** txn);
+
+   private:
+    static const int kInlineRequests   = 4;
+    static const int kEntriesPerBucket = 2;
+    static const int kWaitsPerBucket   = 4;
+
+    // Request beyond the first kInlineRequests in a queue.
+    struct SpilledRequest
+    {
+        SpilledRequest() : txn_(NULL), mode_(UNLOCKED), next_(NULL) {}
+
+        Txn* txn_;
+        LockMode mode_;
+        SpilledRequest* next_;
+    };
+
+    // Request queue for one key. Free iff size_ == 0.
+    struct LockEntry
+    {
+        LockEntry() : key_(0), size_(0), exclusive_(0), spilled_(NULL), next_(NULL) {}
+
+        Key key_;
+        uint32_t size_;        // Requests in the queue.
+        uint32_t exclusive_;   // EXCLUSIVE requests in the queue.
+        Txn* txns_[kInlineRequests];
+        uint8_t modes_[kInlineRequests];
+        SpilledRequest* spilled_;  // Requests [kInlineRequests, size_).
+        LockEntry* next_;          // Next chained entry in the bucket.
+
+        Txn* TxnAt(uint32_t i) const;
+        LockMode ModeAt(uint32_t i) const;
+    };
+
+    struct Bucket
+    {
+        Bucket() : chained_(NULL) {}
+
+        SpinLatch latch_;
+        LockEntry entries_[kEntriesPerBucket];
+        LockEntry* chained_;
+    };
+
+    // Number of lock requests 'txn_' is still waiting for. Free iff
+    // txn_ == NULL.
+    struct WaitEntry
+    {
+        WaitEntry() : txn_(NULL), count_(0), next_(NULL) {}
+
+        Txn* txn_;
+        int count_;
+        WaitEntry* next_;
+    };
+
+    struct WaitBucket
+    {
+        WaitBucket() : chained_(NULL) {}
+
+        SpinLatch latch_;
+        WaitEntry entries_[kWaitsPerBucket];
+        WaitEntry* chained_;
+    };
+
+    // Returns the bucket 'key' hashes to.
+    Bucket* BucketOf(const Key& key);
+
+    // Returns the entry for 'key' in '*bucket', or NULL if there is none
+    // (respectively, a newly claimed empty one). Requires the bucket latch.
+    LockEntry* Find(Bucket* bucket, const Key& key);
+    LockEntry* FindOrInsert(Bucket* bucket, const Key& key);
+
+    // Returns an emptied entry to its bucket. Requires the bucket latch.
+    void Free(Bucket* bucket, LockEntry* entry);
+
+    // Appends a request to, or removes the i-th request from, 'entry'.
+    void Append(LockEntry* entry, Txn* txn, LockMode mode);
+    void Erase(LockEntry* entry, uint32_t i);
+
+    // Release() on a key in '*bucket'. Requires the bucket latch.
+    void ReleaseLocked(Bucket* bucket, Txn* txn, const Key& key);
+
+    // Enqueues a request and returns true if it is immediately granted.
+    bool Lock(Txn* txn, const Key& key, LockMode mode);
+
+    // Adds 'delta' to 'txn's wait count and returns the new count, dropping
+    // the entry when it reaches zero. Returns -1 if 'txn' has no count and
+    // 'delta' is negative.
+    int AdjustWaits(Txn* txn, int delta);
+
+    // Records that 'txn' has acquired one of the locks it was waiting for.
+    void GrantLock(Txn* txn);
+
+    // Returns the number of requests at the front of 'entry's queue that hold
+    // the lock.
+    static uint32_t GrantedPrefix(const LockEntry& entry);
+
+    vector<Bucket> buckets_;
+    size_t bucket_mask_;
+
+    vector<WaitBucket> wait_buckets_;
+    size_t wait_mask_;
+
+    NodePool<SpilledRequest> request_pool_;
+    NodePool<LockEntry> entry_pool_;
+    NodePool<WaitEntry> wait_pool_;
+
+    // Guards 'ready_txns_'.
+    SpinLatch ready_latch_;
+};
+
+#endif  // _FLAT_LOCK_MANAGER_H_
@@ -0,0 +1,354 @@
+#include "txn/flat_lock_manager.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <atomic>
+#include <vector>
+
+#include "utils/testing.h"
+
+using std::vector;
+
+// Returns the current wall-clock time in seconds.
+static double Now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+TEST(FlatLockManager_SimpleLocking)
+{
+    deque<Txn*> ready_txns;
+    FlatLockManager lm(&ready_txns);
+    vector<Txn*> owners;
+
+    Txn* t1 = reinterpret_cast<Txn*>(1);
+    Txn* t2 = reinterpret_cast<Txn*>(2);
+    Txn* t3 = reinterpret_cast<Txn*>(3);
+
+    // Txn 1 acquires read lock.
+    EXPECT_TRUE(lm.ReadLock(t1, 101));
+    ready_txns.push_back(t1);  // Txn 1 is ready.
+    EXPECT_EQ(SHARED, lm.Status(101, &owners));
+    EXPECT_EQ(1, owners.size());
+    EXPECT_EQ(t1, owners[0]);
+
+    // Txn 2 requests write lock. Not granted.
+    EXPECT_FALSE(lm.WriteLock(t2, 101));
+    EXPECT_EQ(SHARED, lm.Status(101, &owners));
+    EXPECT_EQ(1, owners.size());
+    EXPECT_EQ(1, ready_txns.size());
+
+    // Txn 3 requests read lock. Not granted.
+    EXPECT_FALSE(lm.ReadLock(t3, 101));
+    EXPECT_EQ(1, ready_txns.size());
+
+    // Txn 1 releases lock.  Txn 2 is granted write lock.
+    lm.Release(t1, 101);
+    EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
+    EXPECT_EQ(1, owners.size());
+    EXPECT_EQ(t2, owners[0]);
+    EXPECT_EQ(2, ready_txns.size());
+    EXPECT_EQ(t2, ready_txns.at(1));
+
+    // Txn 2 releases lock.  Txn 3 is granted read lock.
+    lm.Release(t2, 101);
+    EXPECT_EQ(SHARED, lm.Status(101, &owners));
+    EXPECT_EQ(1, owners.size());
+    EXPECT_EQ(t3, owners[0]);
+    EXPECT_EQ(3, ready_txns.size());
+    EXPECT_EQ(t3, ready_txns.at(2));
+
+    // Txn 3 releases lock.  Nobody holds it any more.
+    lm.Release(t3, 101);
+    EXPECT_EQ(UNLOCKED, lm.Status(101, &owners));
+    EXPECT_EQ(0, owners.size());
+
+    END;
+}
+
+TEST(FlatLockManager_LocksReleasedOutOfOrder)
+{
+    deque<Txn*> ready_txns;
+    FlatLockManager lm(&ready_txns);
+    vector<Txn*> owners;
+
+    Txn* t1 = reinterpret_cast<Txn*>(1);
+    Txn* t2 = reinterpret_cast<Txn*>(2);
+    Txn* t3 = reinterpret_cast<Txn*>(3);
+    Txn* t4 = reinterpret_cast<Txn*>(4);
+
+    lm.ReadLock(t1, 101);      // Txn 1 acquires read lock.
+    ready_txns.push_back(t1);  // Txn 1 is ready.
+    lm.WriteLock(t2, 101);     // Txn 2 requests write lock. Not granted.
+    lm.ReadLock(t3, 101);      // Txn 3 requests read lock. Not granted.
+    lm.ReadLock(t4, 101);      // Txn 4 requests read lock. Not granted.
+
+    lm.Release(t2, 101);  // Txn 2 cancels write lock request.
+
+    // Txns 1, 3 and 4 should now all share a read lock.
+    EXPECT_EQ(SHARED, lm.Status(101, &owners));
+    EXPECT_EQ(3, owners.size());
+    EXPECT_EQ(t1, owners[0]);
+    EXPECT_EQ(t3, owners[1]);
+    EXPECT_EQ(t4, owners[2]);
+    EXPECT_EQ(3, ready_txns.size());
+    EXPECT_EQ(t3, ready_txns.at(1));
+    EXPECT_EQ(t4, ready_txns.at(2));
+
+    END;
+}
+
+TEST(FlatLockManager_ReleaseAll)
+{
+    deque<Txn*> ready_txns;
+    FlatLockManager lm(&ready_txns, 4);  // Few buckets, so keys share them.
+    vector<Txn*> owners;
+
+    Txn* t1 = reinterpret_cast<Txn*>(1);
+    Txn* t2 = reinterpret_cast<Txn*>(2);
+    Txn* t3 = reinterpret_cast<Txn*>(3);
+
+    // Txns 1 and 2 hold keys 0..19 between them; txn 3 waits for all of them.
+    vector<LockManager::HeldLock> held;
+    for (Key key = 0; key < 20; key++)
+    {
+        Txn* owner = (key % 2 == 0) ? t1 : t2;
+        EXPECT_TRUE(lm.WriteLock(owner, key));
+        held.push_back(LockManager::HeldLock(owner, key));
+    }
+    lm.BeginRequests(t3);
+    for (Key key = 0; key < 20; key++) EXPECT_FALSE(lm.ReadLock(t3, key));
+    EXPECT_FALSE(lm.EndRequests(t3));
+
+    lm.ReleaseAll(&held);
+    EXPECT_EQ(1, ready_txns.size());
+    EXPECT_EQ(t3, ready_txns.at(0));
+    for (Key key = 0; key < 20; key++)
+    {
+        EXPECT_EQ(SHARED, lm.Status(key, &owners));
+        EXPECT_EQ(1, owners.size());
+        EXPECT_EQ(t3, owners[0]);
+    }
+
+    END;
+}
+
+// Fills one bucket past its inline entries and one queue past its inline
+// requests, then drains both in arbitrary order.
+TEST(FlatLockManager_Spill)
+{
+    deque<Txn*> ready_txns;
+    FlatLockManager lm(&ready_txns, 1);  // A single bucket: every key collides.
+    vector<Txn*> owners;
+    const int kTxns = 10;
+    const int kKeys = 10;
+
+    // Txn i write-locks every key; only txn 1 gets them.
+    for (int i = 1; i <= kTxns; i++)
+    {
+        Txn* t = reinterpret_cast<Txn*>(i);
+        for (int k = 0; k < kKeys; k++) EXPECT_EQ((i == 1), lm.WriteLock(t, k));
+    }
+    for (int k = 0; k < kKeys; k++)
+    {
+        EXPECT_EQ(EXCLUSIVE, lm.Status(k, &owners));
+        EXPECT_EQ(reinterpret_cast<Txn*>(1), owners[0]);
+    }
+
+    // Cancel txn 7's (spilled) requests, then release in order; each txn
+    // becomes ready only once it has been granted every key.
+    for (int k = 0; k < kKeys; k++) lm.Release(reinterpret_cast<Txn*>(7), k);
+    for (int i = 1; i <= kTxns; i++)
+    {
+        if (i == 7) continue;
+        for (int k = kKeys - 1; k >= 0; k--)
+        {
+            EXPECT_EQ(EXCLUSIVE, lm.Status(k, &owners));
+            EXPECT_EQ(reinterpret_cast<Txn*>(i), owners[0]);
+            lm.Release(reinterpret_cast<Txn*>(i), k);
+        }
+    }
+    for (int k = 0; k < kKeys; k++) EXPECT_EQ(UNLOCKED, lm.Status(k, &owners));
+    EXPECT_EQ(kTxns - 2, ready_txns.size());
+    EXPECT_EQ(reinterpret_cast<Txn*>(2), ready_txns.at(0));
+    EXPECT_EQ(reinterpret_cast<Txn*>(10), ready_txns.back());
+
+    END;
+}
+
+// Shared state for concurrent FlatLockManager runs. Every txn locks a single
+// key, in the mode recorded for it in 'modes'.
+struct ConcurrentRun
+{
+    FlatLockManager* lm;
+    int nthreads;
+    int txns_per_thread;
+    int nkeys;
+    vector<Key> keys;
+    vector<LockMode> modes;
+    vector<std::atomic<int> >* holders;  // >0: readers, -1: a writer.
+    std::atomic<int> done;
+    std::atomic<bool> ok;
+};
+
+static Txn* TxnFor(int id) { return reinterpret_cast<Txn*>(static_cast<uintptr_t>(id + 1)); }
+static int IdOf(Txn* txn) { return static_cast<int>(reinterpret_cast<uintptr_t>(txn)) - 1; }
+
+// "Runs" txn 'id': checks that nobody holds a conflicting lock, then releases.
+static void RunAndRelease(ConcurrentRun* run, int id)
+{
+    std::atomic<int>& h = (*run->holders)[run->keys[id]];
+    if (run->modes[id] == EXCLUSIVE)
+    {
+        int expected = 0;
+        if (!h.compare_exchange_strong(expected, -1)) run->ok = false;
+        h.store(0);
+    }
+    else
+    {
+        if (h.fetch_add(1) < 0) run->ok = false;
+        h.fetch_sub(1);
+    }
+    run->lm->Release(TxnFor(id), run->keys[id]);
+    run->done.fetch_add(1);
+}
+
+static void* ConcurrentWorker(void* arg)
+{
+    ConcurrentRun* run = reinterpret_cast<ConcurrentRun*>(arg);
+    static std::atomic<int> next_thread(0);
+    int thread = next_thread.fetch_add(1) % run->nthreads;
+    int total  = run->nthreads * run->txns_per_thread;
+    Txn* ready;
+
+    for (int i = 0; i < run->txns_per_thread; i++)
+    {
+        int id = thread * run->txns_per_thread + i;
+        run->lm->BeginRequests(TxnFor(id));
+        if (run->modes[id] == EXCLUSIVE)
+            run->lm->WriteLock(TxnFor(id), run->keys[id]);
+        else
+            run->lm->ReadLock(TxnFor(id), run->keys[id]);
+        if (run->lm->EndRequests(TxnFor(id))) RunAndRelease(run, id);
+
+        while (run->lm->PopReady(&ready)) RunAndRelease(run, IdOf(ready));
+    }
+
+    while (run->done.load() < total)
+    {
+        if (run->lm->PopReady(&ready))
+            RunAndRelease(run, IdOf(ready));
+        else
+            sched_yield();
+    }
+    return NULL;
+}
+
+TEST(FlatLockManager_Concurrent)
+{
+    deque<Txn*> ready_txns;
+    FlatLockManager lm(&ready_txns, 16);
+
+    ConcurrentRun run;
+    run.lm              = &lm;
+    run.nthreads        = 4;
+    run.txns_per_thread = 20000;
+    run.nkeys           = 16;
+    run.done            = 0;
+    run.ok              = true;
+    vector<std::atomic<int> > holders(run.nkeys);
+    for (int k = 0; k < run.nkeys; k++) holders[k] = 0;
+    run.holders = &holders;
+
+    srand(1);
+    for (int i = 0; i < run.nthreads * run.txns_per_thread; i++)
+    {
+        run.keys.push_back(rand() % run.nkeys);
+        run.modes.push_back(rand() % 2 ? EXCLUSIVE : SHARED);
+    }
+
+    vector<pthread_t> threads(run.nthreads);
+    for (int i = 0; i < run.nthreads; i++) pthread_create(&threads[i], NULL, ConcurrentWorker, &run);
+    for (int i = 0; i < run.nthreads; i++) pthread_join(threads[i], NULL);
+
+    EXPECT_TRUE(run.ok.load());
+    EXPECT_EQ(run.nthreads * run.txns_per_thread, run.done.load());
+    vector<Txn*> owners;
+    for (int k = 0; k < run.nkeys; k++) EXPECT_EQ(UNLOCKED, lm.Status(k, &owners));
+
+    END;
+}
+
+// Replays the lock manager traffic of a single scheduler thread: txns with
+// 'nkeys' keys each (half read, half written) arrive one by one, and the
+// oldest one releases its locks once 'window' txns are active. Returns
+// millions of lock + release calls per second.
+double ReplaySchedule(LockManager* lm, deque<Txn*>* ready_txns, int dbsize, int ntxns)
+{
+    const int kKeysPerTxn = 10;
+    const int kWindow     = 100;
+
+    vector<Key> keys(ntxns * kKeysPerTxn);
+    for (size_t i = 0; i < keys.size(); i++) keys[i] = rand() % dbsize;
+
+    double start = Now();
+    for (int i = 0; i < ntxns + kWindow; i++)
+    {
+        if (i < ntxns)
+        {
+            for (int k = 0; k < kKeysPerTxn; k++)
+            {
+                if (k % 2 == 0)
+                    lm->ReadLock(TxnFor(i), keys[i * kKeysPerTxn + k]);
+                else
+                    lm->WriteLock(TxnFor(i), keys[i * kKeysPerTxn + k]);
+            }
+        }
+        int old = i - kWindow;
+        if (old >= 0)
+        {
+            for (int k = 0; k < kKeysPerTxn; k++) lm->Release(TxnFor(old), keys[old * kKeysPerTxn + k]);
+        }
+        ready_txns->clear();
+    }
+    double end = Now();
+    return 2.0 * ntxns * kKeysPerTxn / (end - start) / 1e6;
+}
+
+void Benchmark()
+{
+    const int kTxns = 200000;
+
+    cout << "\t\t-------------------------------------------------" << endl;
+    cout << "\t\t  Lock table throughput (M lock+release calls/s)" << endl;
+    cout << "\t\t-------------------------------------------------" << endl;
+    cout << "\t\tKeys\t\tLockManagerB\tFlatLockManager" << endl;
+
+    int dbsizes[] = {100, 1000000};
+    for (int d = 0; d < 2; d++)
+    {
+        deque<Txn*> ready_txns;
+        LockManagerB hashed(&ready_txns);
+        FlatLockManager flat(&ready_txns);
+
+        cout << "\t\t" << dbsizes[d] << "\t" << (dbsizes[d] < 1000000 ? "\t" : "") << flush;
+        srand(d);
+        cout << ReplaySchedule(&hashed, &ready_txns, dbsizes[d], kTxns) << "\t\t" << flush;
+        srand(d);
+        cout << ReplaySchedule(&flat, &ready_txns, dbsizes[d], kTxns) << endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    FlatLockManager_SimpleLocking();
+    FlatLockManager_LocksReleasedOutOfOrder();
+    FlatLockManager_ReleaseAll();
+    FlatLockManager_Spill();
+    FlatLockManager_Concurrent();
+    Benchmark();
+}
@@ -4,12 +4,47 @@
 
 #include "txn/lock_manager.h"
 
+LockManager::~LockManager()
+{
+    for (unordered_map<Key, deque<LockRequest>*>::iterator it = lock_table_.begin(); it != lock_table_.end(); ++it)
+    {
+        delete it->second;
+    }
+}
+
+deque<LockManager::LockRequest>* LockManager::RequestQueue(const Key& key)
+{
+    deque<LockRequest>*& requests = lock_table_[key];
+    if (requests == NULL) requests = new deque<LockRequest>();
+    return requests;
+}
+
+void LockManager::Grant(Txn* txn)
+{
+    unordered_map<Txn*, int>::iterator it = txn_waits_.find(txn);
+    if (it == txn_waits_.end()) return;
+    if (--it->second == 0)
+    {
+        txn_waits_.erase(it);
+        ready_txns_->push_back(txn);
+    }
+}
+
+void LockManager::ReleaseAll(vector<HeldLock>* locks)
+{
+    for (size_t i = 0; i < locks->size(); i++) Release((*locks)[i].txn_, (*locks)[i].key_);
+}
+
 LockManagerA::LockManagerA(deque<Txn*>* ready_txns) { ready_txns_ = ready_txns; }
 bool LockManagerA::WriteLock(Txn* txn, const Key& key)
 {
-    //
-    // Implement this method!
-    return true;
+    deque<LockRequest>* requests = RequestQueue(key);
+    requests->push_back(LockRequest(EXCLUSIVE, txn));
+    if (requests->size() == 1) return true;
+
+    // Someone else holds the lock.
+    txn_waits_[txn]++;
+    return false;
 }
 
 bool LockManagerA::ReadLock(Txn* txn, const Key& key)
@@ -21,43 +56,104 @@ bool LockManagerA::ReadLock(Txn* txn, const Key& key)
 
 void LockManagerA::Release(Txn* txn, const Key& key)
 {
-    //
-    // Implement this method!
+    unordered_map<Key, deque<LockRequest>*>::iterator entry = lock_table_.find(key);
+    if (entry == lock_table_.end()) return;
+    deque<LockRequest>* requests = entry->second;
+
+    for (deque<LockRequest>::iterator it = requests->begin(); it != requests->end(); ++it)
+    {
+        if (it->txn_ == txn)
+        {
+            bool was_owner = (it == requests->begin());
+            requests->erase(it);
+            // The next request in line (if any) now owns the lock.
+            if (was_owner && !requests->empty()) Grant(requests->front().txn_);
+            break;
+        }
+    }
 }
 
 // NOTE: The owners input vector is NOT assumed to be empty.
 LockMode LockManagerA::Status(const Key& key, vector<Txn*>* owners)
 {
-    //
-    // Implement this method!
-    return UNLOCKED;
+    owners->clear();
+    unordered_map<Key, deque<LockRequest>*>::iterator entry = lock_table_.find(key);
+    if (entry == lock_table_.end() || entry->second->empty()) return UNLOCKED;
+
+    owners->push_back(entry->second->front().txn_);
+    return EXCLUSIVE;
 }
 
 LockManagerB::LockManagerB(deque<Txn*>* ready_txns) { ready_txns_ = ready_txns; }
 bool LockManagerB::WriteLock(Txn* txn, const Key& key)
 {
-    //
-    // Implement this method!
-    return true;
+    deque<LockRequest>* requests = RequestQueue(key);
+    requests->push_back(LockRequest(EXCLUSIVE, txn));
+    if (requests->size() == 1) return true;
+
+    txn_waits_[txn]++;
+    return false;
 }
 
 bool LockManagerB::ReadLock(Txn* txn, const Key& key)
 {
-    //
-    // Implement this method!
-    return true;
+    deque<LockRequest>* requests = RequestQueue(key);
+
+    // A shared request is granted immediately iff every request ahead of it is
+    // also shared (i.e. all of them currently hold the lock).
+    bool granted = true;
+    for (deque<LockRequest>::iterator it = requests->begin(); it != requests->end(); ++it)
+    {
+        if (it->mode_ == EXCLUSIVE)
+        {
+            granted = false;
+            break;
+        }
+    }
+    requests->push_back(LockRequest(SHARED, txn));
+    if (granted) return true;
+
+    txn_waits_[txn]++;
+    return false;
+}
+
+size_t LockManagerB::GrantedPrefix(const deque<LockRequest>& requests)
+{
+    if (requests.empty()) return 0;
+    if (requests.front().mode_ == EXCLUSIVE) return 1;
+    size_t n = 0;
+    while (n < requests.size() && requests[n].mode_ == SHARED) n++;
+    return n;
 }
 
 void LockManagerB::Release(Txn* txn, const Key& key)
 {
-    //
-    // Implement this method!
+    unordered_map<Key, deque<LockRequest>*>::iterator entry = lock_table_.find(key);
+    if (entry == lock_table_.end()) return;
+    deque<LockRequest>* requests = entry->second;
+
+    size_t granted_before = GrantedPrefix(*requests);
+    size_t position       = 0;
+    while (position < requests->size() && (*requests)[position].txn_ != txn) position++;
+    if (position == requests->size()) return;
+    requests->erase(requests->begin() + position);
+
+    // Requests that were behind the granted prefix before the release but are
+    // inside it now have just acquired the lock. Positions shift down by one
+    // if the removed request was inside the old prefix.
+    size_t already_granted = granted_before - (position < granted_before ? 1 : 0);
+    size_t granted_after   = GrantedPrefix(*requests);
+    for (size_t i = already_granted; i < granted_after; i++) Grant((*requests)[i].txn_);
 }
 
 // NOTE: The owners input vector is NOT assumed to be empty.
 LockMode LockManagerB::Status(const Key& key, vector<Txn*>* owners)
 {
-    //
-    // Implement this method!
-    return UNLOCKED;
+    owners->clear();
+    unordered_map<Key, deque<LockRequest>*>::iterator entry = lock_table_.find(key);
+    if (entry == lock_table_.end() || entry->second->empty()) return UNLOCKED;
+
+    size_t granted = GrantedPrefix(*entry->second);
+    for (size_t i = 0; i < granted; i++) owners->push_back((*entry->second)[i].txn_);
+    return entry->second->front().mode_ == EXCLUSIVE ? EXCLUSIVE : SHARED;
 }
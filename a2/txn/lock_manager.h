@@ -30,7 +30,7 @@ enum LockMode
 class LockManager
 {
    public:
-    virtual ~LockManager() {}
+    virtual ~LockManager();
     // Attempts to grant a read lock to the specified transaction, enqueueing
     // request in lock table. Returns true if lock is immediately granted, else
     // returns false.
@@ -61,6 +61,18 @@ class LockManager
     // (Hint: Use 'LockManager::txn_waits_' defined below.)
     virtual void Release(Txn* txn, const Key& key) = 0;
 
+    // A lock held (or requested) by 'txn_' on 'key_'.
+    struct HeldLock
+    {
+        HeldLock(Txn* t, const Key& k) : txn_(t), key_(k) {}
+        Txn* txn_;
+        Key key_;
+    };
+
+    // Releases every lock in '*locks', with the same effect as calling
+    // Release() on each of them in some order. May reorder '*locks'.
+    virtual void ReleaseAll(vector<HeldLock>* locks);
+
     // Sets '*owners' to contain the txn IDs of all txns holding the lock, and
     // returns the current LockMode of the lock: UNLOCKED if it is not currently
     // held, SHARED or EXCLUSIVE if it is, depending on the current state.
@@ -99,8 +111,17 @@ class LockManager
         Txn* txn_;       // Pointer to txn requesting the lock.
         LockMode mode_;  // Specifies whether this is a read or write lock request.
     };
+
+   protected:
     unordered_map<Key, deque<LockRequest>*> lock_table_;
 
+    // Returns the request queue for 'key', creating an empty one if needed.
+    deque<LockRequest>* RequestQueue(const Key& key);
+
+    // Records that 'txn' has acquired one of the locks it was waiting for, and
+    // appends it to 'ready_txns_' once it is waiting for none.
+    void Grant(Txn* txn);
+
     // Queue of pointers to transactions that:
     //  (a) were previously blocked on acquiring at least one lock, and
     //  (b) have now acquired all locks that they have requested.
@@ -134,6 +155,12 @@ class LockManagerB : public LockManager
     virtual bool WriteLock(Txn* txn, const Key& key);
     virtual void Release(Txn* txn, const Key& key);
     virtual LockMode Status(const Key& key, vector<Txn*>* owners);
+
+   private:
+    // Returns the number of requests at the front of 'requests' that currently
+    // hold the lock: the first request if it is EXCLUSIVE, else the longest
+    // prefix of SHARED requests.
+    static size_t GrantedPrefix(const deque<LockRequest>& requests);
 };
 
 #endif  // _LOCK_MANAGER_H_
@@ -1,77 +1,248 @@
 
-
 #include "txn/mvcc_storage.h"
 
+MVCCStorage::MVCCStorage(Key capacity)
+    : capacity_(capacity), horizon_(0), live_versions_(0), retired_versions_(0)
+{
+    chains_ = new VersionChain[capacity_];
+}
+
 // Init the storage
 void MVCCStorage::InitStorage()
 {
     for (int i = 0; i < 1000000; i++)
     {
         Write(i, 0, 0);
-        Mutex* key_mutex = new Mutex();
-        mutexs_[i]       = key_mutex;
     }
 }
 
 // Free memory.
 MVCCStorage::~MVCCStorage()
 {
-    for (unordered_map<Key, deque<Version*>*>::iterator it = mvcc_data_.begin(); it != mvcc_data_.end(); ++it)
+    for (Key i = 0; i < capacity_; i++)
     {
-        delete it->second;
+        for (Version* v = chains_[i].head_.load(); v != NULL;)
+        {
+            Version* next = v->next_.load();
+            delete v;
+            v = next;
+        }
     }
+    delete[] chains_;
 
-    mvcc_data_.clear();
-
-    for (unordered_map<Key, Mutex*>::iterator it = mutexs_.begin(); it != mutexs_.end(); ++it)
+    for (unordered_map<Key, VersionChain*>::iterator it = fallback_.begin(); it != fallback_.end(); ++it)
     {
+        for (Version* v = it->second->head_.load(); v != NULL;)
+        {
+            Version* next = v->next_.load();
+            delete v;
+            v = next;
+        }
         delete it->second;
     }
+    // Retired versions are freed by 'epochs_'.
+}
+
+MVCCStorage::VersionChain* MVCCStorage::Find(Key key, bool create)
+{
+    if (key < capacity_) return &chains_[key];
+
+    fallback_mutex_.ReadLock();
+    unordered_map<Key, VersionChain*>::iterator it = fallback_.find(key);
+    VersionChain* chain = (it == fallback_.end()) ? NULL : it->second;
+    fallback_mutex_.Unlock();
+    if (chain != NULL || !create) return chain;
+
+    fallback_mutex_.WriteLock();
+    VersionChain*& slot = fallback_[key];
+    if (slot == NULL) slot = new VersionChain();
+    chain = slot;
+    fallback_mutex_.Unlock();
+    return chain;
+}
 
-    mutexs_.clear();
+Version* MVCCStorage::Visible(VersionChain* chain, uint64 txn_unique_id)
+{
+    Version* v = chain->head_.load(std::memory_order_acquire);
+    while (v != NULL && v->version_id_ > txn_unique_id) v = v->next_.load(std::memory_order_acquire);
+    return v;
+}
+
+void MVCCStorage::DeleteVersion(void* version) { delete reinterpret_cast<Version*>(version); }
+
+// Lock the key to protect its version_list. Remember to lock the key when you update the version_list
+void MVCCStorage::Lock(Key key)
+{
+    VersionChain* chain = Find(key, true);
+    uint32 seq          = chain->seq_.load(std::memory_order_relaxed);
+    for (int spins = 0; (seq & 1) || !chain->seq_.compare_exchange_weak(seq, seq + 1); spins++)
+    {
+        if (spins > 64) sched_yield();
+        seq = chain->seq_.load(std::memory_order_relaxed);
+    }
 }
 
-// Lock the key to protect its version_list. Remember to lock the key when you read/update the version_list
-void MVCCStorage::Lock(Key key) { mutexs_[key]->Lock(); }
 // Unlock the key.
-void MVCCStorage::Unlock(Key key) { mutexs_[key]->Unlock(); }
+void MVCCStorage::Unlock(Key key) { Find(key, false)->seq_.fetch_add(1, std::memory_order_release); }
+
 // MVCC Read
-bool MVCCStorage::Read(Key key, Value* result, int txn_unique_id)
+bool MVCCStorage::Read(Key key, Value* result, uint64 txn_unique_id)
 {
-    //
-    // Implement this method!
+    VersionChain* chain = Find(key, false);
+    if (chain == NULL) return false;
 
-    // Hint: Iterate the version_lists and return the verion whose write timestamp
-    // (version_id) is the largest write timestamp less than or equal to txn_unique_id.
+    EpochGuard guard(&epochs_);
+    for (int spins = 0;; spins++)
+    {
+        uint32 seq = chain->seq_.load(std::memory_order_acquire);
+        if (seq & 1)
+        {
+            // A writer is checking or installing versions of this key.
+            if (spins > 64) sched_yield();
+            continue;
+        }
+
+        Version* v = Visible(chain, txn_unique_id);
+        if (v != NULL)
+        {
+            uint64 max_read = v->max_read_id_.load();
+            while (max_read < txn_unique_id && !v->max_read_id_.compare_exchange_weak(max_read, txn_unique_id))
+            {
+            }
+        }
 
-    return true;
+        Value value = (v == NULL) ? 0 : v->value_;
+
+        // If no writer took the key since we started, any later CheckWrite
+        // will see our max_read_id_.
+        if (chain->seq_.load() == seq)
+        {
+            if (v == NULL) return false;
+            *result = value;
+            return true;
+        }
+    }
 }
 
 // Check whether apply or abort the write
-bool MVCCStorage::CheckWrite(Key key, int txn_unique_id)
+bool MVCCStorage::CheckWrite(Key key, uint64 txn_unique_id)
 {
-    //
-    // Implement this method!
+    // The caller holds Lock(key), so no new version can appear, and any
+    // reader that raised max_read_id_ before we look will be seen here.
+    VersionChain* chain = Find(key, false);
+    if (chain == NULL) return true;
+    Version* v = Visible(chain, txn_unique_id);
+    return v == NULL || v->max_read_id_.load() <= txn_unique_id;
+}
 
-    // Hint: Before all writes are applied, we need to make sure that each write
-    // can be safely applied based on MVCC timestamp ordering protocol. This method
-    // only checks one key, so you should call this method for each key in the
-    // write_set. Return true if this key passes the check, return false if not.
-    // Note that you don't have to call Lock(key) in this method, just
-    // call Lock(key) before you call this method and call Unlock(key) afterward.
+// MVCC Write, call this method only if CheckWrite return true.
+void MVCCStorage::Write(Key key, Value value, uint64 txn_unique_id)
+{
+    VersionChain* chain = Find(key, true);
 
-    return true;
+    // Find the insertion point that keeps the chain sorted newest-first
+    // (almost always the head).
+    std::atomic<Version*>* link = &chain->head_;
+    Version* next               = link->load(std::memory_order_relaxed);
+    while (next != NULL && next->version_id_ > txn_unique_id)
+    {
+        link = &next->next_;
+        next = link->load(std::memory_order_relaxed);
+    }
+
+    if (next != NULL && next->version_id_ == txn_unique_id)
+    {
+        // Overwrite of a version written by the same txn.
+        next->value_ = value;
+    }
+    else
+    {
+        Version* v     = new Version();
+        v->value_      = value;
+        v->max_read_id_ = txn_unique_id;
+        v->version_id_ = txn_unique_id;
+        v->next_.store(next, std::memory_order_relaxed);
+        link->store(v, std::memory_order_release);
+        live_versions_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Every version after the newest one visible at the horizon is dead.
+    Version* keep = Visible(chain, horizon_.load(std::memory_order_acquire));
+    if (keep == NULL) return;
+    Version* dead = keep->next_.load(std::memory_order_relaxed);
+    if (dead == NULL) return;
+    keep->next_.store(NULL, std::memory_order_release);
+
+    uint64 ndead = 0;
+    while (dead != NULL)
+    {
+        Version* older = dead->next_.load(std::memory_order_relaxed);
+        epochs_.Retire(dead, DeleteVersion);
+        dead = older;
+        ndead++;
+    }
+    live_versions_.fetch_sub(ndead, std::memory_order_relaxed);
+    retired_versions_.fetch_add(ndead, std::memory_order_relaxed);
 }
 
-// MVCC Write, call this method only if CheckWrite return true.
-void MVCCStorage::Write(Key key, Value value, int txn_unique_id)
+bool MVCCStorage::ReadNewest(VersionChain* chain, Value* result)
+{
+    EpochGuard guard(&epochs_);
+    for (int spins = 0;; spins++)
+    {
+        uint32 seq = chain->seq_.load(std::memory_order_acquire);
+        if (seq & 1)
+        {
+            if (spins > 64) sched_yield();
+            continue;
+        }
+
+        Version* v  = chain->head_.load(std::memory_order_acquire);
+        Value value = (v == NULL) ? 0 : v->value_;
+        if (chain->seq_.load() == seq)
+        {
+            if (v == NULL) return false;
+            *result = value;
+            return true;
+        }
+    }
+}
+
+void MVCCStorage::ForEach(const std::function<void(Key, Value)>& visit)
+{
+    Value value;
+    for (Key key = 0; key < capacity_; key++)
+    {
+        if (ReadNewest(&chains_[key], &value)) visit(key, value);
+    }
+
+    fallback_mutex_.ReadLock();
+    vector<pair<Key, VersionChain*> > chains(fallback_.begin(), fallback_.end());
+    fallback_mutex_.Unlock();
+    for (size_t i = 0; i < chains.size(); i++)
+    {
+        if (ReadNewest(chains[i].second, &value)) visit(chains[i].first, value);
+    }
+}
+
+void MVCCStorage::Load(Key first, const Value* values, Key count)
+{
+    // Every version is its own allocation (GC frees them one at a time), so
+    // this is InitStorage's loop; callers split the keys across threads.
+    for (Key i = 0; i < count; i++) Write(first + i, values[i], 0);
+}
+
+void MVCCStorage::SetHorizon(uint64 horizon)
+{
+    uint64 current = horizon_.load();
+    while (current < horizon && !horizon_.compare_exchange_weak(current, horizon))
+    {
+    }
+}
+
+size_t MVCCStorage::Reclaim()
 {
-    //
-    // Implement this method!
-
-    // Hint: Insert a new version (malloc a Version and specify its value/version_id/max_read_id)
-    // into the version_lists. Note that InitStorage() also calls this method to init storage.
-    // Note that you don't have to call Lock(key) in this method, just
-    // call Lock(key) before you call this method and call Unlock(key) afterward.
-    // Note that the performance would be much better if you organize the versions in decreasing order.
+    size_t freed = epochs_.Collect();
+    retired_versions_.fetch_sub(freed, std::memory_order_relaxed);
+    return freed;
 }
@@ -2,35 +2,63 @@
 #ifndef _MVCC_STORAGE_H_
 #define _MVCC_STORAGE_H_
 
+#include <atomic>
+
 #include "txn/storage.h"
+#include "utils/epoch.h"
 
 // MVCC 'version' structure
 struct Version
 {
-    Value value_;      // The value of this version
-    int max_read_id_;  // Largest timestamp of a transaction that read the version
-    int version_id_;   // Timestamp of the transaction that created(wrote) the version
+    Value value_;                    // The value of this version
+    std::atomic<uint64> max_read_id_;  // Largest timestamp of a transaction that read the version
+    uint64 version_id_;                // Timestamp of the transaction that created(wrote) the version
+    std::atomic<Version*> next_;     // Next older version of the same key
 };
 
 // MVCC storage
+//
+// Each key has a singly-linked chain of versions, newest first, reached
+// through an atomic head pointer, plus a sequence number that writers use as
+// a per-key spinlock: Lock() makes it odd and Unlock() makes it even again.
+// Readers never take the lock. They find the version they can see, raise its
+// max_read_id_, and retry if a writer held or took the key meanwhile. This
+// guarantees that a CheckWrite() racing with the read either sees the new
+// max_read_id_ or forces the read to see the new version.
+//
+// Versions older than the newest one visible at the GC horizon (see
+// SetHorizon) can never be read again. They are unlinked by the next writer
+// of the key and freed through an EpochManager once no reader can still be
+// traversing them.
 class MVCCStorage : public Storage
 {
    public:
+    explicit MVCCStorage(Key capacity = 1000000);
+
     // If there exists a record for the specified key, sets '*result' equal to
     // the value associated with the key and returns true, else returns false;
     // The third parameter is the txn_unique_id(txn timestamp), which is used for MVCC.
-    virtual bool Read(Key key, Value* result, int txn_unique_id = 0);
+    virtual bool Read(Key key, Value* result, uint64 txn_unique_id = 0);
 
     // Inserts a new version with key and value
     // The third parameter is the txn_unique_id(txn timestamp), which is used for MVCC.
-    virtual void Write(Key key, Value value, int txn_unique_id = 0);
+    virtual void Write(Key key, Value value, uint64 txn_unique_id = 0);
 
     // Returns the timestamp at which the record with the specified key was last
     // updated (returns 0 if the record has never been updated). This is used for OCC.
-    virtual double Timestamp(Key key) { return 0; }
+    virtual uint64 Timestamp(Key key) { return 0; }
     // Init storage
     virtual void InitStorage();
 
+    // Visits the newest version of every key, without raising its
+    // max_read_id_: a scan must not make writers abort.
+    virtual void ForEach(const std::function<void(Key, Value)>& visit);
+
+    // Gives each key a single version, written at timestamp 0.
+    virtual void Load(Key first, const Value* values, Key count);
+
+    virtual bool ConcurrentWrites() const { return true; }
+
     // Lock the version_list of key
     virtual void Lock(Key key);
 
@@ -38,18 +66,65 @@ class MVCCStorage : public Storage
     virtual void Unlock(Key key);
 
     // Check whether apply or abort the write
-    virtual bool CheckWrite(Key key, int txn_unique_id);
+    virtual bool CheckWrite(Key key, uint64 txn_unique_id);
 
     virtual ~MVCCStorage();
 
+    // Declares that no txn with a timestamp below 'horizon' will read or write
+    // any more. Later writes may then drop versions only such txns could see.
+    // The horizon never moves backwards.
+    void SetHorizon(uint64 horizon);
+
+    // Frees unlinked versions that no reader can still reach. Returns the
+    // number of versions freed.
+    size_t Reclaim();
+
+    // Number of versions reachable from some key, and number unlinked but not
+    // yet freed.
+    uint64 LiveVersions() const { return live_versions_.load(std::memory_order_relaxed); }
+    uint64 RetiredVersions() const { return retired_versions_.load(std::memory_order_relaxed); }
+
    private:
     friend class TxnProcessor;
 
-    // Storage for MVCC, each key has a linklist of versions
-    unordered_map<Key, deque<Version*>*> mvcc_data_;
+    // Version chain and writer lock of one key.
+    struct VersionChain
+    {
+        VersionChain() : head_(NULL), seq_(0) {}
+        std::atomic<Version*> head_;
+        std::atomic<uint32> seq_;
+    };
+
+    // Returns the chain for 'key', or NULL if 'key' is out of range and has
+    // never been written. With 'create', allocates a fallback chain instead
+    // of returning NULL.
+    VersionChain* Find(Key key, bool create);
+
+    // Returns the newest version in 'chain' written at or before 'txn_unique_id'.
+    static Version* Visible(VersionChain* chain, uint64 txn_unique_id);
+
+    static void DeleteVersion(void* version);
+
+    // Returns the value of the newest version in 'chain' through '*result',
+    // or false if the chain is empty.
+    bool ReadNewest(VersionChain* chain, Value* result);
+
+    Key capacity_;
+
+    // Chains for keys < capacity_.
+    VersionChain* chains_;
+
+    // Chains for other keys, guarded by 'fallback_mutex_'.
+    unordered_map<Key, VersionChain*> fallback_;
+    MutexRW fallback_mutex_;
+
+    // Oldest timestamp any txn may still read at.
+    std::atomic<uint64> horizon_;
+
+    EpochManager epochs_;
 
-    // Mutexs for each key
-    unordered_map<Key, Mutex*> mutexs_;
+    std::atomic<uint64> live_versions_;
+    std::atomic<uint64> retired_versions_;
 };
 
 #endif  // _MVCC_STORAGE_H_
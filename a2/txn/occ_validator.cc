@@ -0,0 +1,145 @@
+#include "txn/occ_validator.h"
+
+#include <sched.h>
+
+OCCValidator::OCCValidator(size_t slots)
+    : nslots_(slots > 0 ? slots : 1),
+      next_ticket_(0),
+      horizon_(0),
+      checked_(0),
+      filtered_(0)
+{
+    slots_ = new Slot[nslots_];
+}
+
+OCCValidator::~OCCValidator() { delete[] slots_; }
+
+uint64 OCCValidator::Enter(const KeySet* writes, const KeySignature* signature)
+{
+    uint64 ticket = next_ticket_.fetch_add(1, std::memory_order_seq_cst);
+    Slot* slot    = SlotOf(ticket);
+
+    // Wait for the slot's previous txn to publish and then finish. It is
+    // running on another worker, so this is brief unless the ring is small.
+    uint64 previous = (ticket >= nslots_) ? 2 * (ticket - nslots_ + 1) : 0;
+    int spins       = 0;
+    while (slot->version_.load(std::memory_order_acquire) != previous ||
+           slot->state_.load(std::memory_order_acquire) == ACTIVE)
+    {
+        if (++spins > 64) sched_yield();
+    }
+
+    slot->version_.store(2 * ticket + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->state_.store(ACTIVE, std::memory_order_relaxed);
+    int nkeys = (writes == NULL) ? 0 : static_cast<int>(writes->size());
+    if (nkeys > kMaxKeys)
+    {
+        nkeys = -1;
+    }
+    else if (nkeys > 0)
+    {
+        int i = 0;
+        for (KeySet::iterator it = writes->begin(); it != writes->end(); ++it)
+        {
+            slot->keys_[i++].store(*it, std::memory_order_relaxed);
+        }
+    }
+    slot->nkeys_.store(nkeys, std::memory_order_relaxed);
+    for (int i = 0; i < KeySignature::kWords; i++)
+    {
+        slot->signature_[i].store(signature == NULL ? ~0ull : signature->Word(i), std::memory_order_relaxed);
+    }
+    slot->version_.store(2 * (ticket + 1), std::memory_order_seq_cst);
+    return ticket;
+}
+
+bool OCCValidator::Validate(uint64 start, uint64 ticket, const KeySet& readset, const KeySet& writeset,
+                            const KeySignature* signature)
+{
+    bool valid      = true;
+    uint64 filtered = 0;
+    uint64 other;
+    for (other = start; other < ticket && valid; other++)
+    {
+        valid = !Conflicts(other, readset, writeset, signature, &filtered);
+    }
+    checked_.fetch_add(other - start, std::memory_order_relaxed);
+    filtered_.fetch_add(filtered, std::memory_order_relaxed);
+    return valid;
+}
+
+bool OCCValidator::Conflicts(uint64 ticket, const KeySet& readset, const KeySet& writeset,
+                             const KeySignature* signature, uint64* filtered) const
+{
+    Slot* slot       = SlotOf(ticket);
+    uint64 published = 2 * (ticket + 1);
+    int spins        = 0;
+    while (true)
+    {
+        uint64 version = slot->version_.load(std::memory_order_acquire);
+        if (version > published) return true;  // Reused: the write set is gone.
+        if (version == published) break;
+        if (++spins > 64) sched_yield();
+    }
+
+    int state     = slot->state_.load(std::memory_order_seq_cst);
+    int nkeys     = slot->nkeys_.load(std::memory_order_relaxed);
+    bool conflict = (nkeys < 0);
+
+    // Disjoint signatures rule out a conflict without looking at any keys.
+    if (signature != NULL)
+    {
+        KeySignature written;
+        for (int i = 0; i < KeySignature::kWords; i++)
+        {
+            written.SetWord(i, slot->signature_[i].load(std::memory_order_relaxed));
+        }
+        if (!written.Intersects(*signature))
+        {
+            nkeys    = 0;
+            conflict = false;
+            (*filtered)++;
+        }
+    }
+
+    // Merge the slot's sorted keys against both sorted sets.
+    KeySet::iterator r = readset.begin();
+    KeySet::iterator w = writeset.begin();
+    for (int i = 0; i < nkeys && !conflict; i++)
+    {
+        Key key = slot->keys_[i].load(std::memory_order_relaxed);
+        while (r != readset.end() && *r < key) ++r;
+        while (w != writeset.end() && *w < key) ++w;
+        conflict = (r != readset.end() && *r == key) || (w != writeset.end() && *w == key);
+    }
+
+    // If the slot was reused while we read it, what we read may be torn.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->version_.load(std::memory_order_relaxed) != published) return true;
+    return state != ABORTED && conflict;
+}
+
+void OCCValidator::Finish(uint64 ticket, bool committed)
+{
+    SlotOf(ticket)->state_.store(committed ? COMMITTED : ABORTED, std::memory_order_seq_cst);
+    AdvanceHorizon();
+}
+
+void OCCValidator::AdvanceHorizon()
+{
+    // Every finishing txn runs this after marking its slot, so whichever of
+    // two adjacent txns finishes last moves the horizon past both.
+    uint64 horizon = horizon_.load(std::memory_order_seq_cst);
+    while (true)
+    {
+        Slot* slot     = SlotOf(horizon);
+        uint64 version = slot->version_.load(std::memory_order_seq_cst);
+        if (version < 2 * (horizon + 1)) return;  // Not yet published.
+        if (version == 2 * (horizon + 1) && slot->state_.load(std::memory_order_seq_cst) == ACTIVE) return;
+
+        // Finished, or finished and since reused. On failure, 'horizon' is
+        // reloaded and we try again from there.
+        if (horizon_.compare_exchange_weak(horizon, horizon + 1, std::memory_order_seq_cst)) horizon++;
+    }
+}
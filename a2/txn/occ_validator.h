@@ -0,0 +1,129 @@
+
+// Validation state shared by the workers of the parallel OCC (P_OCC) mode.
+
+#ifndef _OCC_VALIDATOR_H_
+#define _OCC_VALIDATOR_H_
+
+#include <stddef.h>
+#include <atomic>
+
+#include "txn/common.h"
+#include "txn/txn.h"
+#include "utils/atomic.h"
+#include "utils/key_signature.h"
+
+// Lock-free "active set" for OCC with parallel validation.
+//
+// Every txn that finishes its read phase takes the next value of a logical
+// counter as its ticket, and publishes a copy of its write set in the slot
+// 'ticket % slots' of a ring. It then checks its read and write sets against
+// the write sets in the slots of every ticket issued since it began reading.
+// Those are exactly the txns that may have written a key after the txn read
+// it (or may still do so): anything older had fully applied its writes
+// before the txn started. Tickets therefore serve as logical commit
+// timestamps, and no validator ever takes a lock or copies a set.
+//
+// Usage, from any thread:
+//
+//     uint64 start = validator.Begin();
+//     ... read phase ...
+//     uint64 ticket = validator.Enter(&writeset);
+//     bool valid = validator.Validate(start, ticket, readset, writeset);
+//     ... write phase, if valid ...
+//     validator.Finish(ticket, valid);
+//
+// Each slot also holds a KeySignature of its write set. When the caller
+// passes the signature of the keys it read and wrote, a slot whose signature
+// does not intersect it is passed over with a few vector instructions, and
+// only the remaining slots have their key arrays merged against the txn's.
+//
+// Slots are overwritten only after their txn has finished, and a txn whose
+// range of tickets has been partly overwritten in the meantime (because more
+// than 'slots' txns entered validation during its read phase) fails
+// validation rather than risk missing a conflict. So does a txn whose
+// signature intersects that of a write set of more than kMaxKeys keys.
+class OCCValidator
+{
+   public:
+    // Largest write set that is copied into a slot. Larger ones are treated
+    // as conflicting with any txn whose signature intersects theirs.
+    static const int kMaxKeys = 32;
+
+    explicit OCCValidator(size_t slots = 1024);
+    ~OCCValidator();
+
+    // Returns the start point of a txn about to begin its read phase: every
+    // txn whose ticket is below it has fully applied its writes.
+    uint64 Begin() const { return horizon_.load(std::memory_order_seq_cst); }
+
+    // Assigns the calling txn its ticket and publishes 'writes' (the keys it
+    // is going to write, or NULL for none) in the ticket's slot, along with
+    // their signature 'signature' (NULL to publish none, in which case other
+    // txns always check the keys themselves).
+    uint64 Enter(const KeySet* writes, const KeySignature* signature = NULL);
+
+    // Returns true if no txn with a ticket in [start, ticket) (other than
+    // ones that aborted) has written, or may yet write, a key in 'readset'
+    // or 'writeset'. 'signature', if not NULL, must cover both sets.
+    bool Validate(uint64 start, uint64 ticket, const KeySet& readset, const KeySet& writeset,
+                  const KeySignature* signature = NULL);
+
+    // Number of slots checked by Validate(), and how many of them were
+    // passed over on their signatures alone.
+    uint64 SlotsChecked() const { return checked_.load(std::memory_order_relaxed); }
+    uint64 SlotsFiltered() const { return filtered_.load(std::memory_order_relaxed); }
+
+    // Marks the txn holding 'ticket' as finished, once it has applied its
+    // writes (if 'committed') or given up.
+    void Finish(uint64 ticket, bool committed);
+
+    // Number of txns that have entered validation.
+    uint64 Tickets() const { return next_ticket_.load(std::memory_order_relaxed); }
+
+   private:
+    enum SlotState
+    {
+        ACTIVE    = 0,  // Validating, or applying its writes.
+        COMMITTED = 1,
+        ABORTED   = 2,
+    };
+
+    // One published write set. 'version_' is 2 * (ticket + 1) once the slot
+    // holds the given ticket's write set, and odd while it is being filled.
+    struct Slot
+    {
+        Slot() : version_(0), state_(ABORTED), nkeys_(0) {}
+        std::atomic<uint64> version_;
+        std::atomic<int> state_;
+        std::atomic<int> nkeys_;  // -1 if the write set did not fit.
+        std::atomic<Key> keys_[kMaxKeys];
+        std::atomic<uint64> signature_[KeySignature::kWords];  // All ones if none.
+    };
+
+    Slot* SlotOf(uint64 ticket) const { return &slots_[ticket % nslots_]; }
+
+    // Returns true if the write set in the slot of 'ticket' intersects
+    // 'readset' or 'writeset' (or can no longer be read); false if it does
+    // not, or if its txn aborted. Waits for the slot to be published.
+    // Increments '*filtered' if the signatures alone showed no conflict.
+    bool Conflicts(uint64 ticket, const KeySet& readset, const KeySet& writeset, const KeySignature* signature,
+                   uint64* filtered) const;
+
+    // Moves 'horizon_' past every finished txn at its front.
+    void AdvanceHorizon();
+
+    Slot* slots_;
+    size_t nslots_;
+
+    char pad0_[CACHE_LINE_SIZE];
+    std::atomic<uint64> next_ticket_;
+    char pad1_[CACHE_LINE_SIZE];
+    std::atomic<uint64> horizon_;
+    char pad2_[CACHE_LINE_SIZE];
+
+    // Statistics, counted per Validate() call.
+    std::atomic<uint64> checked_;
+    std::atomic<uint64> filtered_;
+};
+
+#endif  // _OCC_VALIDATOR_H_
@@ -0,0 +1,200 @@
+#include "txn/occ_validator.h"
+
+#include <map>
+
+#include "txn/txn_processor.h"
+#include "txn/txn_types.h"
+#include "utils/testing.h"
+
+using std::map;
+
+static KeySet Keys(Key a, Key b)
+{
+    KeySet keys;
+    keys.insert(a);
+    keys.insert(b);
+    return keys;
+}
+
+TEST(OCCValidator_Conflicts)
+{
+    OCCValidator validator;
+    KeySet none;
+    KeySet writes = Keys(1, 2);
+
+    // Three txns start together. The first to enter validation writes keys
+    // 1 and 2, and has nothing to check against.
+    uint64 start   = validator.Begin();
+    uint64 ticket1 = validator.Enter(&writes);
+    EXPECT_TRUE(validator.Validate(start, ticket1, writes, writes));
+
+    // The second read key 2, which the first may be writing.
+    uint64 ticket2 = validator.Enter(NULL);
+    EXPECT_FALSE(validator.Validate(start, ticket2, Keys(2, 3), none));
+    validator.Finish(ticket2, false);
+
+    // The third touched neither key.
+    uint64 ticket3 = validator.Enter(&none);
+    EXPECT_TRUE(validator.Validate(start, ticket3, Keys(3, 4), Keys(5, 6)));
+    validator.Finish(ticket3, true);
+
+    // Until the first finishes, txns starting now must still check it.
+    EXPECT_EQ(0, validator.Begin());
+    validator.Finish(ticket1, true);
+    EXPECT_EQ(3, validator.Begin());
+    EXPECT_EQ(3, validator.Tickets());
+
+    END;
+}
+
+TEST(OCCValidator_IgnoresAborted)
+{
+    OCCValidator validator;
+    KeySet writes = Keys(1, 2);
+
+    uint64 start   = validator.Begin();
+    uint64 ticket1 = validator.Enter(&writes);
+    validator.Finish(ticket1, false);
+
+    // The first txn never wrote, so reading its keys is fine.
+    uint64 ticket2 = validator.Enter(NULL);
+    EXPECT_TRUE(validator.Validate(start, ticket2, writes, KeySet()));
+    validator.Finish(ticket2, true);
+
+    END;
+}
+
+TEST(OCCValidator_SlotReuse)
+{
+    OCCValidator validator(4);
+    KeySet writes = Keys(1, 2);
+    uint64 start  = validator.Begin();
+
+    // More txns than slots enter and finish while one txn is reading.
+    for (int i = 0; i < 6; i++)
+    {
+        uint64 ticket = validator.Enter(&writes);
+        validator.Finish(ticket, true);
+    }
+    EXPECT_EQ(6, validator.Begin());
+
+    // The slow txn can no longer see what the first ones wrote, so it must
+    // fail even though its keys overlap none of them.
+    uint64 ticket = validator.Enter(NULL);
+    EXPECT_FALSE(validator.Validate(start, ticket, Keys(7, 8), KeySet()));
+    validator.Finish(ticket, false);
+
+    // A txn whose range is still intact only checks the slots it needs.
+    start  = validator.Begin();
+    ticket = validator.Enter(NULL);
+    EXPECT_TRUE(validator.Validate(start, ticket, Keys(7, 8), KeySet()));
+    validator.Finish(ticket, true);
+
+    END;
+}
+
+TEST(OCCValidator_LargeWriteSet)
+{
+    OCCValidator validator;
+    KeySet writes;
+    for (int i = 0; i <= OCCValidator::kMaxKeys; i++) writes.insert(i);
+
+    uint64 start   = validator.Begin();
+    uint64 ticket1 = validator.Enter(&writes);
+    uint64 ticket2 = validator.Enter(NULL);
+
+    // The write set did not fit in its slot, so it conflicts with anything.
+    EXPECT_FALSE(validator.Validate(start, ticket2, Keys(1000, 1001), KeySet()));
+    validator.Finish(ticket1, true);
+    validator.Finish(ticket2, false);
+
+    END;
+}
+
+TEST(OCCValidator_Signatures)
+{
+    OCCValidator validator;
+    KeySet large;
+    KeySignature large_signature;
+    for (Key key = 0; key <= OCCValidator::kMaxKeys; key++)
+    {
+        large.insert(key);
+        large_signature.Add(key);
+    }
+
+    // Find two keys the signature of the large write set rules out.
+    KeySet reads;
+    KeySignature reads_signature;
+    for (Key key = 1000; reads.size() < 2; key++)
+    {
+        if (large_signature.MayContain(key)) continue;
+        reads.insert(key);
+        reads_signature.Add(key);
+    }
+
+    uint64 start   = validator.Begin();
+    uint64 ticket1 = validator.Enter(&large, &large_signature);
+    uint64 ticket2 = validator.Enter(NULL);
+
+    // The write set did not fit in its slot, but its signature shows it
+    // cannot conflict.
+    EXPECT_TRUE(validator.Validate(start, ticket2, reads, KeySet(), &reads_signature));
+    EXPECT_EQ(1, validator.SlotsChecked());
+    EXPECT_EQ(1, validator.SlotsFiltered());
+
+    // Without a signature to compare, the slot has to be checked in full.
+    uint64 ticket3 = validator.Enter(NULL);
+    EXPECT_FALSE(validator.Validate(start, ticket3, reads, KeySet()));
+    EXPECT_EQ(1, validator.SlotsFiltered());
+
+    validator.Finish(ticket1, true);
+    validator.Finish(ticket2, true);
+    validator.Finish(ticket3, false);
+
+    END;
+}
+
+// Runs conflicting increments in P_OCC mode and checks that none was lost.
+TEST(ParallelOCC_Serializable)
+{
+    const int kKeys = 20;
+    const int kTxns = 2000;
+    TxnProcessor p(P_OCC);
+
+    map<Key, Value> expected;
+    for (Key key = 0; key < static_cast<Key>(kKeys); key++) expected[key] = 0;
+    for (int i = 0; i < kTxns; i++)
+    {
+        set<Key> keys;
+        for (int j = 0; j < 3; j++) keys.insert(rand() % kKeys);
+        for (set<Key>::iterator it = keys.begin(); it != keys.end(); ++it) expected[*it]++;
+        p.NewTxnRequest(new RMW(set<Key>(), keys));
+    }
+
+    int committed = 0;
+    for (int i = 0; i < kTxns; i++)
+    {
+        Txn* txn = p.GetTxnResult();
+        if (txn->Status() == COMMITTED) committed++;
+        delete txn;
+    }
+    EXPECT_EQ(kTxns, committed);
+
+    Txn* check = new Expect(expected);
+    p.NewTxnRequest(check);
+    p.GetTxnResult();
+    EXPECT_EQ(COMMITTED, check->Status());
+    delete check;
+
+    END;
+}
+
+int main(int argc, char** argv)
+{
+    OCCValidator_Conflicts();
+    OCCValidator_IgnoresAborted();
+    OCCValidator_SlotReuse();
+    OCCValidator_LargeWriteSet();
+    OCCValidator_Signatures();
+    ParallelOCC_Serializable();
+}
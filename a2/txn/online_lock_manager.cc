@@ -0,0 +1,107 @@
+#include "txn/online_lock_manager.h"
+
+#include "utils/hash.h"
+
+OnlineLockManager::OnlineLockManager(size_t buckets) : buckets_(buckets > 0 ? buckets : 1), waits_(0), dies_(0) {}
+
+OnlineLockManager::Bucket* OnlineLockManager::BucketOf(const Key& key)
+{
+    return &buckets_[(HashKey(key) >> 32) % buckets_.size()];
+}
+
+bool OnlineLockManager::Lock(Txn* txn, uint64 timestamp, const Key& key, LockMode mode)
+{
+    Bucket* bucket = BucketOf(key);
+    bucket->mutex_.Lock();
+    // Elements of an unordered_map stay put across rehashing, and this one is
+    // not dropped while we are counted among its waiters.
+    LockState* state = &bucket->locks_[key];
+    bool waited      = false;
+    while (true)
+    {
+        Holder* mine        = NULL;
+        bool conflict       = false;
+        bool older_than_all = true;
+        for (size_t i = 0; i < state->holders_.size(); i++)
+        {
+            Holder* holder = &state->holders_[i];
+            if (holder->txn_ == txn)
+            {
+                mine = holder;
+            }
+            else if (mode == EXCLUSIVE || holder->mode_ == EXCLUSIVE)
+            {
+                conflict = true;
+                if (holder->timestamp_ < timestamp) older_than_all = false;
+            }
+        }
+
+        if (!conflict)
+        {
+            if (mine == NULL)
+                state->holders_.push_back(Holder(txn, timestamp, mode));
+            else if (mode == EXCLUSIVE)
+                mine->mode_ = EXCLUSIVE;
+            bucket->mutex_.Unlock();
+            return true;
+        }
+
+        if (!older_than_all)
+        {
+            // Die. The lock is held by someone else, so 'state' stays.
+            dies_.fetch_add(1, std::memory_order_relaxed);
+            bucket->mutex_.Unlock();
+            return false;
+        }
+
+        if (!waited) waits_.fetch_add(1, std::memory_order_relaxed);
+        waited = true;
+        state->waiters_++;
+        bucket->released_.Wait(&bucket->mutex_);
+        state->waiters_--;
+    }
+}
+
+void OnlineLockManager::Release(Txn* txn, const Key& key)
+{
+    Bucket* bucket = BucketOf(key);
+    bucket->mutex_.Lock();
+    unordered_map<Key, LockState>::iterator it = bucket->locks_.find(key);
+    if (it != bucket->locks_.end())
+    {
+        vector<Holder>* holders = &it->second.holders_;
+        for (size_t i = 0; i < holders->size(); i++)
+        {
+            if ((*holders)[i].txn_ == txn)
+            {
+                holders->erase(holders->begin() + i);
+                break;
+            }
+        }
+        if (it->second.waiters_ > 0)
+            bucket->released_.Broadcast();
+        else if (holders->empty())
+            bucket->locks_.erase(it);
+    }
+    bucket->mutex_.Unlock();
+}
+
+// NOTE: The owners input vector is NOT assumed to be empty.
+LockMode OnlineLockManager::Status(const Key& key, vector<Txn*>* owners)
+{
+    owners->clear();
+    Bucket* bucket = BucketOf(key);
+    bucket->mutex_.Lock();
+    LockMode mode                              = UNLOCKED;
+    unordered_map<Key, LockState>::iterator it = bucket->locks_.find(key);
+    if (it != bucket->locks_.end())
+    {
+        for (size_t i = 0; i < it->second.holders_.size(); i++)
+        {
+            owners->push_back(it->second.holders_[i].txn_);
+            mode = it->second.holders_[i].mode_;
+        }
+    }
+    bucket->mutex_.Unlock();
+    return mode;
+}
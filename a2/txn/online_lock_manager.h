@@ -0,0 +1,92 @@
+
+// Lock manager for txns that acquire their locks one at a time while they
+// run, rather than all up front.
+
+#ifndef _ONLINE_LOCK_MANAGER_H_
+#define _ONLINE_LOCK_MANAGER_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+#include "txn/common.h"
+#include "txn/lock_manager.h"
+#include "utils/mutex.h"
+
+using std::unordered_map;
+using std::vector;
+
+// Shared/exclusive lock table for LOCKING_ONLINE mode, in which each txn
+// requests locks from its worker thread as it reads and writes keys, so txns
+// may request conflicting locks in any order.
+//
+// Deadlocks are prevented with wait-die: every txn carries a timestamp (lower
+// is older), and a request that conflicts with locks held by other txns waits
+// only if the requester is older than all of them. Otherwise the request is
+// refused and the requester must release everything and restart. Waits
+// therefore always go from older to younger txns and can never form a cycle.
+// A restarted txn should keep its original timestamp, so that it eventually
+// becomes the oldest and cannot starve.
+//
+// Lock() blocks the calling thread while it waits. The txns it waits for are
+// running (they hold locks only while executing), so waits always end.
+class OnlineLockManager
+{
+   public:
+    // 'buckets' is the number of independently latched partitions of the
+    // lock table.
+    explicit OnlineLockManager(size_t buckets = 1 << 12);
+
+    // Acquires a 'mode' lock on 'key' for 'txn', whose wait-die timestamp is
+    // 'timestamp', upgrading a SHARED lock it already holds if 'mode' is
+    // EXCLUSIVE. Returns true once the lock is held, waiting for it if need
+    // be. Returns false if 'txn' must die instead; 'txn' keeps any other
+    // locks it holds, which it must then release.
+    bool Lock(Txn* txn, uint64 timestamp, const Key& key, LockMode mode);
+
+    // Releases 'txn's lock on 'key', if it holds one.
+    void Release(Txn* txn, const Key& key);
+
+    // Returns the mode in which 'key' is currently locked, and sets '*owners'
+    // to the txns holding it.
+    LockMode Status(const Key& key, vector<Txn*>* owners);
+
+    // Number of requests that have had to wait, and that were refused.
+    uint64 Waits() const { return waits_.load(std::memory_order_relaxed); }
+    uint64 Dies() const { return dies_.load(std::memory_order_relaxed); }
+
+   private:
+    struct Holder
+    {
+        Holder(Txn* txn, uint64 timestamp, LockMode mode) : txn_(txn), timestamp_(timestamp), mode_(mode) {}
+        Txn* txn_;
+        uint64 timestamp_;
+        LockMode mode_;
+    };
+
+    // Holders of one key's lock, and how many requests are waiting for it.
+    // Dropped from the table once both are empty.
+    struct LockState
+    {
+        LockState() : waiters_(0) {}
+        vector<Holder> holders_;
+        int waiters_;
+    };
+
+    struct Bucket
+    {
+        Mutex mutex_;
+        Condition released_;  // Broadcast when a lock with waiters is released.
+        unordered_map<Key, LockState> locks_;
+    };
+
+    Bucket* BucketOf(const Key& key);
+
+    vector<Bucket> buckets_;
+
+    std::atomic<uint64> waits_;
+    std::atomic<uint64> dies_;
+};
+
+#endif  // _ONLINE_LOCK_MANAGER_H_
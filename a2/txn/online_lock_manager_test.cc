@@ -0,0 +1,128 @@
+#include "txn/online_lock_manager.h"
+
+#include <pthread.h>
+#include <unistd.h>
+#include <atomic>
+
+#include "txn/txn_processor.h"
+#include "txn/txn_types.h"
+#include "utils/testing.h"
+
+TEST(OnlineLockManager_SharedAndUpgrade)
+{
+    OnlineLockManager lm;
+    vector<Txn*> owners;
+
+    Txn* t1 = reinterpret_cast<Txn*>(1);
+    Txn* t2 = reinterpret_cast<Txn*>(2);
+
+    // Both txns share the lock.
+    EXPECT_TRUE(lm.Lock(t1, 1, 101, SHARED));
+    EXPECT_TRUE(lm.Lock(t2, 2, 101, SHARED));
+    EXPECT_EQ(SHARED, lm.Status(101, &owners));
+    EXPECT_EQ(2, owners.size());
+
+    // Txn 2 is younger than txn 1, so its upgrade dies rather than waits.
+    EXPECT_FALSE(lm.Lock(t2, 2, 101, EXCLUSIVE));
+    EXPECT_EQ(1, lm.Dies());
+    lm.Release(t2, 101);
+
+    // Now txn 1 is the only holder and may upgrade.
+    EXPECT_TRUE(lm.Lock(t1, 1, 101, EXCLUSIVE));
+    EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
+    EXPECT_EQ(1, owners.size());
+    EXPECT_EQ(t1, owners[0]);
+
+    // Re-requesting a lock already held is granted at once.
+    EXPECT_TRUE(lm.Lock(t1, 1, 101, SHARED));
+    EXPECT_TRUE(lm.Lock(t1, 1, 101, EXCLUSIVE));
+
+    lm.Release(t1, 101);
+    EXPECT_EQ(UNLOCKED, lm.Status(101, &owners));
+    EXPECT_EQ(0, lm.Waits());
+
+    END;
+}
+
+// An old txn asking for a key held by a young one.
+struct WaitRun
+{
+    OnlineLockManager* lm;
+    std::atomic<bool> granted;
+};
+
+static void* LockAsOldTxn(void* arg)
+{
+    WaitRun* run = reinterpret_cast<WaitRun*>(arg);
+    run->granted = run->lm->Lock(reinterpret_cast<Txn*>(1), 1, 101, EXCLUSIVE);
+    return NULL;
+}
+
+TEST(OnlineLockManager_OlderWaits)
+{
+    OnlineLockManager lm;
+    Txn* young = reinterpret_cast<Txn*>(2);
+    EXPECT_TRUE(lm.Lock(young, 2, 101, SHARED));
+
+    WaitRun run;
+    run.lm      = &lm;
+    run.granted = false;
+    pthread_t thread;
+    pthread_create(&thread, NULL, LockAsOldTxn, &run);
+
+    // The old txn waits for the young one to release.
+    while (lm.Waits() == 0) usleep(100);
+    EXPECT_FALSE(run.granted.load());
+    lm.Release(young, 101);
+    pthread_join(thread, NULL);
+    EXPECT_TRUE(run.granted.load());
+    EXPECT_EQ(0, lm.Dies());
+
+    END;
+}
+
+// Runs txns that increment random keys of a small database in LOCKING_ONLINE
+// mode, and checks that no increment was lost.
+TEST(OnlineLocking_Serializable)
+{
+    const int kKeys = 20;
+    const int kTxns = 2000;
+    TxnProcessorConfig config;
+    config.storage = STORAGE_DENSE;
+    TxnProcessor p(LOCKING_ONLINE, config);
+
+    // Replay each txn's key choices to find the expected final values.
+    map<Key, Value> expected;
+    for (Key key = 0; key < static_cast<Key>(kKeys); key++) expected[key] = 0;
+    for (int i = 0; i < kTxns; i++)
+    {
+        p.NewTxnRequest(new DynamicRMW(kKeys, 2, 3, i));
+        unsigned seed = i;
+        for (int j = 0; j < 2; j++) rand_r(&seed);
+        for (int j = 0; j < 3; j++) expected[rand_r(&seed) % kKeys]++;
+    }
+
+    int committed = 0;
+    for (int i = 0; i < kTxns; i++)
+    {
+        Txn* txn = p.GetTxnResult();
+        if (txn->Status() == COMMITTED) committed++;
+        delete txn;
+    }
+    EXPECT_EQ(kTxns, committed);
+
+    Txn* check = new Expect(expected);
+    p.NewTxnRequest(check);
+    p.GetTxnResult();
+    EXPECT_EQ(COMMITTED, check->Status());
+    delete check;
+
+    END;
+}
+
+int main(int argc, char** argv)
+{
+    OnlineLockManager_SharedAndUpgrade();
+    OnlineLockManager_OlderWaits();
+    OnlineLocking_Serializable();
+}
@@ -1,7 +1,7 @@
 
 #include "txn/storage.h"
 
-bool Storage::Read(Key key, Value* result, int txn_unique_id)
+bool Storage::Read(Key key, Value* result, uint64 txn_unique_id)
 {
     if (data_.count(key))
     {
@@ -15,13 +15,18 @@ bool Storage::Read(Key key, Value* result, int txn_unique_id)
 }
 
 // Write value and timestamps
-void Storage::Write(Key key, Value value, int txn_unique_id)
+void Storage::Write(Key key, Value value, uint64 txn_unique_id)
 {
     data_[key]       = value;
-    timestamps_[key] = GetTime();
+    timestamps_[key] = clock_.Tick();
 }
 
-double Storage::Timestamp(Key key)
+void Storage::WriteBatch(const vector<pair<Key, Value> >& writes)
+{
+    for (size_t i = 0; i < writes.size(); i++) Write(writes[i].first, writes[i].second);
+}
+
+uint64 Storage::Timestamp(Key key)
 {
     if (timestamps_.count(key) == 0) return 0;
     return timestamps_[key];
@@ -35,3 +40,21 @@ void Storage::InitStorage()
         Write(i, 0, 0);
     }
 }
+
+void Storage::ForEach(const std::function<void(Key, Value)>& visit)
+{
+    for (unordered_map<Key, Value>::iterator it = data_.begin(); it != data_.end(); ++it)
+    {
+        visit(it->first, it->second);
+    }
+}
+
+void Storage::Load(Key first, const Value* values, Key count)
+{
+    data_.reserve(data_.size() + count);
+    for (Key i = 0; i < count; i++)
+    {
+        data_[first + i] = values[i];
+        timestamps_.erase(first + i);
+    }
+}
@@ -4,16 +4,22 @@
 
 #include <limits.h>
 #include <deque>
+#include <functional>
 #include <map>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "txn/common.h"
 #include "txn/txn.h"
+#include "utils/logical_clock.h"
 #include "utils/mutex.h"
 
 using std::unordered_map;
 using std::deque;
 using std::map;
+using std::pair;
+using std::vector;
 
 class Storage
 {
@@ -21,25 +27,64 @@ class Storage
     // If there exists a record for the specified key, sets '*result' equal to
     // the value associated with the key and returns true, else returns false;
     // Note that the third parameter is only used for MVCC, the default vaule is 0.
-    virtual bool Read(Key key, Value* result, int txn_unique_id = 0);
+    virtual bool Read(Key key, Value* result, uint64 txn_unique_id = 0);
 
     // Inserts the record <key, value>, replacing any previous record with the
     // same key.
     // Note that the third parameter is only used for MVCC, the default vaule is 0.
-    virtual void Write(Key key, Value value, int txn_unique_id = 0);
+    virtual void Write(Key key, Value value, uint64 txn_unique_id = 0);
 
-    // Returns the timestamp at which the record with the specified key was last
-    // updated (returns 0 if the record has never been updated). This is used for OCC.
-    virtual double Timestamp(Key key);
+    // Writes every <key, value> record in 'writes', as if by Write().
+    //
+    // Requires: keys are distinct and in ascending order, and no other thread
+    // writes any of them concurrently.
+    virtual void WriteBatch(const vector<pair<Key, Value> >& writes);
+
+    // Returns the logical time at which the record with the specified key was
+    // last updated (returns 0 if the record has never been updated). This is
+    // used for OCC.
+    virtual uint64 Timestamp(Key key);
+
+    // Returns the current time on the clock used by Timestamp(). OCC txns
+    // record it as their start time: any record written after that is
+    // stamped later.
+    uint64 Now() const { return clock_.Now(); }
+
+    // The storage's logical clock. TxnProcessor also takes txn unique_ids
+    // from it, so that MVCC versions, record timestamps and txn start times
+    // are all on one time line.
+    LogicalClock* Clock() { return &clock_; }
 
     // Init storage
     virtual void InitStorage();
 
+    // Calls 'visit(key, value)' once for every record. Each record is read
+    // atomically, but writers may run meanwhile, so the records visited need
+    // not be a consistent snapshot of the storage as a whole.
+    //
+    // Requires (Storage only): no concurrent Write() of a new key.
+    virtual void ForEach(const std::function<void(Key, Value)>& visit);
+
+    // Sets the records for keys [first, first + count) to values[0, count),
+    // the way InitStorage() sets up its records: without ticking the clock,
+    // so that they carry logical time 0.
+    //
+    // Requires: no other thread reads or writes these keys meanwhile.
+    virtual void Load(Key first, const Value* values, Key count);
+
+    // Whether Write() and Load() may be called from several threads at once
+    // for distinct keys (Storage's hash tables cannot grow concurrently).
+    virtual bool ConcurrentWrites() const { return false; }
+
     virtual ~Storage() {}
     // The following methods are only used for MVCC
     virtual void Lock(Key key) {}
     virtual void Unlock(Key key) {}
-    virtual bool CheckWrite(Key key, int txn_unique_id) { return true; }
+    virtual bool CheckWrite(Key key, uint64 txn_unique_id) { return true; }
+   protected:
+    // Issues every timestamp in the storage.
+    LogicalClock clock_;
+
    private:
     friend class TxnProcessor;
 
@@ -47,7 +92,7 @@ class Storage
     unordered_map<Key, Value> data_;
 
     // Timestamps at which each key was last updated.
-    unordered_map<Key, double> timestamps_;
+    unordered_map<Key, uint64> timestamps_;
 };
 
 #endif  // _STORAGE_H_
@@ -4,16 +4,28 @@
 bool Txn::Read(const Key& key, Value* value)
 {
     // Check that key is in readset/writeset.
-    if (readset_.count(key) == 0 && writeset_.count(key) == 0) DIE("Invalid read (key not in readset or writeset).");
+    if (hook_ == NULL && readset_.count(key) == 0 && writeset_.count(key) == 0)
+    {
+        DIE("Invalid read (key not in readset or writeset).");
+    }
 
     // Reads have no effect if we have already aborted or committed.
     if (status_ != INCOMPLETE) return false;
 
+    // Lock the key (and fetch its value) first in LOCKING_ONLINE mode.
+    if (hook_ != NULL && !hook_->BeforeRead(this, key))
+    {
+        restart_ = true;
+        status_  = COMPLETED_A;
+        return false;
+    }
+
     // 'reads_' has already been populated by TxnProcessor, so it should contain
     // the target value iff the record appears in the database.
-    if (reads_.count(key))
+    KeyValueMap::iterator it = reads_.find(key);
+    if (it != reads_.end())
     {
-        *value = reads_[key];
+        *value = it->second;
         return true;
     }
     else
@@ -25,11 +37,19 @@ bool Txn::Read(const Key& key, Value* value)
 void Txn::Write(const Key& key, const Value& value)
 {
     // Check that key is in writeset.
-    if (writeset_.count(key) == 0) DIE("Invalid write to key " << key << " (writeset).");
+    if (hook_ == NULL && writeset_.count(key) == 0) DIE("Invalid write to key " << key << " (writeset).");
 
     // Writes have no effect if we have already aborted or committed.
     if (status_ != INCOMPLETE) return;
 
+    // Lock the key first in LOCKING_ONLINE mode.
+    if (hook_ != NULL && !hook_->BeforeWrite(this, key))
+    {
+        restart_ = true;
+        status_  = COMPLETED_A;
+        return;
+    }
+
     // Set key-value pair in write buffer.
     writes_[key] = value;
 
@@ -40,7 +60,7 @@ void Txn::Write(const Key& key, const Value& value)
 
 void Txn::CheckReadWriteSets()
 {
-    for (set<Key>::iterator it = writeset_.begin(); it != writeset_.end(); ++it)
+    for (KeySet::iterator it = writeset_.begin(); it != writeset_.end(); ++it)
     {
         if (readset_.count(*it) > 0)
         {
@@ -51,10 +71,10 @@ void Txn::CheckReadWriteSets()
 
 void Txn::CopyTxnInternals(Txn* txn) const
 {
-    txn->readset_        = set<Key>(this->readset_);
-    txn->writeset_       = set<Key>(this->writeset_);
-    txn->reads_          = map<Key, Value>(this->reads_);
-    txn->writes_         = map<Key, Value>(this->writes_);
+    txn->readset_        = this->readset_;
+    txn->writeset_       = this->writeset_;
+    txn->reads_          = this->reads_;
+    txn->writes_         = this->writes_;
     txn->status_         = this->status_;
     txn->unique_id_      = this->unique_id_;
     txn->occ_start_time_ = this->occ_start_time_;
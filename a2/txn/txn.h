@@ -2,16 +2,42 @@
 #ifndef _TXN_H_
 #define _TXN_H_
 
+#include <atomic>
 #include <map>
 #include <set>
 #include <vector>
 
 #include "txn/common.h"
+#include "utils/key_signature.h"
+#include "utils/slab.h"
+#include "utils/sorted_vector.h"
 
 using std::map;
 using std::set;
 using std::vector;
 
+// Read/write sets and read/write results of a txn. Txns typically touch a few
+// dozen keys at most, so these are sorted arrays rather than trees.
+typedef SortedVectorSet<Key> KeySet;
+typedef SortedVectorMap<Key, Value> KeyValueMap;
+
+class Txn;
+
+// Callbacks through which a txn running in LOCKING_ONLINE mode acquires locks
+// as it goes. Each returns false if the txn has to abort and restart.
+class TxnAccessHook
+{
+   public:
+    virtual ~TxnAccessHook() {}
+
+    // Called before 'txn' reads 'key'. Must leave the current value of 'key'
+    // (if any) in 'txn->reads_'.
+    virtual bool BeforeRead(Txn* txn, const Key& key) = 0;
+
+    // Called before 'txn' writes 'key'.
+    virtual bool BeforeWrite(Txn* txn, const Key& key) = 0;
+};
+
 // Txns can have five distinct status values:
 enum TxnStatus
 {
@@ -26,13 +52,29 @@ class Txn
 {
    public:
     // Commit vote defauls to false. Only by calling "commit"
-    Txn() : status_(INCOMPLETE) {}
+    Txn()
+        : status_(INCOMPLETE),
+          shard_mask_(0),
+          shards_pending_(0),
+          hook_(NULL),
+          restart_(false),
+          lock_timestamp_(0),
+          wal_lsn_(0),
+          log_epoch_(-1)
+    {
+    }
     virtual ~Txn() {}
     virtual Txn* clone() const = 0;  // Virtual constructor (copying)
 
     // Method containing all the transaction's method logic.
     virtual void Run() = 0;
 
+    // Txns (of every subclass) are carved out of the SlabAllocator, so the
+    // memory of a deleted txn is reused by the next one created on the same
+    // thread instead of going back to malloc().
+    static void* operator new(size_t size) { return SlabAllocator::Allocate(size); }
+    static void operator delete(void* p, size_t size) { SlabAllocator::Free(p, size); }
+
     // Returns the Txn's current execution status.
     TxnStatus Status() { return status_; }
     // Checks for overlap in read and write sets. If any key appears in both,
@@ -51,7 +93,8 @@ class Txn
     // the database. If record corresponding with specified 'key' exists, sets
     // '*value' equal to the record value and returns true, else returns false.
     //
-    // Requires: key appears in readset or writeset
+    // Requires: key appears in readset or writeset, except in LOCKING_ONLINE
+    //           mode, where txns may discover the keys they touch as they go
     //
     // Note: Can ONLY be called from inside the 'Execute()' function.
     bool Read(const Key& key, Value* value);
@@ -59,7 +102,7 @@ class Txn
     // Method to be used inside 'Execute()' function when writing records to
     // the database.
     //
-    // Requires: key appears in writeset
+    // Requires: key appears in writeset, except in LOCKING_ONLINE mode
     //
     // Note: Can ONLY be called from inside the 'Execute()' function.
     void Write(const Key& key, const Value& value);
@@ -86,16 +129,16 @@ class Txn
 
     // Set of all keys that may need to be read in order to execute the
     // transaction.
-    set<Key> readset_;
+    KeySet readset_;
 
     // Set of all keys that may be updated when executing the transaction.
-    set<Key> writeset_;
+    KeySet writeset_;
 
     // Results of reads performed by the transaction.
-    map<Key, Value> reads_;
+    KeyValueMap reads_;
 
     // Key, Value pairs WRITTEN by the transaction.
-    map<Key, Value> writes_;
+    KeyValueMap writes_;
 
     // Transaction's current execution status.
     TxnStatus status_;
@@ -103,8 +146,43 @@ class Txn
     // Unique, monotonically increasing transaction ID, assigned by TxnProcessor.
     uint64 unique_id_;
 
-    // Start time (used for OCC).
-    double occ_start_time_;
+    // Logical start time, on the storage's clock (used for OCC).
+    uint64 occ_start_time_;
+
+    // Validation ticket horizon when the txn started its read phase (used
+    // for P_OCC).
+    uint64 occ_start_ticket_;
+
+    // Signatures of readset_ and writeset_ together, and of writeset_ alone,
+    // built when the txn is submitted (used for P_OCC).
+    KeySignature occ_access_signature_;
+    KeySignature occ_write_signature_;
+
+    // Scheduler shards owning at least one key of the txn (bit i set for
+    // shard i), and how many of them have yet to finish the txn's current
+    // phase: first lock acquisition, then commit and lock release. Used by
+    // LOCKING_PARTITIONED only.
+    uint64 shard_mask_;
+    std::atomic<int> shards_pending_;
+
+    // LOCKING_ONLINE only. 'hook_' is set while the txn runs. 'restart_' is
+    // set (and the txn's status forced to COMPLETED_A, so that its remaining
+    // reads and writes do nothing) once a lock request has been refused.
+    // 'lock_timestamp_' is the txn's wait-die priority, kept across restarts.
+    // 'online_locks_' holds the keys it has locked so far.
+    TxnAccessHook* hook_;
+    bool restart_;
+    uint64 lock_timestamp_;
+    KeySet online_locks_;
+
+    // Write-ahead log sequence number past which the log must be flushed
+    // before the txn's result may be returned (0 if there is nothing to wait
+    // for).
+    uint64 wal_lsn_;
+
+    // Checkpoint epoch (0 or 1) in which the txn logged its writes, while they
+    // are not yet applied to storage; -1 otherwise.
+    int log_epoch_;
 };
 
 #endif  // _TXN_H_
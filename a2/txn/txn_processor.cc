@@ -1,51 +1,110 @@
 
 #include "txn/txn_processor.h"
 #include <stdio.h>
+#include <sys/stat.h>
+#include <algorithm>
 #include <set>
 
 #include "txn/lock_manager.h"
-
-// Thread & queue counts for StaticThreadPool initialization.
-#define THREAD_COUNT 8
-
-TxnProcessor::TxnProcessor(CCMode mode) : mode_(mode), tp_(THREAD_COUNT), next_unique_id_(1)
+#include "utils/hash.h"
+
+// Seconds between MVCC garbage collection passes.
+static const double kMVCCGCInterval = 0.001;
+
+TxnProcessor::TxnProcessor(CCMode mode, const TxnProcessorConfig& config)
+    : mode_(mode),
+      config_(config),
+      placement_(CpuPlacement::Compute(CpuTopology::Discover(), config.thread_count, config.pinning,
+                                       config.numa_node, mode == LOCKING_PARTITIONED ? config.scheduler_shards : 0)),
+      tp_(config.thread_count, &placement_),
+      validator_(NULL),
+      occ_restarts_(0),
+      online_lm_(NULL),
+      online_restarts_(0),
+      commit_batch_start_(0),
+      mvcc_last_dispatched_id_(0),
+      wal_(NULL),
+      log_epoch_(0),
+      checkpoints_(0),
+      checkpoint_stopped_(false),
+      recovery_time_(0),
+      recovered_records_(0)
 {
+    log_unapplied_[0].store(0);
+    log_unapplied_[1].store(0);
+
     if (mode_ == LOCKING_EXCLUSIVE_ONLY)
         lm_ = new LockManagerA(&ready_txns_);
+    else if (mode_ == LOCKING && config_.lock_table == LOCK_TABLE_FLAT)
+        lm_ = new FlatLockManager(&ready_txns_);
     else if (mode_ == LOCKING)
         lm_ = new LockManagerB(&ready_txns_);
+    else if (mode_ == LOCKING_ONLINE)
+        online_lm_ = new OnlineLockManager();
+    else if (mode_ == P_OCC)
+        validator_ = new OCCValidator();
 
     // Create the storage
     if (mode_ == MVCC)
     {
         storage_ = new MVCCStorage();
     }
+    else if (config_.storage == STORAGE_DENSE)
+    {
+        storage_ = new DenseStorage();
+    }
     else
     {
         storage_ = new Storage();
     }
 
-    storage_->InitStorage();
+    // The LOCKING_ONLINE workers write to storage concurrently, which the hash
+    // Storage cannot take: an insert may rehash under another writer.
+    if (mode_ == LOCKING_ONLINE && !storage_->ConcurrentWrites())
+    {
+        DIE("LOCKING_ONLINE needs a storage that allows concurrent writes (STORAGE_DENSE)");
+    }
+
+    Recover();
 
     // Start 'RunScheduler()' running.
+    stopped_ = false;
 
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
+    if (!config_.wal_path.empty())
+    {
+        wal_ = new WriteAheadLog(config_.wal_path, config_.wal_sync, config_.wal_sync_interval);
+        pthread_create(&log_thread_, NULL, StartLogWriter, reinterpret_cast<void*>(this));
+    }
+    if (config_.checkpoint_interval > 0)
+    {
+        pthread_create(&checkpoint_thread_, NULL, StartCheckpointer, reinterpret_cast<void*>(this));
+    }
 
-    #if !defined(_MSC_VER) && !defined(__APPLE__)
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    for (int i = 0; i < 7; i++)
+    if (mode_ == LOCKING_PARTITIONED)
     {
-        CPU_SET(i, &cpuset);
+        if (config_.scheduler_shards < 1 || config_.scheduler_shards > 64)
+        {
+            DIE("scheduler_shards must be in [1, 64], got " << config_.scheduler_shards);
+        }
+        for (int i = 0; i < config_.scheduler_shards; i++) shards_.push_back(new SchedulerShard(config_.lock_table));
+        for (int i = 0; i < config_.scheduler_shards; i++)
+        {
+            pthread_attr_t attr;
+            pthread_attr_init(&attr);
+            SetThreadAffinity(&attr, placement_.shard_cpus_[i]);
+            pthread_create(&shards_[i]->thread_, &attr, StartSchedulerShard,
+                           reinterpret_cast<void*>(new pair<int, TxnProcessor*>(i, this)));
+            pthread_attr_destroy(&attr);
+        }
     }
-    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
-    #endif
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    SetThreadAffinity(&attr, placement_.scheduler_cpu_);
 
     pthread_t scheduler_;
     pthread_create(&scheduler_, &attr, StartScheduler, reinterpret_cast<void*>(this));
 
-    stopped_          = false;
     scheduler_thread_ = scheduler_;
 }
 
@@ -55,24 +114,67 @@ void* TxnProcessor::StartScheduler(void* arg)
     return NULL;
 }
 
+void* TxnProcessor::StartSchedulerShard(void* arg)
+{
+    pair<int, TxnProcessor*>* shard = reinterpret_cast<pair<int, TxnProcessor*>*>(arg);
+    shard->second->RunSchedulerShard(shard->first);
+    delete shard;
+    return NULL;
+}
+
+void* TxnProcessor::StartLogWriter(void* arg)
+{
+    reinterpret_cast<TxnProcessor*>(arg)->RunLogWriter();
+    return NULL;
+}
+
+void* TxnProcessor::StartCheckpointer(void* arg)
+{
+    reinterpret_cast<TxnProcessor*>(arg)->RunCheckpointer();
+    return NULL;
+}
+
 TxnProcessor::~TxnProcessor()
 {
+    // A checkpoint in progress needs txns to keep committing and the log
+    // writer to keep flushing, so stop checkpointing first.
+    if (config_.checkpoint_interval > 0)
+    {
+        checkpoint_stopped_ = true;
+        pthread_join(checkpoint_thread_, NULL);
+    }
+
     // Wait for the scheduler thread to join back before destroying the object and its thread pool.
     stopped_ = true;
     pthread_join(scheduler_thread_, NULL);
+    for (size_t i = 0; i < shards_.size(); i++)
+    {
+        pthread_join(shards_[i]->thread_, NULL);
+        delete shards_[i];
+    }
+    if (wal_ != NULL)
+    {
+        pthread_join(log_thread_, NULL);
+        delete wal_;
+    }
 
     if (mode_ == LOCKING_EXCLUSIVE_ONLY || mode_ == LOCKING) delete lm_;
+    delete online_lm_;
+    delete validator_;
 
     delete storage_;
 }
 
 void TxnProcessor::NewTxnRequest(Txn* txn)
 {
+    // Summarize the txn's keys for P_OCC validation here, on the submitting
+    // thread rather than on a worker.
+    if (validator_ != NULL && config_.occ_signatures) BuildSignatures(txn);
+
     // Atomically assign the txn a new number and add it to the incoming txn
     // requests queue.
     mutex_.Lock();
-    txn->unique_id_ = next_unique_id_;
-    next_unique_id_++;
+    txn->unique_id_ = storage_->Clock()->Tick();
     txn_requests_.Push(txn);
     mutex_.Unlock();
 }
@@ -102,6 +204,9 @@ void TxnProcessor::RunScheduler()
         case LOCKING_EXCLUSIVE_ONLY:
             RunLockingScheduler();
             break;
+        case LOCKING_PARTITIONED:
+            RunPartitionedScheduler();
+            break;
         case OCC:
             RunOCCScheduler();
             break;
@@ -110,6 +215,10 @@ void TxnProcessor::RunScheduler()
             break;
         case MVCC:
             RunMVCCScheduler();
+            break;
+        case LOCKING_ONLINE:
+            RunOnlineScheduler();
+            break;
     }
 }
 
@@ -121,12 +230,14 @@ void TxnProcessor::RunSerialScheduler()
         // Get next txn request.
         if (txn_requests_.Pop(&txn))
         {
-            // Execute txn.
-            ExecuteTxn(txn);
+            // Execute txn. It is committed right here, so it skips the
+            // completed_txns_ queue that the locking schedulers drain.
+            ReadAndRun(txn);
 
             // Commit/abort txn according to program logic's commit/abort decision.
             if (txn->Status() == COMPLETED_C)
             {
+                LogWrites(txn);
                 ApplyWrites(txn);
                 txn->status_ = COMMITTED;
             }
@@ -141,7 +252,7 @@ void TxnProcessor::RunSerialScheduler()
             }
 
             // Return result to client.
-            txn_results_.Push(txn);
+            PublishResult(txn);
         }
     }
 }
@@ -156,7 +267,7 @@ void TxnProcessor::RunLockingScheduler()
         {
             bool blocked = false;
             // Request read locks.
-            for (set<Key>::iterator it = txn->readset_.begin(); it != txn->readset_.end(); ++it)
+            for (KeySet::iterator it = txn->readset_.begin(); it != txn->readset_.end(); ++it)
             {
                 if (!lm_->ReadLock(txn, *it))
                 {
@@ -165,7 +276,7 @@ void TxnProcessor::RunLockingScheduler()
             }
 
             // Request write locks.
-            for (set<Key>::iterator it = txn->writeset_.begin(); it != txn->writeset_.end(); ++it)
+            for (KeySet::iterator it = txn->writeset_.begin(); it != txn->writeset_.end(); ++it)
             {
                 if (!lm_->WriteLock(txn, *it))
                 {
@@ -181,50 +292,283 @@ void TxnProcessor::RunLockingScheduler()
             }
         }
 
-        // Process and commit all transactions that have finished running.
-        while (completed_txns_.Pop(&txn))
+        // Gather transactions that have finished running into the current
+        // commit batch, and commit it once it is full or has waited long
+        // enough.
+        int batch_size = config_.commit_batch_size > 0 ? config_.commit_batch_size : 1;
+        while (static_cast<int>(commit_batch_.size()) < batch_size && completed_txns_.Pop(&txn))
         {
-            // Commit/abort txn according to program logic's commit/abort decision.
-            if (txn->Status() == COMPLETED_C)
+            if (commit_batch_.empty()) commit_batch_start_ = GetTime();
+            commit_batch_.push_back(txn);
+        }
+        if (!commit_batch_.empty() && (static_cast<int>(commit_batch_.size()) >= batch_size ||
+                                       GetTime() - commit_batch_start_ >= config_.commit_max_delay))
+        {
+            CommitBatch();
+        }
+
+        // Start executing all transactions that have newly acquired all their
+        // locks.
+        while (ready_txns_.size())
+        {
+            // Get next ready txn from the queue.
+            txn = ready_txns_.front();
+            ready_txns_.pop_front();
+
+            // Start txn running in its own thread.
+            tp_.AddTask([this, txn]() { this->ExecuteTxn(txn); });
+        }
+    }
+}
+
+void TxnProcessor::CommitBatch()
+{
+    commit_writes_.clear();
+    commit_locks_.clear();
+    for (size_t i = 0; i < commit_batch_.size(); i++)
+    {
+        Txn* txn = commit_batch_[i];
+
+        // Commit/abort txn according to program logic's commit/abort decision.
+        if (txn->Status() == COMPLETED_C)
+        {
+            LogWrites(txn);
+            for (KeyValueMap::iterator it = txn->writes_.begin(); it != txn->writes_.end(); ++it)
             {
-                ApplyWrites(txn);
-                txn->status_ = COMMITTED;
+                commit_writes_.push_back(std::make_pair(it->first, it->second));
             }
-            else if (txn->Status() == COMPLETED_A)
+            txn->status_ = COMMITTED;
+        }
+        else if (txn->Status() == COMPLETED_A)
+        {
+            txn->status_ = ABORTED;
+        }
+        else
+        {
+            // Invalid TxnStatus!
+            DIE("Completed Txn has invalid TxnStatus: " << txn->Status());
+        }
+
+        for (KeySet::iterator it = txn->readset_.begin(); it != txn->readset_.end(); ++it)
+        {
+            commit_locks_.push_back(LockManager::HeldLock(txn, *it));
+        }
+        for (KeySet::iterator it = txn->writeset_.begin(); it != txn->writeset_.end(); ++it)
+        {
+            commit_locks_.push_back(LockManager::HeldLock(txn, *it));
+        }
+    }
+
+    // Every txn in the batch still holds exclusive locks on the keys it
+    // wrote, so no key appears twice.
+    std::sort(commit_writes_.begin(), commit_writes_.end());
+    storage_->WriteBatch(commit_writes_);
+    lm_->ReleaseAll(&commit_locks_);
+
+    // Return results to client.
+    if (wal_ == NULL)
+        txn_results_.PushBatch(&commit_batch_[0], commit_batch_.size());
+    else
+        for (size_t i = 0; i < commit_batch_.size(); i++) PublishResult(commit_batch_[i]);
+
+    commit_batch_sizes_.Add(commit_batch_.size());
+    commit_batch_delays_.Add(static_cast<uint64>((GetTime() - commit_batch_start_) * 1e6));
+    commit_batch_.clear();
+}
+
+void TxnProcessor::RunOnlineScheduler()
+{
+    Txn* txn;
+    while (!stopped_)
+    {
+        if (txn_requests_.Pop(&txn))
+        {
+            // The txn's wait-die priority, which its restarts keep.
+            txn->lock_timestamp_ = txn->unique_id_;
+            tp_.AddTask([this, txn]() { this->OnlineExecuteTxn(txn); });
+        }
+        if (online_retries_.Pop(&txn)) tp_.AddTask([this, txn]() { this->OnlineExecuteTxn(txn); });
+    }
+}
+
+void TxnProcessor::OnlineExecuteTxn(Txn* txn)
+{
+    txn->hook_ = this;
+    txn->Run();
+    txn->hook_ = NULL;
+
+    if (txn->restart_)
+    {
+        // Wait-die refused a lock: start over, keeping the txn's unique_id and
+        // timestamp. The retry is handed back to the scheduler on its own
+        // queue, not through NewTxnRequest, so a worker never waits on the
+        // client queue or its mutex.
+        ReleaseOnlineLocks(txn);
+        txn->reads_.clear();
+        txn->writes_.clear();
+        txn->restart_ = false;
+        txn->status_  = INCOMPLETE;
+        online_restarts_.fetch_add(1, std::memory_order_relaxed);
+        online_retries_.Push(txn);
+        return;
+    }
+
+    // Commit/abort txn according to program logic's commit/abort decision,
+    // while still holding all of its locks.
+    if (txn->Status() == COMPLETED_C)
+    {
+        LogWrites(txn);
+        ApplyWrites(txn);
+        txn->status_ = COMMITTED;
+    }
+    else if (txn->Status() == COMPLETED_A)
+    {
+        txn->status_ = ABORTED;
+    }
+    else
+    {
+        // Invalid TxnStatus!
+        DIE("Completed Txn has invalid TxnStatus: " << txn->Status());
+    }
+
+    ReleaseOnlineLocks(txn);
+
+    // Return result to client.
+    PublishResult(txn);
+}
+
+bool TxnProcessor::BeforeRead(Txn* txn, const Key& key)
+{
+    if (!online_lm_->Lock(txn, txn->lock_timestamp_, key, SHARED)) return false;
+    txn->online_locks_.insert(key);
+
+    // Fetch the value on first access; later reads see the txn's own writes.
+    if (txn->reads_.count(key) == 0)
+    {
+        Value result;
+        if (storage_->Read(key, &result)) txn->reads_[key] = result;
+    }
+    return true;
+}
+
+bool TxnProcessor::BeforeWrite(Txn* txn, const Key& key)
+{
+    if (!online_lm_->Lock(txn, txn->lock_timestamp_, key, EXCLUSIVE)) return false;
+    txn->online_locks_.insert(key);
+    return true;
+}
+
+void TxnProcessor::ReleaseOnlineLocks(Txn* txn)
+{
+    for (KeySet::iterator it = txn->online_locks_.begin(); it != txn->online_locks_.end(); ++it)
+    {
+        online_lm_->Release(txn, *it);
+    }
+    txn->online_locks_.clear();
+}
+
+int TxnProcessor::ShardOf(const Key& key) const
+{
+    return (HashKey(key) >> 32) % shards_.size();
+}
+
+void TxnProcessor::RunPartitionedScheduler()
+{
+    Txn* txn;
+    while (!stopped_)
+    {
+        if (txn_requests_.Pop(&txn))
+        {
+            // Find the shards owning the txn's keys.
+            txn->shard_mask_ = 0;
+            for (KeySet::iterator it = txn->readset_.begin(); it != txn->readset_.end(); ++it)
             {
-                txn->status_ = ABORTED;
+                txn->shard_mask_ |= 1ull << ShardOf(*it);
             }
-            else
+            for (KeySet::iterator it = txn->writeset_.begin(); it != txn->writeset_.end(); ++it)
+            {
+                txn->shard_mask_ |= 1ull << ShardOf(*it);
+            }
+
+            // A txn with no keys at all still needs one shard to run it.
+            if (txn->shard_mask_ == 0) txn->shard_mask_ = 1;
+            txn->shards_pending_.store(__builtin_popcountll(txn->shard_mask_), std::memory_order_relaxed);
+
+            // This is the only thread feeding the shards, so every shard sees
+            // its txns in unique_id order.
+            for (size_t i = 0; i < shards_.size(); i++)
+            {
+                if (txn->shard_mask_ & (1ull << i)) shards_[i]->requests_.Push(txn);
+            }
+        }
+    }
+}
+
+void TxnProcessor::RunSchedulerShard(int id)
+{
+    SchedulerShard* shard = shards_[id];
+    Txn* txn;
+    while (!stopped_)
+    {
+        // Request this shard's share of the next txn's locks.
+        if (shard->requests_.Pop(&txn))
+        {
+            bool blocked = false;
+            for (KeySet::iterator it = txn->readset_.begin(); it != txn->readset_.end(); ++it)
+            {
+                if (ShardOf(*it) == id && !shard->lm_->ReadLock(txn, *it)) blocked = true;
+            }
+            for (KeySet::iterator it = txn->writeset_.begin(); it != txn->writeset_.end(); ++it)
+            {
+                if (ShardOf(*it) == id && !shard->lm_->WriteLock(txn, *it)) blocked = true;
+            }
+            if (blocked == false) shard->ready_txns_.push_back(txn);
+        }
+
+        // Commit this shard's writes and release its locks for finished txns.
+        while (shard->completed_.Pop(&txn))
+        {
+            if (txn->Status() != COMPLETED_C && txn->Status() != COMPLETED_A)
             {
-                // Invalid TxnStatus!
                 DIE("Completed Txn has invalid TxnStatus: " << txn->Status());
             }
 
-            // Release read locks.
-            for (set<Key>::iterator it = txn->readset_.begin(); it != txn->readset_.end(); ++it)
+            if (txn->Status() == COMPLETED_C)
+            {
+                bool serialize = !storage_->ConcurrentWrites();
+                if (serialize) shard_write_mutex_.Lock();
+                for (KeyValueMap::iterator it = txn->writes_.begin(); it != txn->writes_.end(); ++it)
+                {
+                    if (ShardOf(it->first) == id) storage_->Write(it->first, it->second, txn->unique_id_);
+                }
+                if (serialize) shard_write_mutex_.Unlock();
+            }
+            for (KeySet::iterator it = txn->readset_.begin(); it != txn->readset_.end(); ++it)
             {
-                lm_->Release(txn, *it);
+                if (ShardOf(*it) == id) shard->lm_->Release(txn, *it);
             }
-            // Release write locks.
-            for (set<Key>::iterator it = txn->writeset_.begin(); it != txn->writeset_.end(); ++it)
+            for (KeySet::iterator it = txn->writeset_.begin(); it != txn->writeset_.end(); ++it)
             {
-                lm_->Release(txn, *it);
+                if (ShardOf(*it) == id) shard->lm_->Release(txn, *it);
             }
 
-            // Return result to client.
-            txn_results_.Push(txn);
+            // The last shard to finish returns the result to the client.
+            if (txn->shards_pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                txn->status_ = (txn->Status() == COMPLETED_C) ? COMMITTED : ABORTED;
+                PublishResult(txn);
+            }
         }
 
-        // Start executing all transactions that have newly acquired all their
-        // locks.
-        while (ready_txns_.size())
+        // The last shard to grant a txn its locks starts it running.
+        while (shard->ready_txns_.size())
         {
-            // Get next ready txn from the queue.
-            txn = ready_txns_.front();
-            ready_txns_.pop_front();
-
-            // Start txn running in its own thread.
-            tp_.AddTask([this, txn]() { this->ExecuteTxn(txn); });
+            txn = shard->ready_txns_.front();
+            shard->ready_txns_.pop_front();
+            if (txn->shards_pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                tp_.AddTask([this, txn]() { this->ExecuteTxn(txn); });
+            }
         }
     }
 }
@@ -232,10 +576,36 @@ void TxnProcessor::RunLockingScheduler()
 void TxnProcessor::ExecuteTxn(Txn* txn)
 {
     // Get the start time
-    txn->occ_start_time_ = GetTime();
+    txn->occ_start_time_ = storage_->Now();
+
+    ReadAndRun(txn);
+
+    // Hand the txn back to the locking RunScheduler thread, or to each of its
+    // scheduler shards.
+    if (mode_ == LOCKING_PARTITIONED)
+    {
+        // The shards apply the writes independently, so log them first.
+        if (txn->Status() == COMPLETED_C) LogWrites(txn);
+        txn->shards_pending_.store(__builtin_popcountll(txn->shard_mask_), std::memory_order_relaxed);
+        for (size_t i = 0; i < shards_.size(); i++)
+        {
+            if (txn->shard_mask_ & (1ull << i)) shards_[i]->completed_.Push(txn);
+        }
+    }
+    else
+    {
+        completed_txns_.Push(txn);
+    }
+}
+
+void TxnProcessor::ReadAndRun(Txn* txn)
+{
+    // Size the result maps up front so that filling them allocates once.
+    txn->reads_.reserve(txn->readset_.size() + txn->writeset_.size());
+    txn->writes_.reserve(txn->writeset_.size());
 
     // Read everything in from readset.
-    for (set<Key>::iterator it = txn->readset_.begin(); it != txn->readset_.end(); ++it)
+    for (KeySet::iterator it = txn->readset_.begin(); it != txn->readset_.end(); ++it)
     {
         // Save each read result iff record exists in storage.
         Value result;
@@ -243,7 +613,7 @@ void TxnProcessor::ExecuteTxn(Txn* txn)
     }
 
     // Also read everything in from writeset.
-    for (set<Key>::iterator it = txn->writeset_.begin(); it != txn->writeset_.end(); ++it)
+    for (KeySet::iterator it = txn->writeset_.begin(); it != txn->writeset_.end(); ++it)
     {
         // Save each read result iff record exists in storage.
         Value result;
@@ -252,15 +622,149 @@ void TxnProcessor::ExecuteTxn(Txn* txn)
 
     // Execute txn's program logic.
     txn->Run();
+}
+
+void TxnProcessor::LogWrites(Txn* txn)
+{
+    if (wal_ == NULL) return;
 
-    // Hand the txn back to the RunScheduler thread.
-    completed_txns_.Push(txn);
+    // A txn that writes nothing still has to wait for whatever it read to be
+    // durable.
+    if (txn->writes_.empty())
+    {
+        txn->wal_lsn_ = wal_->AppendedLSN();
+        return;
+    }
+
+    // Until PublishResult(), which every mode calls once the txn's writes
+    // are applied, a checkpoint starting now must wait for the txn.
+    if (!config_.checkpoint_path.empty())
+    {
+        txn->log_epoch_ = log_epoch_.load(std::memory_order_seq_cst) & 1;
+        log_unapplied_[txn->log_epoch_].fetch_add(1, std::memory_order_seq_cst);
+    }
+    txn->wal_lsn_ = wal_->Append(txn->unique_id_, txn->writes_);
+}
+
+void TxnProcessor::PublishResult(Txn* txn)
+{
+    if (txn->log_epoch_ >= 0)
+    {
+        log_unapplied_[txn->log_epoch_].fetch_sub(1, std::memory_order_seq_cst);
+        txn->log_epoch_ = -1;
+    }
+
+    if (wal_ == NULL || txn->wal_lsn_ <= wal_->DurableLSN())
+        txn_results_.Push(txn);
+    else
+        unlogged_results_.Push(txn);
+}
+
+void TxnProcessor::RunLogWriter()
+{
+    Txn* txn;
+    bool stopping = false;
+    while (!stopping)
+    {
+        // Check before flushing, so that the last pass flushes everything.
+        stopping = stopped_;
+
+        uint64 writes  = wal_->Writes();
+        uint64 durable = wal_->Flush();
+
+        // Return every result the flush made durable, and hold on to the
+        // ones appended since.
+        while (unlogged_results_.Pop(&txn)) log_waiting_.push_back(txn);
+        log_publishing_.clear();
+        for (size_t i = log_waiting_.size(); i > 0; i--)
+        {
+            txn = log_waiting_.front();
+            log_waiting_.pop_front();
+            if (txn->wal_lsn_ <= durable)
+                log_publishing_.push_back(txn);
+            else
+                log_waiting_.push_back(txn);
+        }
+        if (!log_publishing_.empty()) txn_results_.PushBatch(&log_publishing_[0], log_publishing_.size());
+
+        // Let the workers fill the buffer rather than spin on an empty one.
+        if (wal_->Writes() == writes) sched_yield();
+    }
+}
+
+void TxnProcessor::Recover()
+{
+    double start = GetTime();
+    uint64 lsn   = 0;
+    if (config_.checkpoint_path.empty() ||
+        !LoadCheckpoint(config_.checkpoint_path, storage_, &lsn, config_.thread_count))
+    {
+        storage_->InitStorage();
+    }
+
+    if (!config_.wal_path.empty())
+    {
+        struct stat st;
+        if (stat(config_.wal_path.c_str(), &st) == 0 && static_cast<uint64>(st.st_size) < lsn)
+        {
+            DIE("Log " << config_.wal_path << " ends before checkpoint " << config_.checkpoint_path << " begins");
+        }
+
+        uint64 end;
+        recovered_records_ = ReplayLog(config_.wal_path, lsn, storage_, config_.thread_count, &end);
+
+        // Cut off a torn record at the end of the log, so that new records
+        // follow the last intact one.
+        if (stat(config_.wal_path.c_str(), &st) == 0 && static_cast<uint64>(st.st_size) > end)
+        {
+            if (truncate(config_.wal_path.c_str(), end) != 0) DIE("Cannot truncate log " << config_.wal_path);
+        }
+    }
+    recovery_time_ = GetTime() - start;
+}
+
+bool TxnProcessor::Checkpoint()
+{
+    if (wal_ == NULL || config_.checkpoint_path.empty()) DIE("Checkpoints need both a wal_path and a checkpoint_path");
+
+    checkpoint_mutex_.Lock();
+    uint64 lsn = wal_->AppendedLSN();
+    int epoch  = log_epoch_.fetch_add(1, std::memory_order_seq_cst);
+    for (int spins = 0; log_unapplied_[epoch & 1].load(std::memory_order_seq_cst) != 0; spins++)
+    {
+        if (stopped_)
+        {
+            checkpoint_mutex_.Unlock();
+            return false;
+        }
+        if (spins > 64) sched_yield();
+    }
+
+    WriteCheckpoint(storage_, config_.checkpoint_path, lsn, wal_);
+    checkpoints_.fetch_add(1, std::memory_order_relaxed);
+    checkpoint_mutex_.Unlock();
+    return true;
+}
+
+void TxnProcessor::RunCheckpointer()
+{
+    double last = GetTime();
+    while (!checkpoint_stopped_)
+    {
+        if (GetTime() - last < config_.checkpoint_interval)
+        {
+            Sleep(0.001);
+            continue;
+        }
+        Checkpoint();
+        last = GetTime();
+    }
 }
 
 void TxnProcessor::ApplyWrites(Txn* txn)
 {
     // Write buffered writes out to storage.
-    for (map<Key, Value>::iterator it = txn->writes_.begin(); it != txn->writes_.end(); ++it)
+    for (KeyValueMap::iterator it = txn->writes_.begin(); it != txn->writes_.end(); ++it)
     {
         storage_->Write(it->first, it->second, txn->unique_id_);
     }
@@ -279,27 +783,212 @@ void TxnProcessor::RunOCCScheduler()
 
 void TxnProcessor::RunOCCParallelScheduler()
 {
-    //
-    // Implement this method! Note that implementing OCC with parallel
-    // validation may need to create another method, like
-    // TxnProcessor::ExecuteTxnParallel.
-    // Note that you can use active_set_ and active_set_mutex_ we provided
-    // for you in the txn_processor.h
-    //
-    // [For now, run serial scheduler in order to make it through the test
-    // suite]
-    RunSerialScheduler();
+    Txn* txn;
+    while (!stopped_)
+    {
+        // Validation happens on the workers, so all that is left to do here
+        // is to hand out requests (including restarted txns).
+        if (txn_requests_.Pop(&txn))
+        {
+            tp_.AddTask([this, txn]() { this->ExecuteTxnParallel(txn); });
+        }
+    }
+}
+
+void TxnProcessor::BuildSignatures(Txn* txn)
+{
+    txn->occ_access_signature_.Clear();
+    txn->occ_write_signature_.Clear();
+    for (KeySet::iterator it = txn->readset_.begin(); it != txn->readset_.end(); ++it)
+    {
+        txn->occ_access_signature_.Add(*it);
+    }
+    for (KeySet::iterator it = txn->writeset_.begin(); it != txn->writeset_.end(); ++it)
+    {
+        txn->occ_access_signature_.Add(*it);
+        txn->occ_write_signature_.Add(*it);
+    }
+}
+
+void TxnProcessor::ExecuteTxnParallel(Txn* txn)
+{
+    // Read phase.
+    txn->occ_start_ticket_ = validator_->Begin();
+    ReadAndRun(txn);
+
+    if (txn->Status() != COMPLETED_C && txn->Status() != COMPLETED_A)
+    {
+        // Invalid TxnStatus!
+        DIE("Completed Txn has invalid TxnStatus: " << txn->Status());
+    }
+
+    // Validation phase. A txn voting to abort is validated too, since it may
+    // have based its decision on inconsistent reads, but writes nothing.
+    uint64 start = GetNanos();
+    bool commit  = (txn->Status() == COMPLETED_C);
+    uint64 ticket;
+    bool valid;
+    if (config_.occ_signatures)
+    {
+        // (A restart rebuilds the signatures.)
+        if (!commit) txn->occ_write_signature_.Clear();
+        ticket = validator_->Enter(commit ? &txn->writeset_ : NULL, &txn->occ_write_signature_);
+        valid  = validator_->Validate(txn->occ_start_ticket_, ticket, txn->readset_, txn->writeset_,
+                                     &txn->occ_access_signature_);
+    }
+    else
+    {
+        ticket = validator_->Enter(commit ? &txn->writeset_ : NULL);
+        valid  = validator_->Validate(txn->occ_start_ticket_, ticket, txn->readset_, txn->writeset_);
+    }
+    occ_validation_times_.Add(GetNanos() - start);
+
+    // Write phase.
+    if (valid && commit)
+    {
+        LogWrites(txn);
+        ApplyWrites(txn);
+    }
+    validator_->Finish(ticket, valid && commit);
+
+    if (!valid)
+    {
+        // Clean up and restart the txn.
+        txn->reads_.clear();
+        txn->writes_.clear();
+        txn->status_ = INCOMPLETE;
+        occ_restarts_.fetch_add(1, std::memory_order_relaxed);
+        NewTxnRequest(txn);
+        return;
+    }
+
+    txn->status_ = commit ? COMMITTED : ABORTED;
+
+    // Return result to client.
+    PublishResult(txn);
 }
 
 void TxnProcessor::RunMVCCScheduler()
 {
-    //
-    // Implement this method!
+    Txn* txn;
+    double last_gc = GetTime();
+    while (!stopped_)
+    {
+        // Pass the next txn request to an execution thread.
+        if (txn_requests_.Pop(&txn))
+        {
+            mvcc_dispatched_ids_.push_back(txn->unique_id_);
+            mvcc_last_dispatched_id_ = txn->unique_id_;
+            tp_.AddTask([this, txn]() { this->MVCCExecuteTxn(txn); });
+        }
 
-    // Hint:Pop a txn from txn_requests_, and pass it to a thread to execute.
-    // Note that you may need to create another execute method, like TxnProcessor::MVCCExecuteTxn.
-    //
-    // [For now, run serial scheduler in order to make it through the test
-    // suite]
-    RunSerialScheduler();
+        if (GetTime() - last_gc > kMVCCGCInterval)
+        {
+            GarbageCollection();
+            last_gc = GetTime();
+        }
+    }
+}
+
+void TxnProcessor::MVCCExecuteTxn(Txn* txn)
+{
+    txn->reads_.reserve(txn->readset_.size() + txn->writeset_.size());
+    txn->writes_.reserve(txn->writeset_.size());
+
+    // Read everything in from readset and writeset, as of the txn's timestamp.
+    for (KeySet::iterator it = txn->readset_.begin(); it != txn->readset_.end(); ++it)
+    {
+        Value result;
+        if (storage_->Read(*it, &result, txn->unique_id_)) txn->reads_[*it] = result;
+    }
+    for (KeySet::iterator it = txn->writeset_.begin(); it != txn->writeset_.end(); ++it)
+    {
+        Value result;
+        if (storage_->Read(*it, &result, txn->unique_id_)) txn->reads_[*it] = result;
+    }
+
+    // Execute txn's program logic.
+    txn->Run();
+
+    uint64 id = txn->unique_id_;
+    if (txn->Status() == COMPLETED_C)
+    {
+        MVCCLockWriteKeys(txn);
+        if (MVCCCheckWrites(txn))
+        {
+            LogWrites(txn);
+            ApplyWrites(txn);
+            MVCCUnlockWriteKeys(txn);
+            txn->status_ = COMMITTED;
+        }
+        else
+        {
+            // Cleanup and completely restart the txn under a new timestamp.
+            MVCCUnlockWriteKeys(txn);
+            txn->reads_.clear();
+            txn->writes_.clear();
+            txn->status_ = INCOMPLETE;
+            mvcc_finished_ids_.Push(id);
+            NewTxnRequest(txn);
+            return;
+        }
+    }
+    else if (txn->Status() == COMPLETED_A)
+    {
+        txn->status_ = ABORTED;
+    }
+    else
+    {
+        // Invalid TxnStatus!
+        DIE("Completed Txn has invalid TxnStatus: " << txn->Status());
+    }
+
+    mvcc_finished_ids_.Push(id);
+    PublishResult(txn);
+}
+
+bool TxnProcessor::MVCCCheckWrites(Txn* txn)
+{
+    for (KeySet::iterator it = txn->writeset_.begin(); it != txn->writeset_.end(); ++it)
+    {
+        if (!storage_->CheckWrite(*it, txn->unique_id_)) return false;
+    }
+    return true;
+}
+
+void TxnProcessor::MVCCLockWriteKeys(Txn* txn)
+{
+    // Keys are locked in sorted order, so writers cannot deadlock.
+    for (KeySet::iterator it = txn->writeset_.begin(); it != txn->writeset_.end(); ++it)
+    {
+        storage_->Lock(*it);
+    }
+}
+
+void TxnProcessor::MVCCUnlockWriteKeys(Txn* txn)
+{
+    for (KeySet::iterator it = txn->writeset_.begin(); it != txn->writeset_.end(); ++it)
+    {
+        storage_->Unlock(*it);
+    }
+}
+
+void TxnProcessor::GarbageCollection()
+{
+    uint64 id;
+    while (mvcc_finished_ids_.Pop(&id)) mvcc_finished_heap_.push(id);
+
+    // Txns are dispatched in unique_id order, so the oldest running txn is
+    // the first dispatched one that has not finished yet.
+    while (!mvcc_dispatched_ids_.empty() && !mvcc_finished_heap_.empty() &&
+           mvcc_finished_heap_.top() == mvcc_dispatched_ids_.front())
+    {
+        mvcc_finished_heap_.pop();
+        mvcc_dispatched_ids_.pop_front();
+    }
+    uint64 horizon = mvcc_dispatched_ids_.empty() ? mvcc_last_dispatched_id_ + 1 : mvcc_dispatched_ids_.front();
+
+    MVCCStorage* storage = static_cast<MVCCStorage*>(storage_);
+    storage->SetHorizon(horizon);
+    storage->Reclaim();
 }
@@ -4,23 +4,36 @@
 
 #include <deque>
 #include <map>
+#include <queue>
 #include <string>
 
+#include "txn/checkpoint.h"
 #include "txn/common.h"
+#include "txn/dense_storage.h"
+#include "txn/flat_lock_manager.h"
 #include "txn/lock_manager.h"
 #include "txn/mvcc_storage.h"
+#include "txn/occ_validator.h"
+#include "txn/online_lock_manager.h"
 #include "txn/storage.h"
 #include "txn/txn.h"
+#include "txn/wal.h"
 #include "utils/atomic.h"
+#include "utils/cpu_topology.h"
+#include "utils/histogram.h"
 #include "utils/mutex.h"
 #include "utils/static_thread_pool.h"
 
 using std::deque;
 using std::map;
+using std::priority_queue;
 using std::string;
 
 // The TxnProcessor supports five different execution modes, corresponding to
-// the four parts of assignment 2, plus a simple serial (non-concurrent) mode.
+// the four parts of assignment 2, plus a simple serial (non-concurrent) mode,
+// a locking mode whose lock table is partitioned across several scheduler
+// threads, and a locking mode for txns that do not declare their keys up
+// front.
 enum CCMode
 {
     SERIAL                 = 0,  // Serial transaction execution (no concurrency)
@@ -29,17 +42,110 @@ enum CCMode
     OCC                    = 3,  // Part 2
     P_OCC                  = 4,  // Part 3
     MVCC                   = 5,  // Part 4
+    LOCKING_PARTITIONED    = 6,  // Part 1B, lock table split across shards
+    LOCKING_ONLINE         = 7,  // Locks taken during execution, wait-die
 };
 
 // Returns a human-readable string naming of the providing mode.
 string ModeToString(CCMode mode);
 
-class TxnProcessor
+// Lock table used by the LOCKING and LOCKING_PARTITIONED modes.
+enum LockTableLayout
+{
+    LOCK_TABLE_HASH = 0,  // LockManagerB: unordered_map of request deques.
+    LOCK_TABLE_FLAT = 1,  // FlatLockManager: latched open buckets, pooled nodes.
+};
+
+// Single-version storage engine used by every mode except MVCC.
+enum StorageLayout
+{
+    STORAGE_HASH  = 0,  // Storage: unordered_maps, logical timestamps.
+    STORAGE_DENSE = 1,  // DenseStorage: record array, logical timestamps.
+};
+
+// Construction-time settings for a TxnProcessor. The defaults match the
+// standard benchmark configuration.
+struct TxnProcessorConfig
+{
+    TxnProcessorConfig()
+        : thread_count(8),
+          pinning(PIN_TOPOLOGY),
+          numa_node(0),
+          scheduler_shards(4),
+          lock_table(LOCK_TABLE_HASH),
+          storage(STORAGE_HASH),
+          commit_batch_size(32),
+          commit_max_delay(0),
+          occ_signatures(true),
+          wal_sync(WAL_SYNC_EVERY_BATCH),
+          wal_sync_interval(0.001),
+          checkpoint_interval(0)
+    {
+    }
+
+    // Number of worker threads in the thread pool.
+    int thread_count;
+
+    // How the scheduler and worker threads are bound to CPUs. With
+    // PIN_TOPOLOGY the scheduler gets a dedicated physical core and workers
+    // are spread one per physical core, starting on 'numa_node'.
+    PinningPolicy pinning;
+    int numa_node;
+
+    // Number of scheduler shards in LOCKING_PARTITIONED mode (at most 64).
+    // Each shard owns the keys that hash to it and runs its own lock manager
+    // on its own thread.
+    int scheduler_shards;
+
+    // Shared/exclusive lock table implementation.
+    LockTableLayout lock_table;
+
+    // Storage engine for the non-MVCC modes. LOCKING_ONLINE writes from several
+    // threads at once, so it needs STORAGE_DENSE. LOCKING_PARTITIONED runs on
+    // either, but its shards take turns writing to STORAGE_HASH.
+    StorageLayout storage;
+
+    // Group commit in the LOCKING_EXCLUSIVE_ONLY and LOCKING modes: the
+    // scheduler commits finished txns in batches of up to 'commit_batch_size'.
+    // A batch that is not full is committed once its first txn has waited
+    // 'commit_max_delay' seconds; with a delay of 0, whatever has finished is
+    // committed straight away without waiting for more.
+    int commit_batch_size;
+    double commit_max_delay;
+
+    // Whether P_OCC txns carry KeySignatures of their keys, so that most
+    // validation checks are settled by ANDing two bitmaps instead of merging
+    // key arrays.
+    bool occ_signatures;
+
+    // Write-ahead logging. With a non-empty 'wal_path', every committed txn's
+    // writes are appended to the log file at 'wal_path' before they become
+    // visible to other txns, and its result is returned only once the log has
+    // been flushed past its record, as 'wal_sync' prescribes. A dedicated
+    // thread flushes the log, so each flush covers every txn that committed
+    // during the previous one (group commit).
+    string wal_path;
+    WalSyncPolicy wal_sync;
+    double wal_sync_interval;
+
+    // Checkpoints and restart. With a non-empty 'checkpoint_path', the
+    // TxnProcessor starts from the checkpoint at that path, if there is one,
+    // instead of InitStorage(), and Checkpoint() writes new ones there; with
+    // a 'checkpoint_interval' above 0, a background thread also does so every
+    // that many seconds. If 'wal_path' names an existing log, the log is
+    // replayed from the checkpoint's LSN (or from its start) before any txn
+    // runs, so restart time grows with the log written since the last
+    // checkpoint rather than with the whole history. Checkpoints need a log.
+    string checkpoint_path;
+    double checkpoint_interval;
+};
+
+class TxnProcessor : private TxnAccessHook
 {
    public:
     // The TxnProcessor's constructor starts the TxnProcessor running in the
     // background.
-    explicit TxnProcessor(CCMode mode);
+    explicit TxnProcessor(CCMode mode, const TxnProcessorConfig& config = TxnProcessorConfig());
 
     // The TxnProcessor's destructor stops all background threads and deallocates
     // all objects currently owned by the TxnProcessor, except for Txn objects.
@@ -58,19 +164,98 @@ class TxnProcessor
 
     static void* StartScheduler(void* arg);
 
+    static void* StartSchedulerShard(void* arg);
+
+    static void* StartLogWriter(void* arg);
+
+    static void* StartCheckpointer(void* arg);
+
+    // The write-ahead log, or NULL if 'wal_path' was empty.
+    WriteAheadLog* Log() { return wal_; }
+
+    // Writes a fuzzy checkpoint of the storage to 'checkpoint_path' while
+    // txns keep running. It waits only for txns that logged their writes
+    // before it started to apply them. Returns false if the TxnProcessor was
+    // stopped first. At most one checkpoint is written at a time.
+    bool Checkpoint();
+
+    // Checkpoints written, seconds the constructor spent loading the
+    // checkpoint and replaying the log, and log records it replayed.
+    uint64 Checkpoints() const { return checkpoints_.load(std::memory_order_relaxed); }
+    double RecoveryTime() const { return recovery_time_; }
+    uint64 RecoveredRecords() const { return recovered_records_; }
+
+    // Group commit statistics for the LOCKING_EXCLUSIVE_ONLY and LOCKING
+    // modes: txns per batch, and microseconds from a batch's first txn
+    // finishing to the batch's results being published.
+    const Histogram& CommitBatchSizes() const { return commit_batch_sizes_; }
+    const Histogram& CommitBatchDelays() const { return commit_batch_delays_; }
+
+    // LOCKING_ONLINE statistics: lock requests that had to wait, and txn
+    // restarts forced by wait-die.
+    uint64 OnlineLockWaits() const { return online_lm_ == NULL ? 0 : online_lm_->Waits(); }
+    uint64 OnlineRestarts() const { return online_restarts_.load(std::memory_order_relaxed); }
+
+    // P_OCC statistics: nanoseconds each validation took, txns that failed
+    // validation and were restarted, and the fraction of checks against
+    // other txns' write sets that signatures settled without comparing keys.
+    const Histogram& OCCValidationTimes() const { return occ_validation_times_; }
+    uint64 OCCRestarts() const { return occ_restarts_.load(std::memory_order_relaxed); }
+    double OCCFilteredFraction() const
+    {
+        if (validator_ == NULL || validator_->SlotsChecked() == 0) return 0;
+        return static_cast<double>(validator_->SlotsFiltered()) / validator_->SlotsChecked();
+    }
+
    private:
     // Serial validation
     bool SerialValidate(Txn* txn);
 
-    // Parallel executtion/validation for OCC
+    // Parallel execution/validation for OCC: runs 'txn', validates it
+    // against the txns that entered validation since it started, and then
+    // commits it or, if it failed validation, resubmits it.
     void ExecuteTxnParallel(Txn* txn);
 
+    // Fills in 'txn's P_OCC key signatures.
+    void BuildSignatures(Txn* txn);
+
     // Serial version of scheduler.
     void RunSerialScheduler();
 
     // Locking version of scheduler.
     void RunLockingScheduler();
 
+    // Commits 'commit_batch_': applies the writes of every txn that voted to
+    // commit in one sorted batch, releases all of the batch's locks at once,
+    // and publishes all results with one queue operation.
+    void CommitBatch();
+
+    // Sequencer for LOCKING_PARTITIONED mode: forwards each txn request, in
+    // unique_id order, to every shard that owns one of its keys.
+    void RunPartitionedScheduler();
+
+    // Main loop of scheduler shard 'shard' in LOCKING_PARTITIONED mode.
+    void RunSchedulerShard(int shard);
+
+    // Scheduler for LOCKING_ONLINE mode: hands every request straight to the
+    // thread pool.
+    void RunOnlineScheduler();
+
+    // Runs 'txn' in LOCKING_ONLINE mode, locking keys as it touches them,
+    // then commits it or, if wait-die refused one of its lock requests,
+    // resubmits it.
+    void OnlineExecuteTxn(Txn* txn);
+
+    // TxnAccessHook, for LOCKING_ONLINE mode.
+    virtual bool BeforeRead(Txn* txn, const Key& key);
+    virtual bool BeforeWrite(Txn* txn, const Key& key);
+
+    // Releases every lock 'txn' took in LOCKING_ONLINE mode.
+    void ReleaseOnlineLocks(Txn* txn);
+
+    // Returns the scheduler shard that owns 'key'.
+    int ShardOf(const Key& key) const;
+
     // OCC version of scheduler.
     void RunOCCScheduler();
 
@@ -81,9 +266,34 @@ class TxnProcessor
     void RunMVCCScheduler();
 
     // Performs all reads required to execute the transaction, then executes the
-    // transaction logic.
+    // transaction logic, and hands it to the locking scheduler (or shards) to
+    // commit. Only the locking modes call it; they drain completed_txns_.
     void ExecuteTxn(Txn* txn);
 
+    // The part of ExecuteTxn() shared with ExecuteTxnParallel(): reads every
+    // key in the txn's read and write sets, then runs it.
+    void ReadAndRun(Txn* txn);
+
+    // Appends the writes of 'txn', which has voted to commit, to the
+    // write-ahead log (if any). Must be called before any other txn can see
+    // them, so that the log holds txns in an order consistent with their
+    // dependencies.
+    void LogWrites(Txn* txn);
+
+    // Returns the finished 'txn' to the client: at once, or, with a
+    // write-ahead log, once the log has been flushed past its record.
+    void PublishResult(Txn* txn);
+
+    // Main loop of the log writer thread: flushes the write-ahead log over
+    // and over, publishing the results it has made durable.
+    void RunLogWriter();
+
+    // Sets up 'storage_' from the checkpoint and the log, or from scratch.
+    void Recover();
+
+    // Main loop of the checkpoint thread.
+    void RunCheckpointer();
+
     // Applies all writes performed by '*txn' to 'storage_'.
     //
     // Requires: txn->Status() is COMPLETED_C.
@@ -98,22 +308,34 @@ class TxnProcessor
 
     void MVCCUnlockWriteKeys(Txn* txn);
 
+    // Advances the MVCC storage's GC horizon to the oldest running txn and
+    // frees versions no reader can reach any more. Scheduler thread only.
     void GarbageCollection();
 
     // Concurrency control mechanism the TxnProcessor is currently using.
     CCMode mode_;
 
+    // Settings the TxnProcessor was constructed with.
+    TxnProcessorConfig config_;
+
+    // CPUs assigned to the scheduler thread and the thread pool's workers.
+    // Must be initialized before 'tp_'.
+    CpuPlacement placement_;
+
     // Thread pool managing all threads used by TxnProcessor.
     StaticThreadPool tp_;
 
     // Data storage used for all modes.
     Storage* storage_;
 
-    // Next valid unique_id, and a mutex to guard incoming txn requests.
-    int next_unique_id_;
+    // Mutex to guard incoming txn requests, so that they are queued in
+    // unique_id order. Unique ids come from the storage's clock.
     Mutex mutex_;
 
     // Queue of incoming transaction requests.
+    //
+    // Unbounded, so that a client never waits on the scheduler and txns
+    // restarted from the thread pool are never refused.
     AtomicQueue<Txn*> txn_requests_;
 
     // Queue of txns that have acquired all locks and are ready to be executed.
@@ -123,27 +345,121 @@ class TxnProcessor
     deque<Txn*> ready_txns_;
 
     // Queue of completed (but not yet committed/aborted) transactions.
-    AtomicQueue<Txn*> completed_txns_;
+    //
+    // The scheduler drains it on every pass, so a full queue only makes the
+    // workers wait for it; the lock-free, bounded MPMCQueue (same interface as
+    // AtomicQueue) suffices.
+    MPMCQueue<Txn*> completed_txns_;
 
     // Queue of transaction results (already committed or aborted) to be returned
-    // to client.
+    // to client. Unbounded, as the client may read them whenever it likes.
     AtomicQueue<Txn*> txn_results_;
 
-    // Set of transactions that are currently in the process of parallel
-    // validation.
-    AtomicSet<Txn*> active_set_;
-
-    // Used it for critical section in parallel occ.
-    Mutex active_set_mutex_;
+    // Write sets of the txns that are currently in the process of parallel
+    // validation, or recently were (P_OCC only, else NULL).
+    OCCValidator* validator_;
+    Histogram occ_validation_times_;
+    std::atomic<uint64> occ_restarts_;
 
     // Lock Manager used for LOCKING concurrency implementations.
     LockManager* lm_;
 
+    // Lock table for LOCKING_ONLINE mode (NULL in other modes), and the
+    // number of txns it has made restart.
+    OnlineLockManager* online_lm_;
+    std::atomic<uint64> online_restarts_;
+
+    // LOCKING_ONLINE txns that wait-die made restart, for the scheduler to
+    // dispatch again. Unbounded, so that a worker never waits to push one.
+    AtomicQueue<Txn*> online_retries_;
+
+    // Group commit state for RunLockingScheduler. Only accessed by the
+    // scheduler thread, except for the histograms.
+    vector<Txn*> commit_batch_;
+    double commit_batch_start_;
+    vector<pair<Key, Value> > commit_writes_;
+    vector<LockManager::HeldLock> commit_locks_;
+    Histogram commit_batch_sizes_;
+    Histogram commit_batch_delays_;
+
+    // One partition of the lock table in LOCKING_PARTITIONED mode.
+    //
+    // Every shard receives the txns touching its keys in the same (unique_id)
+    // order from the sequencer, so shards acquire locks in a consistent global
+    // order and cannot deadlock. A txn is dispatched to the thread pool by
+    // whichever of its shards grants its last lock, and returned to the client
+    // by whichever shard releases its last lock.
+    struct SchedulerShard
+    {
+        explicit SchedulerShard(LockTableLayout layout)
+        {
+            if (layout == LOCK_TABLE_FLAT)
+                lm_ = new FlatLockManager(&ready_txns_);
+            else
+                lm_ = new LockManagerB(&ready_txns_);
+        }
+        ~SchedulerShard() { delete lm_; }
+
+        // Only accessed by the shard's own thread.
+        deque<Txn*> ready_txns_;
+        LockManager* lm_;
+
+        // Txns forwarded by the sequencer.
+        MPMCQueue<Txn*> requests_;
+
+        // Txns that have finished running and need to commit/release here.
+        MPMCQueue<Txn*> completed_;
+
+        pthread_t thread_;
+        char pad_[CACHE_LINE_SIZE];
+    };
+    vector<SchedulerShard*> shards_;
+
+    // Held by a scheduler shard while it writes a txn's records, when the
+    // storage does not allow concurrent writes: shards own disjoint keys, but
+    // the hash Storage may rehash under another writer.
+    Mutex shard_write_mutex_;
+
+    // MVCC garbage collection bookkeeping. Workers push the unique_id of every
+    // txn that finishes (commits, aborts or restarts) onto
+    // 'mvcc_finished_ids_'. The scheduler thread keeps the ids it dispatched,
+    // in order, and matches them against the finished ones to find the oldest
+    // txn still running: the GC horizon.
+    MPMCQueue<uint64> mvcc_finished_ids_;
+    deque<uint64> mvcc_dispatched_ids_;
+    priority_queue<uint64, vector<uint64>, std::greater<uint64> > mvcc_finished_heap_;
+    uint64 mvcc_last_dispatched_id_;
+
     // Used for stopping the continuous loop that runs in the scheduler thread
     bool stopped_;
 
     // Gives us access to the scheduler thread so that we can wait for it to join later.
     pthread_t scheduler_thread_;
+
+    // Write-ahead log and its writer thread, and the results waiting for the
+    // log to be flushed: handed over through 'unlogged_results_', then held
+    // in 'log_waiting_' by the writer thread.
+    WriteAheadLog* wal_;
+    pthread_t log_thread_;
+    MPMCQueue<Txn*> unlogged_results_;
+    deque<Txn*> log_waiting_;
+    vector<Txn*> log_publishing_;
+
+    // Checkpoint state. Txns that log their writes while a checkpoint may be
+    // taken count themselves in 'log_unapplied_[epoch % 2]' until the writes
+    // are applied. A checkpoint notes the log's end, moves 'log_epoch_' on,
+    // and waits for the previous epoch's count to drain: every record before
+    // the noted LSN has then been applied.
+    Mutex checkpoint_mutex_;
+    std::atomic<int> log_epoch_;
+    char pad0_[CACHE_LINE_SIZE];
+    std::atomic<uint64> log_unapplied_[2];
+    char pad1_[CACHE_LINE_SIZE];
+    std::atomic<uint64> checkpoints_;
+    bool checkpoint_stopped_;
+    pthread_t checkpoint_thread_;
+    double recovery_time_;
+    uint64 recovered_records_;
 };
 
 #endif  // _TXN_PROCESSOR_H_
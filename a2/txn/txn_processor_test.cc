@@ -23,6 +23,10 @@ string ModeToString(CCMode mode)
             return " OCC-P    ";
         case MVCC:
             return " MVCC     ";
+        case LOCKING_PARTITIONED:
+            return " Locking P";
+        case LOCKING_ONLINE:
+            return " Locking O";
         default:
             return "INVALID MODE";
     }
@@ -51,6 +55,23 @@ class RMWLoadGen : public LoadGen
     double wait_time_;
 };
 
+// Txns that pick their keys as they run (LOCKING_ONLINE only).
+class DynamicRMWLoadGen : public LoadGen
+{
+   public:
+    DynamicRMWLoadGen(int dbsize, int nreads, int nwrites, double wait_time)
+        : dbsize_(dbsize), nreads_(nreads), nwrites_(nwrites), wait_time_(wait_time)
+    {
+    }
+
+    virtual Txn* NewTxn() { return new DynamicRMW(dbsize_, nreads_, nwrites_, rand(), wait_time_); }
+   private:
+    int dbsize_;
+    int nreads_;
+    int nwrites_;
+    double wait_time_;
+};
+
 class RMWLoadGen2 : public LoadGen
 {
    public:
@@ -77,6 +98,17 @@ class RMWLoadGen2 : public LoadGen
     double wait_time_;
 };
 
+// Settings the benchmarks run the TxnProcessor in 'mode' with: the defaults,
+// but with the flat lock table, and with DenseStorage for the modes that write
+// to storage from several threads at once.
+TxnProcessorConfig BenchmarkConfig(CCMode mode)
+{
+    TxnProcessorConfig config;
+    config.lock_table = LOCK_TABLE_FLAT;
+    if (mode == LOCKING_PARTITIONED || mode == LOCKING_ONLINE) config.storage = STORAGE_DENSE;
+    return config;
+}
+
 void Benchmark(const vector<LoadGen*>& lg)
 {
     // Number of transaction requests that can be active at any given time.
@@ -84,7 +116,7 @@ void Benchmark(const vector<LoadGen*>& lg)
     deque<Txn*> doneTxns;
 
     // For each MODE...
-    for (CCMode mode = SERIAL; mode <= MVCC; mode = static_cast<CCMode>(mode + 1))
+    for (CCMode mode = SERIAL; mode <= LOCKING_ONLINE; mode = static_cast<CCMode>(mode + 1))
     {
         // Print out mode name.
         cout << ModeToString(mode) << flush;
@@ -98,7 +130,7 @@ void Benchmark(const vector<LoadGen*>& lg)
                 int txn_count = 0;
 
                 // Create TxnProcessor in next mode.
-                TxnProcessor* p = new TxnProcessor(mode);
+                TxnProcessor* p = new TxnProcessor(mode, BenchmarkConfig(mode));
 
                 // Record start time.
                 double start = GetTime();
@@ -145,6 +177,206 @@ void Benchmark(const vector<LoadGen*>& lg)
     }
 }
 
+// Runs 'lg' in LOCKING mode for each group commit setting and prints the
+// throughput along with the commit batch size and delay histograms.
+void GroupCommitBenchmark(LoadGen* lg)
+{
+    int batch_sizes[]   = {1, 8, 32, 128};
+    double max_delays[] = {0, 0.0001};
+    int active_txns     = 100;
+
+    for (int d = 0; d < 2; d++)
+    {
+        for (int b = 0; b < 4; b++)
+        {
+            TxnProcessorConfig config = BenchmarkConfig(LOCKING);
+            config.commit_batch_size  = batch_sizes[b];
+            config.commit_max_delay   = max_delays[d];
+            TxnProcessor* p = new TxnProcessor(LOCKING, config);
+
+            int txn_count = 0;
+            double start  = GetTime();
+            for (int i = 0; i < active_txns; i++) p->NewTxnRequest(lg->NewTxn());
+            while (GetTime() < start + 0.5)
+            {
+                delete p->GetTxnResult();
+                txn_count++;
+                p->NewTxnRequest(lg->NewTxn());
+            }
+            for (int i = 0; i < active_txns; i++)
+            {
+                delete p->GetTxnResult();
+                txn_count++;
+            }
+            double end = GetTime();
+
+            cout << "\t\t" << batch_sizes[b] << "\t" << max_delays[d] * 1e6 << "us\t" << txn_count / (end - start)
+                 << endl;
+            cout << "\t\t  batch size:  " << p->CommitBatchSizes().ToString() << endl;
+            cout << "\t\t  delay (us):  " << p->CommitBatchDelays().ToString() << endl;
+            delete p;
+        }
+    }
+}
+
+// Keeps 100 txns from 'lg' in flight in 'p' for 'seconds', then drains them.
+// Returns the number that committed.
+int DriveLoad(TxnProcessor* p, LoadGen* lg, double seconds)
+{
+    int active_txns = 100;
+    int committed   = 0;
+
+    double start = GetTime();
+    for (int i = 0; i < active_txns; i++) p->NewTxnRequest(lg->NewTxn());
+    while (GetTime() < start + seconds)
+    {
+        Txn* txn = p->GetTxnResult();
+        if (txn->Status() == COMMITTED) committed++;
+        delete txn;
+        p->NewTxnRequest(lg->NewTxn());
+    }
+    for (int i = 0; i < active_txns; i++)
+    {
+        Txn* txn = p->GetTxnResult();
+        if (txn->Status() == COMMITTED) committed++;
+        delete txn;
+    }
+    return committed;
+}
+
+// Runs 'lg' in 'mode' for half a second and prints the throughput and the
+// number of restarts (forced by wait-die or failed validation) per committed
+// txn. In P_OCC mode, also prints the mean and 99th percentile validation
+// time in nanoseconds.
+void AbortRateBenchmark(CCMode mode, LoadGen* lg)
+{
+    TxnProcessor* p = new TxnProcessor(mode, BenchmarkConfig(mode));
+    double start    = GetTime();
+    int committed   = DriveLoad(p, lg, 0.5);
+    double end      = GetTime();
+
+    uint64 restarts = p->OnlineRestarts() + p->OCCRestarts();
+    cout << "\t" << committed / (end - start) << "\t" << static_cast<double>(restarts) / committed << "\t";
+    if (mode == P_OCC)
+    {
+        cout << p->OCCValidationTimes().Mean() << "\t" << p->OCCValidationTimes().Percentile(99) << "\t";
+    }
+    cout << flush;
+    delete p;
+}
+
+// Runs 'lg' in P_OCC mode without and then with key signatures, printing the
+// throughput and mean validation time in nanoseconds of each, and the
+// fraction of write sets the signatures ruled out.
+void SignatureBenchmark(LoadGen* lg)
+{
+    for (int signatures = 0; signatures < 2; signatures++)
+    {
+        TxnProcessorConfig config;
+        config.occ_signatures = signatures;
+        TxnProcessor* p       = new TxnProcessor(P_OCC, config);
+        double start          = GetTime();
+        int committed         = DriveLoad(p, lg, 0.5);
+        double end            = GetTime();
+
+        cout << "\t" << committed / (end - start) << "\t" << p->OCCValidationTimes().Mean() << "\t";
+        if (signatures) cout << p->OCCFilteredFraction() << "\t";
+        cout << flush;
+        delete p;
+    }
+}
+
+// Runs 'lg' in LOCKING mode for half a second, logging to 'path' under
+// 'policy' (or not at all if 'path' is empty), and prints the throughput,
+// mean submit-to-result latency in microseconds, and log syncs per second.
+void WalBenchmark(LoadGen* lg, const string& path, WalSyncPolicy policy)
+{
+    TxnProcessorConfig config = BenchmarkConfig(LOCKING);
+    config.wal_path           = path;
+    config.wal_sync           = policy;
+    unlink(path.c_str());
+    TxnProcessor* p = new TxnProcessor(LOCKING, config);
+
+    int active_txns = 100;
+    int completed   = 0;
+    double latency  = 0;
+    unordered_map<Txn*, double> submitted;
+    double start = GetTime();
+    for (int i = 0; i < active_txns; i++)
+    {
+        Txn* txn = lg->NewTxn();
+        submitted[txn] = GetTime();
+        p->NewTxnRequest(txn);
+    }
+    while (completed < active_txns || GetTime() < start + 0.5)
+    {
+        Txn* txn = p->GetTxnResult();
+        latency += GetTime() - submitted[txn];
+        submitted.erase(txn);
+        delete txn;
+        completed++;
+        if (GetTime() < start + 0.5)
+        {
+            txn            = lg->NewTxn();
+            submitted[txn] = GetTime();
+            p->NewTxnRequest(txn);
+            active_txns++;
+        }
+    }
+    double end = GetTime();
+
+    uint64 syncs = p->Log() == NULL ? 0 : p->Log()->Syncs();
+    cout << "\t" << completed / (end - start) << "\t" << latency / completed * 1e6 << "\t" << syncs / (end - start)
+         << "\t" << flush;
+    delete p;
+    unlink(path.c_str());
+}
+
+static Storage* NewDenseStorage(Key keys) { return new DenseStorage(keys); }
+static Storage* NewMVCCStorage(Key keys) { return new MVCCStorage(keys); }
+
+// Fills a storage of 'keys' records (made by 'make') one Write() at a time,
+// as InitStorage() does, checkpoints it to 'dir', logs 'tail' txns of 5
+// random writes after the checkpoint, and restarts from the checkpoint and
+// the log. Prints the seconds each step takes, using 8 threads to restart.
+void RestartBenchmark(Storage* (*make)(Key), Key keys, int tail, const string& dir)
+{
+    string checkpoint = dir + "/txn_processor_test.ckpt";
+    string log_path   = dir + "/txn_processor_test.log";
+    unlink(log_path.c_str());
+
+    Storage* storage = make(keys);
+    double start     = GetTime();
+    for (Key key = 0; key < keys; key++) storage->Write(key, 0, 0);
+    double filled = GetTime();
+    WriteCheckpoint(storage, checkpoint, 0, NULL);
+    double checkpointed = GetTime();
+    delete storage;
+    {
+        WriteAheadLog log(log_path, WAL_SYNC_NONE);
+        for (int i = 0; i < tail; i++)
+        {
+            KeyValueMap writes;
+            for (int j = 0; j < 5; j++) writes[rand() % keys] = i;
+            log.Append(i, writes);
+        }
+    }
+
+    storage = make(keys);
+    uint64 lsn, end;
+    double restart = GetTime();
+    LoadCheckpoint(checkpoint, storage, &lsn, 8);
+    double loaded = GetTime();
+    ReplayLog(log_path, lsn, storage, 8, &end);
+    double replayed = GetTime();
+    delete storage;
+
+    cout << "\t" << filled - start << "\t" << checkpointed - filled << "\t" << loaded - restart << "\t"
+         << replayed - loaded << "\t" << flush;
+    unlink(checkpoint.c_str());
+    unlink(log_path.c_str());
+}
+
 int main(int argc, char** argv)
 {
     cout << "\t\t--------------------------------------" << endl;
@@ -265,4 +497,116 @@ int main(int argc, char** argv)
 
     for (uint32 i = 0; i < lg.size(); i++) delete lg[i];
     lg.clear();
+
+    cout << "\t\t--------------------------------------------------------" << endl;
+    cout << "\t\t  High contention (100 records): commits/s, restarts/commit" << endl;
+    cout << "\t\t--------------------------------------------------------" << endl;
+    cout << "\t\t\t\tLocking B\t\tLocking O" << endl;
+
+    int write_counts[] = {5, 10};
+    for (int i = 0; i < 2; i++)
+    {
+        RMWLoadGen predeclared(100, 0, write_counts[i], 0.0001);
+        cout << "\t\tRMW 0/" << write_counts[i] << flush;
+        AbortRateBenchmark(LOCKING, &predeclared);
+        AbortRateBenchmark(LOCKING_ONLINE, &predeclared);
+        cout << endl;
+    }
+    RMWLoadGen2 mixed(100, 30, 10, 0.0001);
+    cout << "\t\tMixed 30/10" << flush;
+    AbortRateBenchmark(LOCKING, &mixed);
+    AbortRateBenchmark(LOCKING_ONLINE, &mixed);
+    cout << endl;
+    for (int i = 0; i < 2; i++)
+    {
+        DynamicRMWLoadGen dynamic(100, 5, write_counts[i], 0.0001);
+        cout << "\t\tDynamic 5/" << write_counts[i] << "\t-\t-\t" << flush;
+        AbortRateBenchmark(LOCKING_ONLINE, &dynamic);
+        cout << endl;
+    }
+    cout << endl;
+
+    cout << "\t\t--------------------------------------------------------" << endl;
+    cout << "\t\t  OCC-P: commits/s, restarts/commit, validation ns mean, p99" << endl;
+    cout << "\t\t--------------------------------------------------------" << endl;
+    int dbsizes[] = {1000000, 100};
+    for (int j = 0; j < 2; j++)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            RMWLoadGen rmw(dbsizes[j], 0, write_counts[i], 0.0001);
+            cout << "\t\tRMW 0/" << write_counts[i] << " (" << dbsizes[j] << ")" << flush;
+            AbortRateBenchmark(P_OCC, &rmw);
+            cout << endl;
+        }
+        RMWLoadGen2 occ_mixed(dbsizes[j], 30, 10, 0.0001);
+        cout << "\t\tMixed 30/10 (" << dbsizes[j] << ")" << flush;
+        AbortRateBenchmark(P_OCC, &occ_mixed);
+        cout << endl;
+    }
+    cout << endl;
+
+    cout << "\t\t--------------------------------------------------------" << endl;
+    cout << "\t\t  OCC-P key signatures: commits/s, validation ns mean" << endl;
+    cout << "\t\t--------------------------------------------------------" << endl;
+    cout << "\t\t\t\tExact keys\t\tSignatures\t\tFiltered" << endl;
+    int read_counts[] = {5, 30};
+    for (int j = 0; j < 2; j++)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            RMWLoadGen rmw(dbsizes[j], read_counts[i], 5, 0.0001);
+            cout << "\t\tRMW " << read_counts[i] << "/5 (" << dbsizes[j] << ")" << flush;
+            SignatureBenchmark(&rmw);
+            cout << endl;
+        }
+    }
+    cout << endl;
+
+    cout << "\t\t--------------------------------------------------------" << endl;
+    cout << "\t\t  Write-ahead log: txns/s, latency us, syncs/s" << endl;
+    cout << "\t\t--------------------------------------------------------" << endl;
+    RMWLoadGen logged(1000000, 0, 5, 0);
+    cout << "\t\tNo log\t" << flush;
+    WalBenchmark(&logged, "", WAL_SYNC_NONE);
+    cout << endl;
+    const char* log_dirs[]     = {"/dev/shm", "/var/tmp"};
+    const char* policy_names[] = {"every batch", "timed", "none"};
+    for (int i = 0; i < 2; i++)
+    {
+        for (int policy = WAL_SYNC_EVERY_BATCH; policy <= WAL_SYNC_NONE; policy++)
+        {
+            cout << "\t\t" << log_dirs[i] << ", " << policy_names[policy] << flush;
+            WalBenchmark(&logged, string(log_dirs[i]) + "/txn_processor_test.log", static_cast<WalSyncPolicy>(policy));
+            cout << endl;
+        }
+    }
+    cout << endl;
+
+    cout << "\t\t--------------------------------------------------------" << endl;
+    cout << "\t\t  Restart: seconds to fill by Write(), checkpoint," << endl;
+    cout << "\t\t  load the checkpoint, replay the log tail" << endl;
+    cout << "\t\t--------------------------------------------------------" << endl;
+    cout << "\t\tDense 1M keys, 10k txn tail" << flush;
+    RestartBenchmark(NewDenseStorage, 1000000, 10000, "/var/tmp");
+    cout << endl << "\t\tDense 1M keys, 100k txn tail" << flush;
+    RestartBenchmark(NewDenseStorage, 1000000, 100000, "/var/tmp");
+    cout << endl << "\t\tMVCC 1M keys, 10k txn tail" << flush;
+    RestartBenchmark(NewMVCCStorage, 1000000, 10000, "/var/tmp");
+    cout << endl << "\t\tDense 100M keys, 10k txn tail" << flush;
+    RestartBenchmark(NewDenseStorage, 100000000, 10000, "/var/tmp");
+    cout << endl << endl;
+
+    cout << "\t\t--------------------------------------" << endl;
+    cout << "\t\t  Locking B group commit (txns/s)" << endl;
+    cout << "\t\t--------------------------------------" << endl;
+    cout << "\t\tBatch\tDelay\tThroughput" << endl;
+
+    cout << "\t\tLow contention read-write (5 records, no txn logic)" << endl;
+    RMWLoadGen low(1000000, 0, 5, 0);
+    GroupCommitBenchmark(&low);
+
+    cout << "\t\tHigh contention read-write (5 records, no txn logic)" << endl;
+    RMWLoadGen high(100, 0, 5, 0);
+    GroupCommitBenchmark(&high);
 }
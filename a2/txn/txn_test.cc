@@ -0,0 +1,182 @@
+#include "txn/txn.h"
+
+#include <stdlib.h>
+#include <atomic>
+#include <map>
+#include <new>
+#include <set>
+
+#include "txn/txn_processor.h"
+#include "txn/txn_types.h"
+#include "utils/testing.h"
+
+// Every call into the global allocator made by this binary, on any thread.
+static std::atomic<uint64> heap_allocs(0);
+
+void* operator new(size_t size)
+{
+    heap_allocs.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// Heap allocations plus slab chunks and large slab requests: everything that
+// reached malloc().
+static uint64 SystemAllocs()
+{
+    SlabAllocator::Stats stats = SlabAllocator::GetStats();
+    return heap_allocs.load() + stats.chunk_allocs + stats.large_allocs;
+}
+
+// RMW with its txn state exposed.
+class OpenRMW : public RMW
+{
+   public:
+    OpenRMW(int dbsize, int readsetsize, int writesetsize) : RMW(dbsize, readsetsize, writesetsize) {}
+    OpenRMW(const set<Key>& readset, const set<Key>& writeset) : RMW(readset, writeset) {}
+    using Txn::readset_;
+    using Txn::writeset_;
+    using Txn::reads_;
+    using Txn::writes_;
+};
+
+// Creates, fills in, clones and deletes an RMW txn of 30+30 keys.
+static void TxnLifecycle()
+{
+    OpenRMW* txn = new OpenRMW(1000000, 30, 30);
+    for (KeySet::iterator it = txn->writeset_.begin(); it != txn->writeset_.end(); ++it)
+    {
+        txn->reads_[*it]  = 1;
+        txn->writes_[*it] = 2;
+    }
+    Txn* clone = txn->clone();
+    delete txn;
+    delete clone;
+}
+
+TEST(TxnState_AllocationFreeWhenWarm)
+{
+    // Warm up the calling thread's slab caches.
+    for (int i = 0; i < 1000; i++) TxnLifecycle();
+
+    uint64 before = SystemAllocs();
+    for (int i = 0; i < 10000; i++) TxnLifecycle();
+    EXPECT_EQ(before, SystemAllocs());
+
+    END;
+}
+
+TEST(TxnState_SortedSets)
+{
+    set<Key> readset;
+    set<Key> writeset;
+    readset.insert(7);
+    readset.insert(3);
+    writeset.insert(5);
+    OpenRMW txn(readset, writeset);
+
+    Key expected[] = {3, 7};
+    int i          = 0;
+    for (KeySet::iterator it = txn.readset_.begin(); it != txn.readset_.end(); ++it) EXPECT_EQ(expected[i++], *it);
+    EXPECT_EQ(2, i);
+    EXPECT_EQ(1, txn.writeset_.count(5));
+    EXPECT_EQ(0, txn.writeset_.count(3));
+
+    END;
+}
+
+// Txn state as it was kept before KeySet/KeyValueMap and slab-allocated txns:
+// a heap-allocated txn holding std::set and std::map members.
+struct TreeTxnState
+{
+    set<Key> readset_;
+    set<Key> writeset_;
+    map<Key, Value> reads_;
+    map<Key, Value> writes_;
+};
+
+// Builds, fills and frees 'count' tree-based RMW txn states the way the
+// client, a worker and the scheduler would, and returns the number of system
+// allocations per txn.
+static double TreeAllocsPerTxn(int dbsize, int readsetsize, int writesetsize, int count)
+{
+    uint64 before = SystemAllocs();
+    for (int n = 0; n < count; n++)
+    {
+        TreeTxnState* txn = new TreeTxnState();
+        while (static_cast<int>(txn->readset_.size()) < readsetsize) txn->readset_.insert(rand() % dbsize);
+        while (static_cast<int>(txn->writeset_.size()) < writesetsize)
+        {
+            Key key = rand() % dbsize;
+            if (!txn->readset_.count(key)) txn->writeset_.insert(key);
+        }
+        for (set<Key>::iterator it = txn->readset_.begin(); it != txn->readset_.end(); ++it) txn->reads_[*it] = 0;
+        for (set<Key>::iterator it = txn->writeset_.begin(); it != txn->writeset_.end(); ++it)
+        {
+            txn->reads_[*it]  = 0;
+            txn->writes_[*it] = 1;
+        }
+        delete txn;
+    }
+    return static_cast<double>(SystemAllocs() - before) / count;
+}
+
+// Runs RMW txns through a TxnProcessor in 'mode' (100 in flight) and returns
+// the number of system allocations per committed txn in the steady state.
+static double ProcessorAllocsPerTxn(CCMode mode, int dbsize, int readsetsize, int writesetsize, int count)
+{
+    TxnProcessor p(mode);
+    const int kActive = 100;
+    for (int i = 0; i < kActive; i++) p.NewTxnRequest(new RMW(dbsize, readsetsize, writesetsize));
+
+    // Warm up, then measure.
+    uint64 before = 0;
+    int committed = 0;
+    for (int i = 0; i < 2 * count; i++)
+    {
+        if (i == count)
+        {
+            before    = SystemAllocs();
+            committed = 0;
+        }
+        Txn* txn = p.GetTxnResult();
+        if (txn->Status() == COMMITTED) committed++;
+        delete txn;
+        p.NewTxnRequest(new RMW(dbsize, readsetsize, writesetsize));
+    }
+    double allocs = static_cast<double>(SystemAllocs() - before) / (committed > 0 ? committed : 1);
+    for (int i = 0; i < kActive; i++) delete p.GetTxnResult();
+    return allocs;
+}
+
+void Benchmark()
+{
+    const int kTxns = 20000;
+    cout << "\t\t-------------------------------------------------------" << endl;
+    cout << "\t\t  System allocations per committed RMW txn" << endl;
+    cout << "\t\t-------------------------------------------------------" << endl;
+    cout << "\t\tKeys (r/w)\tTree state\tSerial\t\tLocking B" << endl;
+
+    int sizes[][2] = {{5, 0}, {0, 5}, {30, 0}, {0, 30}};
+    for (int i = 0; i < 4; i++)
+    {
+        int r = sizes[i][0];
+        int w = sizes[i][1];
+        cout << "\t\t" << r << "/" << w << "\t\t" << TreeAllocsPerTxn(1000000, r, w, kTxns) << "\t\t" << flush;
+        cout << ProcessorAllocsPerTxn(SERIAL, 1000000, r, w, kTxns) << "\t\t" << flush;
+        cout << ProcessorAllocsPerTxn(LOCKING, 1000000, r, w, kTxns) << endl;
+    }
+    cout << "\t\t(Tree state: a txn's sets and maps alone, kept as before in std::set and std::map.)" << endl;
+}
+
+int main(int argc, char** argv)
+{
+    TxnState_AllocationFreeWhenWarm();
+    TxnState_SortedSets();
+
+    Benchmark();
+}
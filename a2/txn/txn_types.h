@@ -87,11 +87,11 @@ class RMW : public Txn
 {
    public:
     explicit RMW(double time = 0) : time_(time) {}
-    RMW(const set<Key>& writeset, double time = 0) : time_(time) { writeset_ = writeset; }
+    RMW(const set<Key>& writeset, double time = 0) : time_(time) { writeset_.assign(writeset.begin(), writeset.end()); }
     RMW(const set<Key>& readset, const set<Key>& writeset, double time = 0) : time_(time)
     {
-        readset_  = readset;
-        writeset_ = writeset;
+        readset_.assign(readset.begin(), readset.end());
+        writeset_.assign(writeset.begin(), writeset.end());
     }
 
     // Constructor with randomized read/write sets
@@ -99,6 +99,8 @@ class RMW : public Txn
     {
         // Make sure we can find enough unique keys.
         DCHECK(dbsize >= readsetsize + writesetsize);
+        readset_.reserve(readsetsize);
+        writeset_.reserve(writesetsize);
 
         // Find readsetsize unique read keys.
         for (int i = 0; i < readsetsize; i++)
@@ -134,10 +136,10 @@ class RMW : public Txn
     {
         Value result;
         // Read everything in readset.
-        for (set<Key>::iterator it = readset_.begin(); it != readset_.end(); ++it) Read(*it, &result);
+        for (KeySet::iterator it = readset_.begin(); it != readset_.end(); ++it) Read(*it, &result);
 
         // Increment length of everything in writeset.
-        for (set<Key>::iterator it = writeset_.begin(); it != writeset_.end(); ++it)
+        for (KeySet::iterator it = writeset_.begin(); it != writeset_.end(); ++it)
         {
             result = 0;
             Read(*it, &result);
@@ -163,4 +165,68 @@ class RMW : public Txn
     double time_;
 };
 
+// Read-modify-write transaction whose keys are only chosen as it runs: reads
+// 'nreads' random keys, then increments 'nwrites' random keys. Its read and
+// write sets are not declared up front, so it can only be executed in
+// LOCKING_ONLINE mode. Keys are drawn from a generator seeded with 'seed', so
+// a restarted txn touches the same keys again.
+class DynamicRMW : public Txn
+{
+   public:
+    DynamicRMW(int dbsize, int nreads, int nwrites, unsigned seed, double time = 0)
+        : dbsize_(dbsize), nreads_(nreads), nwrites_(nwrites), seed_(seed), time_(time)
+    {
+    }
+
+    DynamicRMW* clone() const
+    {  // Virtual constructor (copying)
+        DynamicRMW* clone = new DynamicRMW(dbsize_, nreads_, nwrites_, seed_, time_);
+        this->CopyTxnInternals(clone);
+        return clone;
+    }
+
+    virtual void Run()
+    {
+        // Stop as soon as wait-die refuses a lock: the txn is restarting.
+        unsigned seed = seed_;
+        Value result;
+        for (int i = 0; i < nreads_; i++)
+        {
+            Read(rand_r(&seed) % dbsize_, &result);
+            if (Status() != INCOMPLETE) return;
+        }
+
+        for (int i = 0; i < nwrites_; i++)
+        {
+            Key key = rand_r(&seed) % dbsize_;
+            result  = 0;
+            Read(key, &result);
+            if (Status() != INCOMPLETE) return;
+            Write(key, result + 1);
+            if (Status() != INCOMPLETE) return;
+        }
+
+        // Run while loop to simulate the txn logic(duration is time_).
+        double begin = GetTime();
+        while (GetTime() - begin < time_)
+        {
+            for (int i = 0; i < 1000; i++)
+            {
+                int x = 100;
+                x     = x + 2;
+                x     = x * x;
+            }
+        }
+
+        COMMIT;
+    }
+
+   private:
+    int dbsize_;
+    int nreads_;
+    int nwrites_;
+    unsigned seed_;
+    double time_;
+};
+
 #endif  // _TXN_TYPES_H_
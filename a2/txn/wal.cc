@@ -0,0 +1,175 @@
+#include "txn/wal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+// FNV-1a hash of 'size' bytes at 'data'.
+static uint32 Hash(const char* data, size_t size)
+{
+    uint32 hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+template <typename T>
+static void Put(string* buffer, T value)
+{
+    buffer->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+WriteAheadLog::WriteAheadLog(const string& path, WalSyncPolicy policy, double sync_interval)
+    : policy_(policy),
+      sync_interval_(sync_interval),
+      last_sync_(GetTime()),
+      appended_lsn_(0),
+      synced_lsn_(0),
+      durable_lsn_(0),
+      writes_(0),
+      syncs_(0)
+{
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0) DIE("Cannot open log " << path << ": " << strerror(errno));
+
+    // LSNs continue from the end of an existing log.
+    off_t end = lseek(fd_, 0, SEEK_END);
+    if (end < 0) DIE("Cannot seek in log " << path << ": " << strerror(errno));
+    appended_lsn_ = end;
+    synced_lsn_   = end;
+    durable_lsn_.store(end, std::memory_order_relaxed);
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    policy_ = WAL_SYNC_EVERY_BATCH;
+    Flush();
+    close(fd_);
+}
+
+uint64 WriteAheadLog::Append(uint64 txn_id, const KeyValueMap& writes)
+{
+    uint32 body = sizeof(uint64) + sizeof(uint32) + writes.size() * 2 * sizeof(uint64);
+
+    mutex_.Lock();
+    size_t start = buffer_.size();
+    Put<uint32>(&buffer_, body);
+    Put<uint32>(&buffer_, 0);  // Hash, filled in below.
+    Put<uint64>(&buffer_, txn_id);
+    Put<uint32>(&buffer_, writes.size());
+    for (KeyValueMap::const_iterator it = writes.begin(); it != writes.end(); ++it)
+    {
+        Put<uint64>(&buffer_, it->first);
+        Put<uint64>(&buffer_, it->second);
+    }
+    uint32 hash = Hash(&buffer_[start + 2 * sizeof(uint32)], body);
+    memcpy(&buffer_[start + sizeof(uint32)], &hash, sizeof(hash));
+    appended_lsn_ += buffer_.size() - start;
+    uint64 lsn = appended_lsn_;
+    mutex_.Unlock();
+
+    return lsn;
+}
+
+uint64 WriteAheadLog::AppendedLSN()
+{
+    mutex_.Lock();
+    uint64 lsn = appended_lsn_;
+    mutex_.Unlock();
+    return lsn;
+}
+
+uint64 WriteAheadLog::Flush()
+{
+    // Take everything appended so far, leaving an empty buffer (with the
+    // capacity of the last one flushed) for appenders to fill meanwhile.
+    flushing_.clear();
+    mutex_.Lock();
+    flushing_.swap(buffer_);
+    uint64 lsn = appended_lsn_;
+    mutex_.Unlock();
+
+    if (!flushing_.empty())
+    {
+        WriteFully(flushing_.data(), flushing_.size());
+        writes_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool sync = (policy_ == WAL_SYNC_EVERY_BATCH && synced_lsn_ < lsn) ||
+                (policy_ == WAL_SYNC_TIMED && synced_lsn_ < lsn && GetTime() - last_sync_ >= sync_interval_);
+    if (sync)
+    {
+        if (fdatasync(fd_) != 0) DIE("fdatasync failed on log: " << strerror(errno));
+        last_sync_  = GetTime();
+        synced_lsn_ = lsn;
+        syncs_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    durable_lsn_.store(lsn, std::memory_order_release);
+    return lsn;
+}
+
+void WriteAheadLog::WriteFully(const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = write(fd_, data, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0) DIE("write failed on log: " << strerror(errno));
+        data += written;
+        size -= written;
+    }
+}
+
+bool WriteAheadLog::ReadLog(const string& path, vector<LogRecord>* records, uint64 from, uint64* end)
+{
+    records->clear();
+    if (end != NULL) *end = from;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    if (lseek(fd, from, SEEK_SET) < 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    string data;
+    char chunk[1 << 16];
+    ssize_t n;
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0) data.append(chunk, n);
+    close(fd);
+
+    size_t pos = 0;
+    while (pos + 2 * sizeof(uint32) <= data.size())
+    {
+        uint32 body;
+        uint32 hash;
+        memcpy(&body, &data[pos], sizeof(body));
+        memcpy(&hash, &data[pos + sizeof(uint32)], sizeof(hash));
+        const char* p = &data[pos + 2 * sizeof(uint32)];
+        if (body < sizeof(uint64) + sizeof(uint32) || pos + 2 * sizeof(uint32) + body > data.size()) break;
+        if (Hash(p, body) != hash) break;
+
+        LogRecord record;
+        uint32 count;
+        memcpy(&record.txn_id_, p, sizeof(uint64));
+        memcpy(&count, p + sizeof(uint64), sizeof(uint32));
+        if (body != sizeof(uint64) + sizeof(uint32) + count * 2 * sizeof(uint64)) break;
+        p += sizeof(uint64) + sizeof(uint32);
+        record.writes_.resize(count);
+        for (uint32 i = 0; i < count; i++)
+        {
+            memcpy(&record.writes_[i].first, p, sizeof(uint64));
+            memcpy(&record.writes_[i].second, p + sizeof(uint64), sizeof(uint64));
+            p += 2 * sizeof(uint64);
+        }
+        records->push_back(record);
+        pos += 2 * sizeof(uint32) + body;
+    }
+    if (end != NULL) *end = from + pos;
+    return true;
+}
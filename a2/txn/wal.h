@@ -0,0 +1,117 @@
+
+// Write-ahead log of committed txns' writes.
+
+#ifndef _WAL_H_
+#define _WAL_H_
+
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "txn/common.h"
+#include "txn/txn.h"
+#include "utils/mutex.h"
+
+using std::pair;
+using std::string;
+using std::vector;
+
+// When WriteAheadLog::Flush() waits for the data it wrote to reach the disk.
+enum WalSyncPolicy
+{
+    WAL_SYNC_EVERY_BATCH = 0,  // fdatasync() after every write: nothing acknowledged is lost.
+    WAL_SYNC_TIMED       = 1,  // fdatasync() at most once per sync interval.
+    WAL_SYNC_NONE        = 2,  // Never; the OS writes the data back when it likes.
+};
+
+// One txn's entry in the log.
+struct LogRecord
+{
+    uint64 txn_id_;
+    vector<pair<Key, Value> > writes_;
+};
+
+// Append-only log file of txn write sets, with group commit.
+//
+// Any number of threads Append() records, which are serialized into an
+// in-memory buffer, each getting a log sequence number (LSN): the file
+// offset just past the end of its record. One thread calls Flush() in a
+// loop; each call writes everything appended since the previous one with a
+// single write() and, depending on the sync policy, a single fdatasync().
+// Once DurableLSN() reaches a record's LSN, the record has been flushed.
+//
+// On disk, a record is
+//
+//     uint32 body size | uint32 FNV-1a hash of body | body
+//
+// where the body is the txn id (uint64), the number of writes (uint32), and
+// that many <key, value> pairs (uint64 each), all in host byte order. A
+// crash can leave a partly written record at the end of the file; its hash
+// will not match, and ReadLog() stops there.
+class WriteAheadLog
+{
+   public:
+    // Opens (creating, or appending to) the log file at 'path'. With
+    // WAL_SYNC_TIMED, Flush() syncs once 'sync_interval' seconds have passed
+    // since the last sync.
+    WriteAheadLog(const string& path, WalSyncPolicy policy, double sync_interval = 0.001);
+
+    // Flushes whatever is still buffered (syncing regardless of policy), and
+    // closes the file.
+    ~WriteAheadLog();
+
+    // Appends a record of 'writes' by txn 'txn_id', and returns its LSN.
+    uint64 Append(uint64 txn_id, const KeyValueMap& writes);
+
+    // Writes out every record appended so far, syncing as the policy says,
+    // and returns the new DurableLSN(). Only one thread may call Flush().
+    uint64 Flush();
+
+    // LSN up to which records have been flushed: written and synced with
+    // WAL_SYNC_EVERY_BATCH, only written otherwise.
+    uint64 DurableLSN() const { return durable_lsn_.load(std::memory_order_acquire); }
+
+    // LSN of the last record appended.
+    uint64 AppendedLSN();
+
+    // Number of Flush() calls that wrote something, and of fdatasync() calls.
+    uint64 Writes() const { return writes_.load(std::memory_order_relaxed); }
+    uint64 Syncs() const { return syncs_.load(std::memory_order_relaxed); }
+
+    // Reads every intact record in the log file at 'path' from LSN 'from' on
+    // into '*records', stopping at the end of the file or at the first torn or
+    // corrupt record, and sets '*end' (if not NULL) to the LSN just past the
+    // last record read. Returns false if the file cannot be opened.
+    //
+    // Requires: 'from' is 0 or the LSN of some record.
+    static bool ReadLog(const string& path, vector<LogRecord>* records, uint64 from = 0, uint64* end = NULL);
+
+   private:
+    // Writes 'size' bytes at 'data' to the file, retrying short writes.
+    void WriteFully(const char* data, size_t size);
+
+    int fd_;
+    WalSyncPolicy policy_;
+    double sync_interval_;
+    double last_sync_;
+
+    // Records appended but not yet handed to Flush(), and the LSN after the
+    // last of them. Guarded by 'mutex_'.
+    Mutex mutex_;
+    string buffer_;
+    uint64 appended_lsn_;
+
+    // Owned by the flushing thread: the buffer being written, swapped with
+    // 'buffer_' on every Flush() so that appends never wait for I/O.
+    string flushing_;
+
+    // LSN up to which the file has been fdatasync()ed. Flushing thread only.
+    uint64 synced_lsn_;
+
+    std::atomic<uint64> durable_lsn_;
+    std::atomic<uint64> writes_;
+    std::atomic<uint64> syncs_;
+};
+
+#endif  // _WAL_H_
@@ -0,0 +1,194 @@
+#include "txn/wal.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <map>
+#include <sstream>
+
+#include "txn/txn_processor.h"
+#include "txn/txn_types.h"
+#include "utils/testing.h"
+
+using std::map;
+
+// Returns a fresh log file path for this process.
+static string LogPath(const string& name)
+{
+    std::ostringstream path;
+    path << "/tmp/wal_test_" << getpid() << "_" << name << ".log";
+    unlink(path.str().c_str());
+    return path.str();
+}
+
+static KeyValueMap Writes(Key first, int count)
+{
+    KeyValueMap writes;
+    for (int i = 0; i < count; i++) writes[first + i] = 100 + i;
+    return writes;
+}
+
+TEST(WriteAheadLog_RoundTrip)
+{
+    string path = LogPath("round_trip");
+    {
+        WriteAheadLog log(path, WAL_SYNC_EVERY_BATCH);
+        uint64 lsn1 = log.Append(1, Writes(10, 3));
+        uint64 lsn2 = log.Append(2, KeyValueMap());
+        EXPECT_TRUE(lsn1 > 0 && lsn2 > lsn1);
+        EXPECT_EQ(0, log.DurableLSN());
+
+        // One flush writes and syncs both records.
+        EXPECT_EQ(lsn2, log.Flush());
+        EXPECT_EQ(lsn2, log.DurableLSN());
+        EXPECT_EQ(1, log.Writes());
+        EXPECT_EQ(1, log.Syncs());
+
+        // Nothing new: nothing to write or sync.
+        log.Flush();
+        EXPECT_EQ(1, log.Syncs());
+        log.Append(3, Writes(20, 1));
+    }
+
+    // The destructor flushed the last record.
+    vector<LogRecord> records;
+    EXPECT_TRUE(WriteAheadLog::ReadLog(path, &records));
+    EXPECT_EQ(3, records.size());
+    EXPECT_EQ(1, records[0].txn_id_);
+    EXPECT_EQ(3, records[0].writes_.size());
+    EXPECT_EQ(12, records[0].writes_[2].first);
+    EXPECT_EQ(102, records[0].writes_[2].second);
+    EXPECT_EQ(0, records[1].writes_.size());
+    EXPECT_EQ(3, records[2].txn_id_);
+
+    // Reopening continues where the file ends.
+    struct stat st;
+    stat(path.c_str(), &st);
+    {
+        WriteAheadLog log(path, WAL_SYNC_NONE);
+        EXPECT_EQ(static_cast<uint64>(st.st_size), log.DurableLSN());
+        EXPECT_TRUE(log.Append(4, Writes(30, 1)) > static_cast<uint64>(st.st_size));
+    }
+    EXPECT_TRUE(WriteAheadLog::ReadLog(path, &records));
+    EXPECT_EQ(4, records.size());
+
+    unlink(path.c_str());
+    END;
+}
+
+TEST(WriteAheadLog_TornTail)
+{
+    string path = LogPath("torn_tail");
+    uint64 first;
+    {
+        WriteAheadLog log(path, WAL_SYNC_NONE);
+        first = log.Append(1, Writes(10, 4));
+        log.Append(2, Writes(20, 4));
+    }
+
+    // Cut the second record short, as a crash mid-write might.
+    EXPECT_EQ(0, truncate(path.c_str(), first + 20));
+    vector<LogRecord> records;
+    EXPECT_TRUE(WriteAheadLog::ReadLog(path, &records));
+    EXPECT_EQ(1, records.size());
+    EXPECT_EQ(1, records[0].txn_id_);
+
+    EXPECT_FALSE(WriteAheadLog::ReadLog(path + ".missing", &records));
+
+    unlink(path.c_str());
+    END;
+}
+
+TEST(WriteAheadLog_SyncPolicies)
+{
+    string path = LogPath("policies");
+    {
+        WriteAheadLog log(path, WAL_SYNC_NONE);
+        for (int i = 0; i < 5; i++)
+        {
+            log.Append(i, Writes(i, 1));
+            log.Flush();
+        }
+        EXPECT_EQ(5, log.Writes());
+        EXPECT_EQ(0, log.Syncs());
+    }
+    {
+        // A long interval holds syncs back, but not writes.
+        WriteAheadLog log(path, WAL_SYNC_TIMED, 3600);
+        for (int i = 0; i < 5; i++)
+        {
+            uint64 lsn = log.Append(i, Writes(i, 1));
+            EXPECT_EQ(lsn, log.Flush());
+        }
+        EXPECT_EQ(5, log.Writes());
+        EXPECT_EQ(0, log.Syncs());
+    }
+    {
+        // A zero interval syncs whenever there is something unsynced.
+        WriteAheadLog log(path, WAL_SYNC_TIMED, 0);
+        log.Append(1, Writes(1, 1));
+        log.Flush();
+        log.Flush();
+        EXPECT_EQ(1, log.Syncs());
+    }
+
+    unlink(path.c_str());
+    END;
+}
+
+// Runs increments in each mode with a log, and checks that replaying the log
+// rebuilds the database the txns left behind.
+TEST(TxnProcessor_LogsCommittedWrites)
+{
+    CCMode modes[] = {SERIAL, LOCKING, LOCKING_PARTITIONED, P_OCC, MVCC, LOCKING_ONLINE};
+    for (int m = 0; m < 6; m++)
+    {
+        string path = LogPath("processor");
+        TxnProcessorConfig config;
+        config.wal_path   = path;
+        config.wal_sync   = WAL_SYNC_NONE;
+        config.lock_table = LOCK_TABLE_FLAT;
+        if (modes[m] == LOCKING_ONLINE) config.storage = STORAGE_DENSE;
+        TxnProcessor* p = new TxnProcessor(modes[m], config);
+
+        for (int i = 0; i < 500; i++) p->NewTxnRequest(new RMW(20, 0, 3));
+        for (int i = 0; i < 500; i++)
+        {
+            Txn* txn = p->GetTxnResult();
+            // A result is only returned once its writes are in the log.
+            EXPECT_TRUE(p->Log()->DurableLSN() > 0);
+            delete txn;
+        }
+
+        map<Key, Value> expected;
+        for (Key key = 0; key < 20; key++) expected[key] = 0;
+        vector<LogRecord> records;
+        EXPECT_TRUE(WriteAheadLog::ReadLog(path, &records));
+        EXPECT_EQ(500, records.size());
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            for (size_t j = 0; j < records[i].writes_.size(); j++)
+            {
+                expected[records[i].writes_[j].first] = records[i].writes_[j].second;
+            }
+        }
+
+        Txn* check = new Expect(expected);
+        p->NewTxnRequest(check);
+        p->GetTxnResult();
+        EXPECT_EQ(COMMITTED, check->Status());
+        delete check;
+
+        delete p;
+        unlink(path.c_str());
+    }
+
+    END;
+}
+
+int main(int argc, char** argv)
+{
+    WriteAheadLog_RoundTrip();
+    WriteAheadLog_TornTail();
+    WriteAheadLog_SyncPolicies();
+    TxnProcessor_LogsCommittedWrites();
+}
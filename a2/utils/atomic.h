@@ -2,13 +2,21 @@
 #ifndef _DB_UTILS_ATOMIC_H_
 #define _DB_UTILS_ATOMIC_H_
 
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
 #include <queue>
 #include <set>
 #include <unordered_map>
+#include <utility>
 
 #include <assert.h>
 #include "utils/mutex.h"
 
+// Size of a single cache line. Used to pad hot shared counters apart.
+#define CACHE_LINE_SIZE 64
+
 using std::queue;
 using std::set;
 using std::unordered_map;
@@ -153,7 +161,8 @@ class AtomicSet
 ///
 /// Queue with atomic push and pop operations.
 ///
-/// @TODO(alex): This should use lower-contention synchronization.
+/// Unbounded, but every operation takes a pthread mutex. See MPMCQueue<T> for
+/// a bounded lock-free alternative with the same interface.
 template <typename T>
 class AtomicQueue
 {
@@ -176,6 +185,14 @@ class AtomicQueue
         mutex_.Unlock();
     }
 
+    // Atomically pushes 'items[0..count)' onto the queue, in order.
+    void PushBatch(const T* items, size_t count)
+    {
+        mutex_.Lock();
+        for (size_t i = 0; i < count; i++) queue_.push(items[i]);
+        mutex_.Unlock();
+    }
+
     // If the queue is non-empty, (atomically) sets '*result' equal to the front
     // element, pops the front element from the queue, and returns true,
     // otherwise returns false.
@@ -242,6 +259,305 @@ class AtomicQueue
     Mutex mutex_;
 };
 
+/// @class MPMCQueue<T>
+///
+/// Bounded multi-producer multi-consumer lock-free queue with the same
+/// interface as AtomicQueue<T>, so either can back a given queue.
+///
+/// Implemented as Dmitry Vyukov's sequence-numbered ring buffer: every cell
+/// carries a sequence number telling producers and consumers whether it is
+/// free for the current lap, so a push or pop costs one CAS on the shared
+/// enqueue/dequeue position and no mutex. The two positions are padded onto
+/// separate cache lines so producers and consumers do not false-share.
+///
+/// T must be default-constructible and assignable. Capacity is rounded up to a
+/// power of two. Push() spins (yielding the CPU) while the queue is full.
+template <typename T>
+class MPMCQueue
+{
+   public:
+    explicit MPMCQueue(size_t capacity = 65536) : enqueue_pos_(0), dequeue_pos_(0)
+    {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        mask_  = size - 1;
+        cells_ = new Cell[size];
+        for (size_t i = 0; i < size; i++) cells_[i].seq_.store(i, std::memory_order_relaxed);
+    }
+
+    ~MPMCQueue() { delete[] cells_; }
+
+    // Returns the number of elements currently in the queue. Only a snapshot
+    // when other threads are pushing or popping concurrently.
+    int Size()
+    {
+        size_t tail = enqueue_pos_.load(std::memory_order_acquire);
+        size_t head = dequeue_pos_.load(std::memory_order_acquire);
+        return tail > head ? static_cast<int>(tail - head) : 0;
+    }
+
+    // Returns the maximum number of elements the queue can hold.
+    size_t Capacity() const { return mask_ + 1; }
+
+    // Atomically pushes 'item' onto the queue, waiting for space if the queue
+    // is full.
+    void Push(const T& item)
+    {
+        while (!TryPush(item)) sched_yield();
+    }
+
+    void Push(T&& item)
+    {
+        while (!TryPush(std::move(item))) sched_yield();
+    }
+
+    // Pushes 'items[0..count)' onto the queue, in order, waiting for space
+    // if the queue is full. Claims as many consecutive cells as are free with
+    // a single CAS, so a batch costs one CAS rather than one per item. Items
+    // of concurrent pushes may interleave only at those claim boundaries.
+    void PushBatch(const T* items, size_t count)
+    {
+        while (count > 0)
+        {
+            size_t pushed = TryPushBatch(items, count);
+            if (pushed == 0) sched_yield();
+            items += pushed;
+            count -= pushed;
+        }
+    }
+
+    // If the queue is non-empty, (atomically) sets '*result' equal to the front
+    // element, pops the front element from the queue, and returns true,
+    // otherwise returns false.
+    bool Pop(T* result) { return TryPop(result); }
+
+    // Pushes 'item' and returns true unless the queue is full, in which case
+    // immediately returns false.
+    bool PushNonBlocking(const T& item) { return TryPush(item); }
+    bool PushNonBlocking(T&& item) { return TryPush(std::move(item)); }
+
+    // Identical to Pop(): a lock-free pop never blocks.
+    bool PopNonBlocking(T* result) { return TryPop(result); }
+
+   private:
+    struct Cell
+    {
+        std::atomic<size_t> seq_;
+        T data_;
+    };
+
+    template <typename U>
+    bool TryPush(U&& item)
+    {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell* cell    = &cells_[pos & mask_];
+            size_t seq    = cell->seq_.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell->data_ = std::forward<U>(item);
+                    cell->seq_.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                // The cell still holds an element from the previous lap: full.
+                return false;
+            }
+            else
+            {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Pushes the longest prefix of 'items[0..count)' that fits in free cells
+    // following the enqueue position, and returns its length (0 if full).
+    size_t TryPushBatch(const T* items, size_t count)
+    {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            // Count the cells that are free for this lap.
+            size_t n = 0;
+            while (n < count && n <= mask_)
+            {
+                size_t seq = cells_[(pos + n) & mask_].seq_.load(std::memory_order_acquire);
+                if (seq != pos + n) break;
+                n++;
+            }
+            if (n == 0)
+            {
+                size_t seq = cells_[pos & mask_].seq_.load(std::memory_order_acquire);
+                if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos) < 0) return 0;
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed))
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    Cell* cell  = &cells_[(pos + i) & mask_];
+                    cell->data_ = items[i];
+                    cell->seq_.store(pos + i + 1, std::memory_order_release);
+                }
+                return n;
+            }
+        }
+    }
+
+    bool TryPop(T* result)
+    {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell* cell    = &cells_[pos & mask_];
+            size_t seq    = cell->seq_.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    *result     = std::move(cell->data_);
+                    cell->data_ = T();
+                    cell->seq_.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                // The cell has not been filled for this lap yet: empty.
+                return false;
+            }
+            else
+            {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Disallow copying.
+    MPMCQueue(const MPMCQueue&);
+    MPMCQueue& operator=(const MPMCQueue&);
+
+    char pad0_[CACHE_LINE_SIZE];
+    Cell* cells_;
+    size_t mask_;
+    char pad1_[CACHE_LINE_SIZE - sizeof(Cell*) - sizeof(size_t)];
+    std::atomic<size_t> enqueue_pos_;
+    char pad2_[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeue_pos_;
+    char pad3_[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+};
+
+/// @class WorkStealingDeque<T>
+///
+/// Bounded Chase-Lev work-stealing deque (in the C11 formulation of Le et al.,
+/// "Correct and Efficient Work-Stealing for Weak Memory Models").
+///
+/// A single owner thread pushes and pops at the bottom; any number of thief
+/// threads steal from the top. Owner operations touch no shared cache line
+/// unless the deque is nearly empty. T must be trivially copyable (in practice
+/// a pointer), since thieves read elements that the owner may be overwriting.
+template <typename T>
+class WorkStealingDeque
+{
+   public:
+    explicit WorkStealingDeque(size_t capacity = 1024) : top_(0), bottom_(0)
+    {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        mask_   = size - 1;
+        buffer_ = new std::atomic<T>[size];
+    }
+
+    ~WorkStealingDeque() { delete[] buffer_; }
+
+    // Returns the number of elements in the deque (a snapshot if other threads
+    // are active).
+    int Size()
+    {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        return b > t ? static_cast<int>(b - t) : 0;
+    }
+
+    // Owner only. Pushes 'item' at the bottom; returns false if the deque is
+    // full.
+    bool Push(T item)
+    {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        if (b - t > static_cast<int64_t>(mask_)) return false;
+        buffer_[b & mask_].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Owner only. Pops the most recently pushed element into '*result' and
+    // returns true, or returns false if the deque is empty.
+    bool Pop(T* result)
+    {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b)
+        {
+            // Empty.
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        *result = buffer_[b & mask_].load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            // Last element: race thieves for it.
+            bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread. Steals the oldest element into '*result' and returns true.
+    // Returns false if the deque is empty or another thread won the race for
+    // the element.
+    bool Steal(T* result)
+    {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) return false;
+
+        T item = buffer_[t & mask_].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return false;
+        }
+        *result = item;
+        return true;
+    }
+
+   private:
+    // Disallow copying.
+    WorkStealingDeque(const WorkStealingDeque&);
+    WorkStealingDeque& operator=(const WorkStealingDeque&);
+
+    std::atomic<int64_t> top_;
+    char pad0_[CACHE_LINE_SIZE - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t> bottom_;
+    char pad1_[CACHE_LINE_SIZE - sizeof(std::atomic<int64_t>)];
+    std::atomic<T>* buffer_;
+    size_t mask_;
+};
+
 // An atomically modifiable object. T is required to be a simple numeric type
 // or simple struct.
 template <typename T>
@@ -0,0 +1,220 @@
+#include "utils/atomic.h"
+
+#include <pthread.h>
+#include <sys/time.h>
+#include <vector>
+
+#include "utils/testing.h"
+
+using std::vector;
+
+// Returns the current wall-clock time in seconds.
+static double Now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+TEST(MPMCQueue_FIFO)
+{
+    MPMCQueue<int> q(8);
+    int x;
+
+    EXPECT_EQ(8, q.Capacity());
+    EXPECT_FALSE(q.Pop(&x));
+
+    for (int i = 0; i < 8; i++) EXPECT_TRUE(q.PushNonBlocking(i));
+    EXPECT_EQ(8, q.Size());
+
+    // Queue is full.
+    EXPECT_FALSE(q.PushNonBlocking(8));
+
+    for (int i = 0; i < 8; i++)
+    {
+        EXPECT_TRUE(q.Pop(&x));
+        EXPECT_EQ(i, x);
+    }
+    EXPECT_FALSE(q.PopNonBlocking(&x));
+    EXPECT_EQ(0, q.Size());
+
+    // Wrap around the ring a few times.
+    for (int i = 0; i < 100; i++)
+    {
+        q.Push(i);
+        EXPECT_TRUE(q.Pop(&x));
+        EXPECT_EQ(i, x);
+    }
+
+    END;
+}
+
+// Pops 0, 1, ..., 19 off an MPMCQueue<int>. Returns NULL iff they arrive in
+// that order.
+static void* PopTwenty(void* arg)
+{
+    MPMCQueue<int>* q = reinterpret_cast<MPMCQueue<int>*>(arg);
+    int expected      = 0;
+    int x;
+    while (expected < 20)
+    {
+        if (q->Pop(&x) && x != expected++) return arg;
+    }
+    return NULL;
+}
+
+TEST(MPMCQueue_PushBatch)
+{
+    MPMCQueue<int> q(8);
+    int items[20];
+    for (int i = 0; i < 20; i++) items[i] = i;
+    int x;
+
+    // Fits in one claim, wrapping around the ring.
+    q.Push(-1);
+    EXPECT_TRUE(q.Pop(&x));
+    q.PushBatch(items, 8);
+    EXPECT_EQ(8, q.Size());
+    for (int i = 0; i < 8; i++)
+    {
+        EXPECT_TRUE(q.Pop(&x));
+        EXPECT_EQ(i, x);
+    }
+
+    // Larger than the queue: waits for a consumer to make room.
+    AtomicQueue<int> locked;
+    locked.PushBatch(items, 20);
+    pthread_t consumer;
+    pthread_create(&consumer, NULL, PopTwenty, &q);
+    q.PushBatch(items, 20);
+    void* failed;
+    pthread_join(consumer, &failed);
+    EXPECT_TRUE(failed == NULL);
+
+    for (int i = 0; i < 20; i++)
+    {
+        EXPECT_TRUE(locked.Pop(&x));
+        EXPECT_EQ(i, x);
+    }
+
+    END;
+}
+
+// Shared state for one queue benchmark/stress run.
+template <typename Q>
+struct QueueRun
+{
+    Q* queue;
+    int items_per_producer;
+    int total_items;
+    std::atomic<int> consumed;
+    std::atomic<uint64_t> sum;
+    std::atomic<bool> go;
+};
+
+template <typename Q>
+void* Produce(void* arg)
+{
+    QueueRun<Q>* run = reinterpret_cast<QueueRun<Q>*>(arg);
+    while (!run->go.load()) sched_yield();
+    for (int i = 1; i <= run->items_per_producer; i++) run->queue->Push(i);
+    return NULL;
+}
+
+template <typename Q>
+void* Consume(void* arg)
+{
+    QueueRun<Q>* run = reinterpret_cast<QueueRun<Q>*>(arg);
+    uint64_t local_sum = 0;
+    int x;
+    while (!run->go.load()) sched_yield();
+    while (run->consumed.load(std::memory_order_relaxed) < run->total_items)
+    {
+        if (run->queue->Pop(&x))
+        {
+            local_sum += x;
+            run->consumed.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+    run->sum.fetch_add(local_sum);
+    return NULL;
+}
+
+// Runs 'nthreads' producers against 'nthreads' consumers and returns the
+// throughput in million items per second. Sets '*ok' to false if any item was
+// lost or duplicated.
+template <typename Q>
+double RunQueue(Q* queue, int nthreads, int total_items, bool* ok)
+{
+    QueueRun<Q> run;
+    run.queue              = queue;
+    run.items_per_producer = total_items / nthreads;
+    run.total_items        = run.items_per_producer * nthreads;
+    run.consumed           = 0;
+    run.sum                = 0;
+    run.go                 = false;
+
+    vector<pthread_t> threads(2 * nthreads);
+    for (int i = 0; i < nthreads; i++)
+    {
+        pthread_create(&threads[2 * i], NULL, Produce<Q>, &run);
+        pthread_create(&threads[2 * i + 1], NULL, Consume<Q>, &run);
+    }
+
+    double start = Now();
+    run.go       = true;
+    for (uint32_t i = 0; i < threads.size(); i++) pthread_join(threads[i], NULL);
+    double end = Now();
+
+    uint64_t n        = run.items_per_producer;
+    uint64_t expected = nthreads * (n * (n + 1) / 2);
+    *ok               = (run.sum.load() == expected) && (queue->Size() == 0);
+    return run.total_items / (end - start) / 1e6;
+}
+
+TEST(MPMCQueue_Concurrent)
+{
+    bool ok;
+    MPMCQueue<int> q(64);
+    RunQueue(&q, 4, 100000, &ok);
+    EXPECT_TRUE(ok);
+
+    END;
+}
+
+void Benchmark()
+{
+    const int kItems = 200000;
+    bool ok;
+
+    cout << "\t\t-----------------------------------------" << endl;
+    cout << "\t\t  Queue throughput (M items/s, P = C)" << endl;
+    cout << "\t\t-----------------------------------------" << endl;
+    cout << "\t\tP/C\tAtomicQueue\tMPMCQueue" << endl;
+
+    for (int nthreads = 1; nthreads <= 64; nthreads *= 2)
+    {
+        AtomicQueue<int> locked;
+        MPMCQueue<int> lockfree;
+
+        cout << "\t\t" << nthreads << flush;
+        double t = RunQueue(&locked, nthreads, kItems, &ok);
+        CHECK(ok, "AtomicQueue lost items");
+        cout << "\t" << t << "\t" << flush;
+        t = RunQueue(&lockfree, nthreads, kItems, &ok);
+        CHECK(ok, "MPMCQueue lost items");
+        cout << "\t" << t << endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    MPMCQueue_FIFO();
+    MPMCQueue_PushBatch();
+    MPMCQueue_Concurrent();
+    Benchmark();
+}
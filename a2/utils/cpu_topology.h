@@ -0,0 +1,283 @@
+
+#ifndef _DB_UTILS_CPU_TOPOLOGY_H_
+#define _DB_UTILS_CPU_TOPOLOGY_H_
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// How a thread pool's threads are bound to CPUs.
+enum PinningPolicy
+{
+    PIN_NONE     = 0,  // Leave placement to the OS scheduler.
+    PIN_TOPOLOGY = 1,  // One thread per physical core, NUMA-node first.
+};
+
+/// @class CpuTopology
+///
+/// Snapshot of the machine's online CPUs, which physical core and socket each
+/// belongs to, and which NUMA node it sits on. Read from /sys/devices/system
+/// on Linux; elsewhere (or if /sys is unreadable) every online CPU is treated
+/// as its own core on node 0.
+class CpuTopology
+{
+   public:
+    struct Cpu
+    {
+        int id_;       // Logical CPU number, as used by sched_setaffinity.
+        int core_;     // Physical core id (unique only within a package).
+        int package_;  // Socket.
+        int node_;     // NUMA node.
+    };
+
+    // Reads the topology of the current machine.
+    static CpuTopology Discover()
+    {
+        CpuTopology topo;
+        string online;
+        vector<int> ids;
+        if (ReadFile("/sys/devices/system/cpu/online", &online)) ids = ParseCpuList(online);
+        if (ids.empty())
+        {
+            long n = sysconf(_SC_NPROCESSORS_ONLN);
+            for (long i = 0; i < (n > 0 ? n : 1); i++) ids.push_back(i);
+        }
+
+        for (size_t i = 0; i < ids.size(); i++)
+        {
+            Cpu cpu;
+            cpu.id_      = ids[i];
+            cpu.core_    = ReadCpuInt(ids[i], "topology/core_id", ids[i]);
+            cpu.package_ = ReadCpuInt(ids[i], "topology/physical_package_id", 0);
+            cpu.node_    = 0;
+            topo.cpus_.push_back(cpu);
+        }
+
+        // Map CPUs to NUMA nodes.
+        string nodes;
+        if (ReadFile("/sys/devices/system/node/online", &nodes))
+        {
+            vector<int> node_ids = ParseCpuList(nodes);
+            for (size_t n = 0; n < node_ids.size(); n++)
+            {
+                char path[128];
+                string cpulist;
+                snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node_ids[n]);
+                if (!ReadFile(path, &cpulist)) continue;
+                vector<int> node_cpus = ParseCpuList(cpulist);
+                for (size_t c = 0; c < topo.cpus_.size(); c++)
+                {
+                    if (std::find(node_cpus.begin(), node_cpus.end(), topo.cpus_[c].id_) != node_cpus.end())
+                    {
+                        topo.cpus_[c].node_ = node_ids[n];
+                    }
+                }
+            }
+        }
+        return topo;
+    }
+
+    // Parses a kernel CPU list such as "0-3,8,10-11".
+    static vector<int> ParseCpuList(const string& list)
+    {
+        vector<int> result;
+        const char* p = list.c_str();
+        while (*p != '\0' && *p != '\n')
+        {
+            char* end;
+            int first = strtol(p, &end, 10);
+            if (end == p) break;
+            int last = first;
+            p        = end;
+            if (*p == '-')
+            {
+                last = strtol(p + 1, &end, 10);
+                p    = end;
+            }
+            for (int i = first; i <= last; i++) result.push_back(i);
+            if (*p == ',') p++;
+        }
+        return result;
+    }
+
+    const vector<Cpu>& Cpus() const { return cpus_; }
+    int NumCpus() const { return cpus_.size(); }
+    // Returns the number of distinct NUMA nodes with online CPUs.
+    int NumNodes() const
+    {
+        vector<int> nodes;
+        for (size_t i = 0; i < cpus_.size(); i++) nodes.push_back(cpus_[i].node_);
+        std::sort(nodes.begin(), nodes.end());
+        return std::unique(nodes.begin(), nodes.end()) - nodes.begin();
+    }
+
+    // Returns the CPUs grouped by physical core: element [i] lists the hardware
+    // threads of the i-th core. Cores on 'preferred_node' come first, then the
+    // rest in node order.
+    vector<vector<int> > PhysicalCores(int preferred_node) const
+    {
+        vector<Cpu> sorted(cpus_);
+        std::sort(sorted.begin(), sorted.end(), CoreOrder(preferred_node));
+
+        vector<vector<int> > cores;
+        for (size_t i = 0; i < sorted.size(); i++)
+        {
+            if (i == 0 || sorted[i].package_ != sorted[i - 1].package_ || sorted[i].core_ != sorted[i - 1].core_)
+            {
+                cores.push_back(vector<int>());
+            }
+            cores.back().push_back(sorted[i].id_);
+        }
+        return cores;
+    }
+
+    // Returns the NUMA node of logical CPU 'id' (0 if unknown).
+    int NodeOf(int id) const
+    {
+        for (size_t i = 0; i < cpus_.size(); i++)
+        {
+            if (cpus_[i].id_ == id) return cpus_[i].node_;
+        }
+        return 0;
+    }
+
+   private:
+    // Orders CPUs by (preferred node first, node, package, core, cpu id).
+    struct CoreOrder
+    {
+        explicit CoreOrder(int node) : node_(node) {}
+        bool operator()(const Cpu& a, const Cpu& b) const
+        {
+            bool a_pref = (a.node_ == node_), b_pref = (b.node_ == node_);
+            if (a_pref != b_pref) return a_pref;
+            if (a.node_ != b.node_) return a.node_ < b.node_;
+            if (a.package_ != b.package_) return a.package_ < b.package_;
+            if (a.core_ != b.core_) return a.core_ < b.core_;
+            return a.id_ < b.id_;
+        }
+        int node_;
+    };
+
+    static bool ReadFile(const char* path, string* contents)
+    {
+        FILE* f = fopen(path, "r");
+        if (f == NULL) return false;
+        char buf[4096];
+        size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+        fclose(f);
+        buf[n]    = '\0';
+        *contents = buf;
+        return n > 0;
+    }
+
+    static int ReadCpuInt(int cpu, const char* file, int fallback)
+    {
+        char path[128];
+        string contents;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/%s", cpu, file);
+        if (!ReadFile(path, &contents)) return fallback;
+        return atoi(contents.c_str());
+    }
+
+    vector<Cpu> cpus_;
+};
+
+/// @struct CpuPlacement
+///
+/// CPU assignment for a scheduler thread, optional scheduler shard threads,
+/// and a pool of workers. A CPU id of -1 means "unpinned".
+struct CpuPlacement
+{
+    CpuPlacement() : scheduler_cpu_(-1) {}
+
+    // Computes a placement for one scheduler thread, 'nshards' scheduler shard
+    // threads and 'nworkers' workers.
+    //
+    // With PIN_TOPOLOGY the scheduler and each shard get a physical core of
+    // their own and the workers are spread one per remaining physical core,
+    // filling 'preferred_node' before spilling onto other nodes. Only once
+    // every physical core is taken do workers move onto hyperthread siblings,
+    // and only once every hardware thread is taken do they share CPUs.
+    static CpuPlacement Compute(const CpuTopology& topo, int nworkers, PinningPolicy policy, int preferred_node = 0,
+                                int nshards = 0)
+    {
+        CpuPlacement placement;
+        placement.shard_cpus_.assign(nshards, -1);
+        placement.worker_cpus_.assign(nworkers, -1);
+        if (policy == PIN_NONE) return placement;
+
+        vector<vector<int> > cores = topo.PhysicalCores(preferred_node);
+
+        // Order hardware threads: first thread of each core, then second
+        // threads, and so on.
+        vector<int> order;
+        for (size_t round = 0; order.size() < static_cast<size_t>(topo.NumCpus()); round++)
+        {
+            for (size_t c = 0; c < cores.size(); c++)
+            {
+                if (round < cores[c].size()) order.push_back(cores[c][round]);
+            }
+        }
+
+        placement.scheduler_cpu_ = order[0];
+        for (int i = 0; i < nshards; i++) placement.shard_cpus_[i] = order[(1 + i) % order.size()];
+
+        // Keep the scheduling threads' cores to themselves unless that would
+        // leave no CPU for the workers.
+        size_t reserved = 1 + nshards;
+        size_t first    = (order.size() > reserved) ? reserved : 0;
+        for (int i = 0; i < nworkers; i++)
+        {
+            placement.worker_cpus_[i] = order[first + i % (order.size() - first)];
+        }
+        return placement;
+    }
+
+    // Returns a human-readable summary of the placement.
+    string ToString() const
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "scheduler:%d", scheduler_cpu_);
+        string s(buf);
+        if (!shard_cpus_.empty()) s += " shards:";
+        for (size_t i = 0; i < shard_cpus_.size(); i++)
+        {
+            snprintf(buf, sizeof(buf), "%s%d", i == 0 ? "" : ",", shard_cpus_[i]);
+            s += buf;
+        }
+        s += " workers:";
+        for (size_t i = 0; i < worker_cpus_.size(); i++)
+        {
+            snprintf(buf, sizeof(buf), "%s%d", i == 0 ? "" : ",", worker_cpus_[i]);
+            s += buf;
+        }
+        return s;
+    }
+
+    int scheduler_cpu_;        // CPU for the scheduler thread.
+    vector<int> shard_cpus_;   // CPU for each scheduler shard thread.
+    vector<int> worker_cpus_;  // CPU for each worker thread.
+};
+
+// Restricts threads created with 'attr' to logical CPU 'cpu'. No-op if 'cpu'
+// is negative or the platform does not support affinity.
+static inline void SetThreadAffinity(pthread_attr_t* attr, int cpu)
+{
+#if !defined(_MSC_VER) && !defined(__APPLE__)
+    if (cpu < 0) return;
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    pthread_attr_setaffinity_np(attr, sizeof(cpu_set_t), &cpuset);
+#endif
+}
+
+#endif  // _DB_UTILS_CPU_TOPOLOGY_H_
@@ -0,0 +1,62 @@
+#include "utils/cpu_topology.h"
+
+#include "utils/testing.h"
+
+TEST(ParseCpuList)
+{
+    vector<int> cpus = CpuTopology::ParseCpuList("0-3,8,10-11\n");
+    EXPECT_EQ(7, cpus.size());
+    EXPECT_EQ(0, cpus[0]);
+    EXPECT_EQ(3, cpus[3]);
+    EXPECT_EQ(8, cpus[4]);
+    EXPECT_EQ(11, cpus[6]);
+    EXPECT_EQ(0, CpuTopology::ParseCpuList("").size());
+
+    END;
+}
+
+TEST(PlacementOnDiscoveredTopology)
+{
+    CpuTopology topo = CpuTopology::Discover();
+    EXPECT_TRUE(topo.NumCpus() > 0);
+    EXPECT_TRUE(topo.NumNodes() > 0);
+
+    CpuPlacement none = CpuPlacement::Compute(topo, 8, PIN_NONE);
+    EXPECT_EQ(-1, none.scheduler_cpu_);
+    EXPECT_EQ(8, none.worker_cpus_.size());
+    EXPECT_EQ(-1, none.worker_cpus_[0]);
+
+    CpuPlacement placement = CpuPlacement::Compute(topo, 8, PIN_TOPOLOGY);
+    EXPECT_TRUE(placement.scheduler_cpu_ >= 0);
+    for (int i = 0; i < 8; i++)
+    {
+        EXPECT_TRUE(placement.worker_cpus_[i] >= 0);
+        // The scheduler keeps its CPU to itself whenever there is another one.
+        if (topo.NumCpus() > 1) EXPECT_TRUE(placement.worker_cpus_[i] != placement.scheduler_cpu_);
+    }
+
+    // Scheduler shards are placed right after the scheduler, ahead of workers.
+    CpuPlacement sharded = CpuPlacement::Compute(topo, 8, PIN_TOPOLOGY, 0, 2);
+    EXPECT_EQ(2, sharded.shard_cpus_.size());
+    EXPECT_EQ(placement.scheduler_cpu_, sharded.scheduler_cpu_);
+    for (int i = 0; i < 2; i++) EXPECT_TRUE(sharded.shard_cpus_[i] >= 0);
+    if (topo.NumCpus() > 3)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            EXPECT_TRUE(sharded.worker_cpus_[i] != sharded.shard_cpus_[0]);
+            EXPECT_TRUE(sharded.worker_cpus_[i] != sharded.shard_cpus_[1]);
+        }
+    }
+
+    cout << "\t\t" << topo.NumCpus() << " cpus, " << topo.NumNodes() << " nodes, "
+         << topo.PhysicalCores(0).size() << " cores; " << placement.ToString() << endl;
+
+    END;
+}
+
+int main(int argc, char** argv)
+{
+    ParseCpuList();
+    PlacementOnDiscoveredTopology();
+}
@@ -0,0 +1,231 @@
+
+#ifndef _DB_UTILS_EPOCH_H_
+#define _DB_UTILS_EPOCH_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <vector>
+
+#include "utils/atomic.h"
+#include "utils/mutex.h"
+
+using std::vector;
+
+/// @class EpochManager
+///
+/// Epoch-based reclamation for data structures with lock-free readers.
+///
+/// Readers bracket every access to shared nodes with Enter()/Exit() (or an
+/// EpochGuard). A writer that unlinks a node hands it to Retire() instead of
+/// deleting it, and Collect() frees it once no thread can still be looking at
+/// it.
+///
+/// Each thread inside a critical section publishes the global epoch it saw on
+/// entry. The global epoch only advances when every such thread has seen the
+/// current one, so a node retired during epoch e can no longer be reached by
+/// anyone once the global epoch has reached e + 2.
+///
+/// Threads are given a slot the first time they use a manager and keep it for
+/// the manager's lifetime; at most kMaxThreads distinct threads may use one
+/// manager.
+class EpochManager
+{
+   public:
+    static const int kMaxThreads = 256;
+
+    EpochManager() : epoch_(1), nslots_(0), id_(NextId()) {}
+    ~EpochManager()
+    {
+        for (int i = 0; i < nslots_.load(); i++)
+        {
+            for (size_t j = 0; j < slots_[i].limbo_.size(); j++)
+            {
+                slots_[i].limbo_[j].deleter_(slots_[i].limbo_[j].node_);
+            }
+        }
+    }
+
+    /// Enters a critical section. Calls nest.
+    inline void Enter()
+    {
+        Slot* slot = MySlot();
+        if (slot->depth_++ == 0)
+        {
+            slot->epoch_.store(epoch_.load(std::memory_order_relaxed));
+            // Our epoch must be visible before we load any shared pointer.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    /// Leaves a critical section.
+    inline void Exit()
+    {
+        Slot* slot = MySlot();
+        if (--slot->depth_ == 0) slot->epoch_.store(kQuiescent, std::memory_order_release);
+    }
+
+    /// Schedules 'node' to be freed by 'deleter(node)' once no thread can
+    /// still hold a reference obtained before it was unlinked.
+    ///
+    /// Requires: 'node' is no longer reachable by new readers.
+    void Retire(void* node, void (*deleter)(void*))
+    {
+        Slot* slot = MySlot();
+        Retired retired;
+        retired.node_    = node;
+        retired.deleter_ = deleter;
+        retired.epoch_   = epoch_.load();
+        slot->latch_.Lock();
+        slot->limbo_.push_back(retired);
+        slot->latch_.Unlock();
+    }
+
+    /// Advances the global epoch if every thread in a critical section has
+    /// observed it, then frees every node that is now safe to free. Returns
+    /// the number of nodes freed. Safe to call from any thread.
+    size_t Collect()
+    {
+        uint64_t epoch = epoch_.load();
+        int nslots     = nslots_.load();
+        bool advance   = true;
+        for (int i = 0; i < nslots && advance; i++)
+        {
+            uint64_t seen = slots_[i].epoch_.load();
+            if (seen != kQuiescent && seen != epoch) advance = false;
+        }
+        if (advance && epoch_.compare_exchange_strong(epoch, epoch + 1)) epoch++;
+
+        size_t freed = 0;
+        vector<Retired> ready;
+        for (int i = 0; i < nslots; i++)
+        {
+            Slot* slot = &slots_[i];
+            slot->latch_.Lock();
+            size_t kept = 0;
+            for (size_t j = 0; j < slot->limbo_.size(); j++)
+            {
+                if (slot->limbo_[j].epoch_ + 2 <= epoch)
+                    ready.push_back(slot->limbo_[j]);
+                else
+                    slot->limbo_[kept++] = slot->limbo_[j];
+            }
+            slot->limbo_.resize(kept);
+            slot->latch_.Unlock();
+
+            for (size_t j = 0; j < ready.size(); j++) ready[j].deleter_(ready[j].node_);
+            freed += ready.size();
+            ready.clear();
+        }
+        return freed;
+    }
+
+    /// Returns the number of retired nodes not yet freed.
+    size_t Pending()
+    {
+        size_t pending = 0;
+        for (int i = 0; i < nslots_.load(); i++)
+        {
+            slots_[i].latch_.Lock();
+            pending += slots_[i].limbo_.size();
+            slots_[i].latch_.Unlock();
+        }
+        return pending;
+    }
+
+    /// Returns the current global epoch.
+    uint64_t Epoch() const { return epoch_.load(); }
+
+   private:
+    static const uint64_t kQuiescent = 0;
+
+    struct Retired
+    {
+        void* node_;
+        void (*deleter_)(void*);
+        uint64_t epoch_;
+    };
+
+    struct Slot
+    {
+        Slot() : epoch_(kQuiescent), owner_(0), depth_(0) {}
+        std::atomic<uint64_t> epoch_;  // Epoch seen on entry, or kQuiescent.
+        std::atomic<uint64_t> owner_;  // ThreadToken() of the owning thread.
+        int depth_;                    // Nesting depth of Enter() calls.
+        SpinLatch latch_;              // Guards 'limbo_'.
+        vector<Retired> limbo_;        // Nodes retired by the owning thread.
+        char pad_[CACHE_LINE_SIZE];
+    };
+
+    // Process-wide unique ids, for managers and threads alike.
+    static uint64_t NextId()
+    {
+        static std::atomic<uint64_t> next(1);
+        return next.fetch_add(1);
+    }
+
+    static uint64_t ThreadToken()
+    {
+        static thread_local uint64_t token = NextId();
+        return token;
+    }
+
+    // Returns the calling thread's slot, claiming one on first use.
+    Slot* MySlot()
+    {
+        // Remember the slot for the last manager this thread used.
+        static thread_local uint64_t cached_manager = 0;
+        static thread_local Slot* cached_slot       = NULL;
+        if (cached_manager == id_) return cached_slot;
+
+        uint64_t token = ThreadToken();
+        Slot* slot     = NULL;
+        for (int i = 0; i < nslots_.load() && slot == NULL; i++)
+        {
+            if (slots_[i].owner_.load() == token) slot = &slots_[i];
+        }
+        for (int i = 0; i < kMaxThreads && slot == NULL; i++)
+        {
+            uint64_t free = 0;
+            if (slots_[i].owner_.compare_exchange_strong(free, token))
+            {
+                slot       = &slots_[i];
+                int nslots = nslots_.load();
+                while (nslots < i + 1 && !nslots_.compare_exchange_weak(nslots, i + 1))
+                {
+                }
+            }
+        }
+        if (slot == NULL)
+        {
+            fprintf(stderr, "EpochManager: more than %d threads\n", kMaxThreads);
+            abort();
+        }
+
+        cached_manager = id_;
+        cached_slot    = slot;
+        return slot;
+    }
+
+    std::atomic<uint64_t> epoch_;
+    std::atomic<int> nslots_;
+    const uint64_t id_;
+    Slot slots_[kMaxThreads];
+};
+
+/// @class EpochGuard
+///
+/// Keeps the calling thread inside an EpochManager critical section for the
+/// guard's lifetime.
+class EpochGuard
+{
+   public:
+    explicit EpochGuard(EpochManager* manager) : manager_(manager) { manager_->Enter(); }
+    ~EpochGuard() { manager_->Exit(); }
+
+   private:
+    EpochManager* manager_;
+};
+
+#endif  // _DB_UTILS_EPOCH_H_
@@ -0,0 +1,109 @@
+#include "utils/epoch.h"
+
+#include <pthread.h>
+#include <vector>
+
+#include "utils/testing.h"
+
+using std::vector;
+
+// Node whose deleter only marks it dead, so that tests can detect use after
+// "free" without touching freed memory.
+struct Node
+{
+    static const int kAlive = 0x600d;
+    static const int kDead  = 0xdead;
+    Node() : magic_(kAlive) {}
+    std::atomic<int> magic_;
+};
+
+static void MarkDead(void* node) { reinterpret_cast<Node*>(node)->magic_ = Node::kDead; }
+
+TEST(EpochManager_DefersWhileReading)
+{
+    EpochManager epochs;
+    Node node;
+
+    epochs.Enter();
+    epochs.Retire(&node, MarkDead);
+    EXPECT_EQ(1, epochs.Pending());
+
+    // Our own critical section pins the epoch, however often we collect.
+    for (int i = 0; i < 10; i++) epochs.Collect();
+    EXPECT_EQ(Node::kAlive, node.magic_.load());
+    epochs.Exit();
+
+    // Once we have left, two epoch advances free the node.
+    size_t freed = 0;
+    for (int i = 0; i < 3; i++) freed += epochs.Collect();
+    EXPECT_EQ(1, freed);
+    EXPECT_EQ(Node::kDead, node.magic_.load());
+    EXPECT_EQ(0, epochs.Pending());
+
+    END;
+}
+
+// Shared state for the concurrent test: readers dereference 'current' while
+// one writer keeps replacing and retiring it.
+struct EpochRun
+{
+    EpochManager* epochs;
+    std::atomic<Node*> current;
+    std::atomic<bool> done;
+    std::atomic<bool> ok;
+};
+
+static void* Reader(void* arg)
+{
+    EpochRun* run = reinterpret_cast<EpochRun*>(arg);
+    while (!run->done)
+    {
+        EpochGuard guard(run->epochs);
+        Node* node = run->current.load();
+        for (int i = 0; i < 10; i++)
+        {
+            if (node->magic_.load() != Node::kAlive) run->ok = false;
+        }
+    }
+    return NULL;
+}
+
+TEST(EpochManager_Concurrent)
+{
+    const int kReplacements = 100000;
+    EpochManager epochs;
+    vector<Node*> nodes;
+    for (int i = 0; i <= kReplacements; i++) nodes.push_back(new Node());
+
+    EpochRun run;
+    run.epochs  = &epochs;
+    run.current = nodes[0];
+    run.done    = false;
+    run.ok      = true;
+
+    vector<pthread_t> readers(3);
+    for (size_t i = 0; i < readers.size(); i++) pthread_create(&readers[i], NULL, Reader, &run);
+
+    size_t freed = 0;
+    for (int i = 1; i <= kReplacements; i++)
+    {
+        Node* old = run.current.exchange(nodes[i]);
+        epochs.Retire(old, MarkDead);
+        if (i % 16 == 0) freed += epochs.Collect();
+    }
+    run.done = true;
+    for (size_t i = 0; i < readers.size(); i++) pthread_join(readers[i], NULL);
+    for (int i = 0; i < 3; i++) freed += epochs.Collect();
+
+    EXPECT_TRUE(run.ok.load());
+    EXPECT_EQ(kReplacements, freed);
+    for (int i = 0; i <= kReplacements; i++) delete nodes[i];
+
+    END;
+}
+
+int main(int argc, char** argv)
+{
+    EpochManager_DefersWhileReading();
+    EpochManager_Concurrent();
+}
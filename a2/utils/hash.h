@@ -0,0 +1,13 @@
+#ifndef _DB_UTILS_HASH_H_
+#define _DB_UTILS_HASH_H_
+
+#include <stdint.h>
+
+/// Fibonacci hashing: multiplies 'key' by 2^64/phi. The high bits of the
+/// product depend on every bit of the key, so even runs of adjacent keys come
+/// out well spread. The low bits are no better mixed than the key's own, so
+/// callers should take their hash from the top, e.g. HashKey(k) >> (64 - n)
+/// for an n-bit hash.
+static inline uint64_t HashKey(uint64_t key) { return key * 11400714819323198485ull; }
+
+#endif  // _DB_UTILS_HASH_H_
@@ -0,0 +1,100 @@
+
+#ifndef _DB_UTILS_HISTOGRAM_H_
+#define _DB_UTILS_HISTOGRAM_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <string>
+
+using std::string;
+
+/// @class Histogram
+///
+/// Log-scale histogram of non-negative integer samples. Bucket 0 counts zeros
+/// and bucket i (i >= 1) counts samples in [2^(i-1), 2^i).
+///
+/// Counters are relaxed atomics: one thread typically records while others
+/// read, and readers see a consistent-enough snapshot for reporting.
+class Histogram
+{
+   public:
+    static const int kBuckets = 65;
+
+    Histogram() { Clear(); }
+
+    void Add(uint64_t sample)
+    {
+        int bucket = sample == 0 ? 0 : 64 - __builtin_clzll(sample);
+        buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(sample, std::memory_order_relaxed);
+        uint64_t max = max_.load(std::memory_order_relaxed);
+        while (sample > max && !max_.compare_exchange_weak(max, sample, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void Clear()
+    {
+        for (int i = 0; i < kBuckets; i++) buckets_[i].store(0, std::memory_order_relaxed);
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t Max() const { return max_.load(std::memory_order_relaxed); }
+    double Mean() const
+    {
+        uint64_t count = Count();
+        return count == 0 ? 0 : static_cast<double>(sum_.load(std::memory_order_relaxed)) / count;
+    }
+
+    /// Returns the number of samples in bucket 'i'.
+    uint64_t BucketCount(int i) const { return buckets_[i].load(std::memory_order_relaxed); }
+
+    /// Returns an upper bound on the 'p'-th percentile (0 < p <= 100): the
+    /// exclusive upper end of the bucket it falls in, capped at Max().
+    uint64_t Percentile(double p) const
+    {
+        uint64_t count = Count();
+        if (count == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(p / 100 * count + 0.5);
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; i++)
+        {
+            seen += BucketCount(i);
+            if (seen >= rank)
+            {
+                uint64_t upper = i == 0 ? 0 : (i == 64 ? UINT64_MAX : (1ull << i) - 1);
+                return upper < Max() ? upper : Max();
+            }
+        }
+        return Max();
+    }
+
+    /// Returns e.g. "n=120 mean=14.2 p50<=15 p99<=31 max=40".
+    string ToString() const
+    {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "n=%llu mean=%.1f p50<=%llu p99<=%llu max=%llu",
+                 static_cast<unsigned long long>(Count()), Mean(),
+                 static_cast<unsigned long long>(Percentile(50)),
+                 static_cast<unsigned long long>(Percentile(99)), static_cast<unsigned long long>(Max()));
+        return buf;
+    }
+
+   private:
+    std::atomic<uint64_t> buckets_[kBuckets];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+
+    // Disallow copying.
+    Histogram(const Histogram&);
+    Histogram& operator=(const Histogram&);
+};
+
+#endif  // _DB_UTILS_HISTOGRAM_H_
@@ -0,0 +1,35 @@
+#include "utils/histogram.h"
+
+#include "utils/testing.h"
+
+TEST(Histogram_Buckets)
+{
+    Histogram h;
+    EXPECT_EQ(0, h.Count());
+    EXPECT_EQ(0, h.Percentile(50));
+
+    h.Add(0);
+    h.Add(1);
+    h.Add(2);
+    h.Add(3);
+    h.Add(100);
+    EXPECT_EQ(5, h.Count());
+    EXPECT_EQ(1, h.BucketCount(0));
+    EXPECT_EQ(1, h.BucketCount(1));
+    EXPECT_EQ(2, h.BucketCount(2));
+    EXPECT_EQ(1, h.BucketCount(7));
+    EXPECT_EQ(100, h.Max());
+    EXPECT_TRUE(h.Mean() > 21.1 && h.Mean() < 21.3);
+
+    // 3rd of 5 samples is 2, in bucket [2, 4).
+    EXPECT_EQ(3, h.Percentile(50));
+    EXPECT_EQ(100, h.Percentile(100));
+
+    h.Clear();
+    EXPECT_EQ(0, h.Count());
+    EXPECT_EQ(0, h.Max());
+
+    END;
+}
+
+int main(int argc, char** argv) { Histogram_Buckets(); }
@@ -0,0 +1,87 @@
+#ifndef _DB_UTILS_KEY_SIGNATURE_H_
+#define _DB_UTILS_KEY_SIGNATURE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "utils/hash.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/// @class KeySignature
+///
+/// Fixed-size summary of a set of integer keys: a 1024-bit map in which each
+/// key sets the one bit its hash selects.
+///
+/// Two sets can only share a key if their signatures share a set bit, so
+/// Intersects() returning false proves the sets are disjoint, and only a
+/// true result needs checking against the sets themselves. With one bit per
+/// key (rather than a Bloom filter's several), a 10-key set and a 40-key set
+/// still come out disjoint about two times in three when they are.
+///
+/// Intersects() ANDs the maps 256 bits (AVX2) or 128 bits (SSE2) at a time,
+/// as the target allows.
+class KeySignature
+{
+   public:
+    static const int kBits  = 1024;
+    static const int kWords = kBits / 64;
+
+    KeySignature() { Clear(); }
+
+    void Clear() { memset(words_, 0, sizeof(words_)); }
+
+    void Add(uint64_t key)
+    {
+        int bit = Bit(key);
+        words_[bit >> 6] |= 1ull << (bit & 63);
+    }
+
+    /// Returns false if 'key' was definitely never added.
+    bool MayContain(uint64_t key) const
+    {
+        int bit = Bit(key);
+        return (words_[bit >> 6] >> (bit & 63)) & 1;
+    }
+
+    /// Returns false if no key was added to both signatures.
+    bool Intersects(const KeySignature& other) const
+    {
+#if defined(__AVX2__)
+        __m256i any = _mm256_setzero_si256();
+        for (int i = 0; i < kWords; i += 4)
+        {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&words_[i]));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&other.words_[i]));
+            any       = _mm256_or_si256(any, _mm256_and_si256(a, b));
+        }
+        return !_mm256_testz_si256(any, any);
+#elif defined(__SSE2__)
+        __m128i any = _mm_setzero_si128();
+        for (int i = 0; i < kWords; i += 2)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&words_[i]));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&other.words_[i]));
+            any       = _mm_or_si128(any, _mm_and_si128(a, b));
+        }
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(any, _mm_setzero_si128())) != 0xFFFF;
+#else
+        uint64_t any = 0;
+        for (int i = 0; i < kWords; i++) any |= words_[i] & other.words_[i];
+        return any != 0;
+#endif
+    }
+
+    /// Raw access, for copying a signature word by word (e.g. into atomics).
+    uint64_t Word(int i) const { return words_[i]; }
+    void SetWord(int i, uint64_t word) { words_[i] = word; }
+
+   private:
+    static int Bit(uint64_t key) { return static_cast<int>(HashKey(key) >> (64 - 10)); }
+
+    uint64_t words_[kWords];
+};
+
+#endif  // _DB_UTILS_KEY_SIGNATURE_H_
@@ -0,0 +1,54 @@
+#include "utils/key_signature.h"
+
+#include "utils/testing.h"
+
+TEST(KeySignature_NoFalseNegatives)
+{
+    KeySignature a;
+    KeySignature b;
+    EXPECT_FALSE(a.Intersects(b));
+
+    for (uint64_t key = 0; key < 100; key++) a.Add(key * 7919);
+    for (uint64_t key = 0; key < 100; key++) EXPECT_TRUE(a.MayContain(key * 7919));
+
+    // Any shared key makes the signatures intersect, whichever word its bit
+    // lands in.
+    for (uint64_t key = 0; key < 100; key++)
+    {
+        b.Clear();
+        b.Add(key * 7919);
+        EXPECT_TRUE(a.Intersects(b));
+        EXPECT_TRUE(b.Intersects(a));
+    }
+
+    a.Clear();
+    EXPECT_FALSE(a.Intersects(b));
+
+    END;
+}
+
+TEST(KeySignature_DisjointSets)
+{
+    // Disjoint 5-key sets should almost always have disjoint signatures.
+    int intersecting = 0;
+    for (uint64_t i = 0; i < 1000; i++)
+    {
+        KeySignature a;
+        KeySignature b;
+        for (uint64_t j = 0; j < 5; j++)
+        {
+            a.Add(i * 10 + j);
+            b.Add(i * 10 + 5 + j);
+        }
+        if (a.Intersects(b)) intersecting++;
+    }
+    EXPECT_TRUE(intersecting < 100);
+
+    END;
+}
+
+int main(int argc, char** argv)
+{
+    KeySignature_NoFalseNegatives();
+    KeySignature_DisjointSets();
+}
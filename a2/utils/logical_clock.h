@@ -0,0 +1,41 @@
+#ifndef _DB_UTILS_LOGICAL_CLOCK_H_
+#define _DB_UTILS_LOGICAL_CLOCK_H_
+
+#include <stdint.h>
+#include <atomic>
+
+#include "utils/atomic.h"
+
+/// @class LogicalClock
+///
+/// Monotonic 64-bit logical clock. Every timestamp it issues is unique and
+/// greater than every timestamp issued before it, on any thread, so a reader
+/// that saw Now() == t knows that anything stamped later is stamped > t.
+///
+/// Issuing a timestamp is one atomic add on a counter that sits on its own
+/// cache line; there is no system call and no wall-clock resolution limit.
+/// Callers that stamp several things at once reserve a whole range with a
+/// single Reserve().
+///
+/// Timestamps start at 1, so 0 can mean "never".
+class LogicalClock
+{
+   public:
+    LogicalClock() : last_(0) {}
+
+    /// Returns the most recently issued timestamp (0 if none yet).
+    uint64_t Now() const { return last_.load(std::memory_order_acquire); }
+
+    /// Issues the next timestamp.
+    uint64_t Tick() { return last_.fetch_add(1, std::memory_order_acq_rel) + 1; }
+
+    /// Issues 'n' consecutive timestamps and returns the first of them.
+    uint64_t Reserve(uint64_t n) { return last_.fetch_add(n, std::memory_order_acq_rel) + 1; }
+
+   private:
+    char pad0_[CACHE_LINE_SIZE];
+    std::atomic<uint64_t> last_;
+    char pad1_[CACHE_LINE_SIZE];
+};
+
+#endif  // _DB_UTILS_LOGICAL_CLOCK_H_
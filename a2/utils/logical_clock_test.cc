@@ -0,0 +1,72 @@
+#include "utils/logical_clock.h"
+
+#include <pthread.h>
+#include <algorithm>
+#include <vector>
+
+#include "utils/testing.h"
+
+using std::vector;
+
+TEST(LogicalClock_Monotonic)
+{
+    LogicalClock clock;
+    EXPECT_EQ(0, clock.Now());
+    EXPECT_EQ(1, clock.Tick());
+    EXPECT_EQ(2, clock.Tick());
+    EXPECT_EQ(2, clock.Now());
+
+    // A reserved range is issued in one go.
+    EXPECT_EQ(3, clock.Reserve(10));
+    EXPECT_EQ(12, clock.Now());
+    EXPECT_EQ(13, clock.Tick());
+
+    END;
+}
+
+struct TickRun
+{
+    LogicalClock* clock;
+    vector<uint64_t> issued;
+};
+
+static void* TickMany(void* arg)
+{
+    TickRun* run = reinterpret_cast<TickRun*>(arg);
+    for (int i = 0; i < 10000; i++) run->issued.push_back(run->clock->Tick());
+    return NULL;
+}
+
+TEST(LogicalClock_UniqueAcrossThreads)
+{
+    LogicalClock clock;
+    TickRun runs[4];
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++)
+    {
+        runs[i].clock = &clock;
+        pthread_create(&threads[i], NULL, TickMany, &runs[i]);
+    }
+
+    vector<uint64_t> all;
+    for (int i = 0; i < 4; i++)
+    {
+        pthread_join(threads[i], NULL);
+        // Each thread sees its own timestamps increase.
+        EXPECT_TRUE(std::is_sorted(runs[i].issued.begin(), runs[i].issued.end()));
+        all.insert(all.end(), runs[i].issued.begin(), runs[i].issued.end());
+    }
+
+    // Together, the threads were issued exactly 1..40000.
+    std::sort(all.begin(), all.end());
+    for (size_t i = 0; i < all.size(); i++) EXPECT_EQ((i + 1), all[i]);
+    EXPECT_EQ(40000, clock.Now());
+
+    END;
+}
+
+int main(int argc, char** argv)
+{
+    LogicalClock_Monotonic();
+    LogicalClock_UniqueAcrossThreads();
+}
@@ -3,6 +3,15 @@
 #define _DB_UTILS_MUTEX_H_
 
 #include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <atomic>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 /// @class Mutex
 ///
@@ -29,6 +38,29 @@ class Mutex
     pthread_mutex_t mutex_;
 };
 
+/// @class Condition
+///
+/// A condition variable, actually a thin wrapper around pthread's condition
+/// variable implementation.
+class Condition
+{
+   public:
+    Condition() { pthread_cond_init(&cond_, NULL); }
+    ~Condition() { pthread_cond_destroy(&cond_); }
+    /// Atomically unlocks 'mutex' and blocks until signalled, then relocks
+    /// 'mutex' before returning. May return spuriously, so callers re-check
+    /// their condition in a loop.
+    ///
+    /// Requires: 'mutex' is held by the caller.
+    inline void Wait(Mutex* mutex) { pthread_cond_wait(&cond_, &mutex->mutex_); }
+    /// Wakes at least one waiting thread, if any.
+    inline void Signal() { pthread_cond_signal(&cond_); }
+    /// Wakes all waiting threads.
+    inline void Broadcast() { pthread_cond_broadcast(&cond_); }
+   private:
+    pthread_cond_t cond_;
+};
+
 /// @class MutexRW
 ///
 /// A single-writer multiple-reader mutex, actually a thin wrapper around
@@ -57,4 +89,140 @@ class MutexRW
     pthread_rwlock_t rwlock_;
 };
 
+/// @class SpinLatch
+///
+/// A one-byte test-and-test-and-set spinlock for critical sections of a few
+/// dozen instructions, such as latching one bucket of a hash table. Yields the
+/// CPU after a short burst of spinning so that it degrades gracefully when
+/// there are more threads than cores.
+class SpinLatch
+{
+   public:
+    /// Latches come into the world unlocked.
+    SpinLatch() : locked_(false) {}
+    /// Spins (then yields) until the latch has been acquired.
+    inline void Lock()
+    {
+        while (locked_.exchange(true, std::memory_order_acquire))
+        {
+            for (int i = 0; locked_.load(std::memory_order_relaxed); i++)
+            {
+                if (i < kSpinsBeforeYield)
+                {
+#if defined(__x86_64__) || defined(__i386__)
+                    __builtin_ia32_pause();
+#endif
+                }
+                else
+                {
+                    sched_yield();
+                }
+            }
+        }
+    }
+    /// Acquires the latch and returns true if it is free, else returns false.
+    inline bool TryLock() { return !locked_.exchange(true, std::memory_order_acquire); }
+    /// Releases the latch.
+    ///
+    /// Requires: The latch is held by the caller.
+    inline void Unlock() { locked_.store(false, std::memory_order_release); }
+   private:
+    static const int kSpinsBeforeYield = 64;
+
+    std::atomic<bool> locked_;
+};
+
+/// @class EventCount
+///
+/// Lets idle threads park until another thread signals that there may be new
+/// work, without the signaller ever taking a lock when nobody is parked.
+///
+/// Usage by a waiter:
+///
+///   uint32_t key = ec.PrepareWait();
+///   if (<work became available>) ec.CancelWait(); else ec.Wait(key);
+///
+/// and by a signaller, after publishing work: ec.NotifyOne().
+///
+/// On Linux, parked threads sleep on a futex; elsewhere they fall back to a
+/// pthread condition variable.
+class EventCount
+{
+   public:
+    EventCount() : epoch_(0), waiters_(0)
+    {
+        pthread_mutex_init(&mutex_, NULL);
+        pthread_cond_init(&cond_, NULL);
+    }
+    ~EventCount()
+    {
+        pthread_cond_destroy(&cond_);
+        pthread_mutex_destroy(&mutex_);
+    }
+
+    /// Announces that the caller is about to wait. The caller must re-check its
+    /// wait condition after this call, then call either Wait or CancelWait.
+    inline uint32_t PrepareWait()
+    {
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        return epoch_.load(std::memory_order_seq_cst);
+    }
+
+    /// Withdraws a PrepareWait() whose wait condition turned out to be false.
+    inline void CancelWait() { waiters_.fetch_sub(1, std::memory_order_relaxed); }
+    /// Blocks until some Notify call has happened since PrepareWait() returned
+    /// 'key'.
+    void Wait(uint32_t key)
+    {
+#ifdef __linux__
+        while (epoch_.load(std::memory_order_acquire) == key)
+        {
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAIT_PRIVATE, key, NULL, NULL, 0);
+        }
+#else
+        pthread_mutex_lock(&mutex_);
+        while (epoch_.load(std::memory_order_acquire) == key) pthread_cond_wait(&cond_, &mutex_);
+        pthread_mutex_unlock(&mutex_);
+#endif
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /// Wakes one parked thread, if any. Returns true if a thread may have been
+    /// woken.
+    inline bool NotifyOne() { return Notify(1); }
+    /// Wakes all parked threads.
+    inline bool NotifyAll() { return Notify(INT32_MAX); }
+   private:
+    bool Notify(int count)
+    {
+        // Pairs with the seq_cst increment in PrepareWait: either the waiter
+        // sees the newly published work, or we see the waiter.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_seq_cst) == 0) return false;
+#ifdef __linux__
+        epoch_.fetch_add(1, std::memory_order_seq_cst);
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+#else
+        pthread_mutex_lock(&mutex_);
+        epoch_.fetch_add(1, std::memory_order_seq_cst);
+        if (count == 1)
+            pthread_cond_signal(&cond_);
+        else
+            pthread_cond_broadcast(&cond_);
+        pthread_mutex_unlock(&mutex_);
+#endif
+        return true;
+    }
+
+    // Bumped by every Notify; waiters sleep until it moves.
+    std::atomic<uint32_t> epoch_;
+
+    // Number of threads between PrepareWait and Wait/CancelWait.
+    std::atomic<int> waiters_;
+
+    // Only used where futexes are unavailable.
+    pthread_mutex_t mutex_;
+    pthread_cond_t cond_;
+};
+
 #endif  // _DB_UTILS_MUTEX_H_
@@ -0,0 +1,200 @@
+
+#ifndef _DB_UTILS_SLAB_H_
+#define _DB_UTILS_SLAB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+#include "utils/mutex.h"
+
+/// @class SlabAllocator
+///
+/// Size-class allocator for small, short-lived objects such as txns and their
+/// key sets.
+///
+/// Requests up to kMaxSize bytes are rounded up to a multiple of kGranularity
+/// and served from a per-thread free list for that size class, with no
+/// locking. A thread whose list runs dry takes a batch of blocks from a shared
+/// depot, which carves fresh kChunkSize chunks out of malloc() only when it is
+/// empty too. A thread whose list grows too long (e.g. one that frees objects
+/// allocated elsewhere) hands a batch back to the depot, and a thread's lists
+/// go back to the depot when it exits. Chunks are never returned to malloc().
+///
+/// Larger requests go straight to malloc().
+class SlabAllocator
+{
+   public:
+    static const size_t kGranularity = 16;
+    static const size_t kMaxSize     = 1024;
+    static const size_t kChunkSize   = 64 * 1024;
+
+    // Counts of calls into the system allocator.
+    struct Stats
+    {
+        uint64_t chunk_allocs;  // Chunks carved into size-class blocks.
+        uint64_t large_allocs;  // Requests too large for any size class.
+    };
+
+    /// Returns a block of at least 'size' bytes, aligned to kGranularity.
+    static void* Allocate(size_t size)
+    {
+        if (size > kMaxSize)
+        {
+            GetDepot()->large_allocs_.fetch_add(1, std::memory_order_relaxed);
+            return malloc(size);
+        }
+        ThreadCache* cache = GetThreadCache();
+        int c              = SizeClass(size);
+        if (cache->lists_[c] == NULL) Refill(cache, c);
+        Block* block      = cache->lists_[c];
+        cache->lists_[c] = block->next_;
+        cache->counts_[c]--;
+        return block;
+    }
+
+    /// Frees a block returned by Allocate(size) (with the same 'size'), on
+    /// any thread.
+    static void Free(void* p, size_t size)
+    {
+        if (p == NULL) return;
+        if (size > kMaxSize)
+        {
+            free(p);
+            return;
+        }
+        ThreadCache* cache = GetThreadCache();
+        int c              = SizeClass(size);
+        Block* block       = reinterpret_cast<Block*>(p);
+        block->next_       = cache->lists_[c];
+        cache->lists_[c]   = block;
+        if (++cache->counts_[c] > 2 * kBatch) Drain(cache, c, kBatch);
+    }
+
+    /// Returns the process-wide counts of system allocations.
+    static Stats GetStats()
+    {
+        Stats stats;
+        stats.chunk_allocs = GetDepot()->chunk_allocs_.load(std::memory_order_relaxed);
+        stats.large_allocs = GetDepot()->large_allocs_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+   private:
+    static const int kClasses = kMaxSize / kGranularity;
+
+    // Number of blocks moved between a thread and the depot at once.
+    static const uint32_t kBatch = 32;
+
+    struct Block
+    {
+        Block* next_;
+    };
+
+    struct Depot
+    {
+        Depot() : chunk_allocs_(0), large_allocs_(0)
+        {
+            for (int c = 0; c < kClasses; c++) lists_[c] = NULL;
+        }
+        SpinLatch latch_;
+        Block* lists_[kClasses];
+        std::atomic<uint64_t> chunk_allocs_;
+        std::atomic<uint64_t> large_allocs_;
+    };
+
+    struct ThreadCache
+    {
+        ThreadCache()
+        {
+            for (int c = 0; c < kClasses; c++)
+            {
+                lists_[c]  = NULL;
+                counts_[c] = 0;
+            }
+        }
+        // Returns everything to the depot when the thread exits.
+        ~ThreadCache()
+        {
+            for (int c = 0; c < kClasses; c++) Drain(this, c, 0);
+        }
+        Block* lists_[kClasses];
+        uint32_t counts_[kClasses];
+    };
+
+    static int SizeClass(size_t size) { return size == 0 ? 0 : (size - 1) / kGranularity; }
+
+    // The depot is never destroyed, so that threads exiting after static
+    // destructors have run can still return their blocks.
+    static Depot* GetDepot()
+    {
+        static Depot* depot = new (malloc(sizeof(Depot))) Depot();
+        return depot;
+    }
+
+    static ThreadCache* GetThreadCache()
+    {
+        static thread_local ThreadCache cache;
+        return &cache;
+    }
+
+    // Moves up to kBatch blocks of class 'c' from the depot into 'cache',
+    // first carving a new chunk for the depot if it has none.
+    static void Refill(ThreadCache* cache, int c)
+    {
+        Depot* depot = GetDepot();
+        depot->latch_.Lock();
+        if (depot->lists_[c] == NULL)
+        {
+            depot->chunk_allocs_.fetch_add(1, std::memory_order_relaxed);
+            size_t block_size = (c + 1) * kGranularity;
+            char* chunk       = reinterpret_cast<char*>(malloc(kChunkSize));
+            for (size_t offset = 0; offset + block_size <= kChunkSize; offset += block_size)
+            {
+                Block* block     = reinterpret_cast<Block*>(chunk + offset);
+                block->next_     = depot->lists_[c];
+                depot->lists_[c] = block;
+            }
+        }
+        for (uint32_t i = 0; i < kBatch && depot->lists_[c] != NULL; i++)
+        {
+            Block* block     = depot->lists_[c];
+            depot->lists_[c] = block->next_;
+            block->next_     = cache->lists_[c];
+            cache->lists_[c] = block;
+            cache->counts_[c]++;
+        }
+        depot->latch_.Unlock();
+    }
+
+    // Moves all but the 'keep' most recently freed blocks of class 'c' from
+    // 'cache' to the depot.
+    static void Drain(ThreadCache* cache, int c, uint32_t keep)
+    {
+        if (cache->counts_[c] <= keep) return;
+        Block* first = cache->lists_[c];
+        Block* last  = NULL;
+        for (uint32_t i = 0; i < keep; i++)
+        {
+            last  = first;
+            first = first->next_;
+        }
+        Block* tail = first;
+        while (tail->next_ != NULL) tail = tail->next_;
+        if (last == NULL)
+            cache->lists_[c] = NULL;
+        else
+            last->next_ = NULL;
+        cache->counts_[c] = keep;
+
+        Depot* depot = GetDepot();
+        depot->latch_.Lock();
+        tail->next_      = depot->lists_[c];
+        depot->lists_[c] = first;
+        depot->latch_.Unlock();
+    }
+};
+
+#endif  // _DB_UTILS_SLAB_H_
@@ -0,0 +1,216 @@
+
+#ifndef _DB_UTILS_SORTED_VECTOR_H_
+#define _DB_UTILS_SORTED_VECTOR_H_
+
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+
+#include "utils/slab.h"
+
+/// @class SortedVectorSet
+///
+/// Set of trivially copyable, ordered values kept sorted in one contiguous
+/// array allocated from the SlabAllocator.
+///
+/// Meant for the small sets carried by every txn (a handful to a few dozen
+/// keys): lookups are a binary search, and iteration walks one buffer rather
+/// than a tree of separately allocated nodes. Insertion is O(size), but is
+/// O(1) when values arrive in ascending order.
+template <typename T>
+class SortedVectorSet
+{
+   public:
+    typedef T value_type;
+    typedef const T* iterator;
+    typedef const T* const_iterator;
+
+    SortedVectorSet() : data_(NULL), size_(0), capacity_(0) {}
+    SortedVectorSet(const SortedVectorSet& other) : data_(NULL), size_(0), capacity_(0) { *this = other; }
+    ~SortedVectorSet() { SlabAllocator::Free(data_, capacity_ * sizeof(T)); }
+
+    SortedVectorSet& operator=(const SortedVectorSet& other)
+    {
+        if (this == &other) return *this;
+        size_ = 0;
+        reserve(other.size_);
+        if (other.size_ > 0) memcpy(data_, other.data_, other.size_ * sizeof(T));
+        size_ = other.size_;
+        return *this;
+    }
+
+    /// Replaces the contents with the values in [first, last).
+    template <typename InputIterator>
+    void assign(InputIterator first, InputIterator last)
+    {
+        size_ = 0;
+        insert(first, last);
+    }
+
+    /// Inserts 'value'. Returns false if it was already present.
+    bool insert(const T& value)
+    {
+        T* pos = std::lower_bound(data_, data_ + size_, value);
+        if (pos != data_ + size_ && !(value < *pos)) return false;
+        size_t index = pos - data_;
+        if (size_ == capacity_) Grow(size_ + 1);
+        memmove(data_ + index + 1, data_ + index, (size_ - index) * sizeof(T));
+        data_[index] = value;
+        size_++;
+        return true;
+    }
+
+    /// Inserts every value in [first, last).
+    template <typename InputIterator>
+    void insert(InputIterator first, InputIterator last)
+    {
+        for (; first != last; ++first) insert(*first);
+    }
+
+    size_t count(const T& value) const
+    {
+        return std::binary_search(data_, data_ + size_, value) ? 1 : 0;
+    }
+
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_ + size_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    void clear() { size_ = 0; }
+
+    /// Makes room for 'n' values without further allocation.
+    void reserve(size_t n)
+    {
+        if (n > capacity_) Grow(n);
+    }
+
+   private:
+    static const size_t kMinCapacity = 8;
+
+    // Reallocates to hold at least 'n' values, doubling the capacity.
+    void Grow(size_t n)
+    {
+        size_t capacity = capacity_ == 0 ? kMinCapacity : 2 * capacity_;
+        while (capacity < n) capacity *= 2;
+        T* data = static_cast<T*>(SlabAllocator::Allocate(capacity * sizeof(T)));
+        if (size_ > 0) memcpy(data, data_, size_ * sizeof(T));
+        SlabAllocator::Free(data_, capacity_ * sizeof(T));
+        data_     = data;
+        capacity_ = capacity;
+    }
+
+    T* data_;
+    size_t size_;
+    size_t capacity_;
+};
+
+/// @class SortedVectorMap
+///
+/// Map counterpart of SortedVectorSet: (key, value) entries of trivially
+/// copyable types, kept sorted by key in one slab-allocated array. Entries
+/// expose 'first' and 'second' like std::map's. Inserting may move existing
+/// entries, so iterators and references are invalidated by operator[] on a
+/// key that is not yet present.
+template <typename K, typename V>
+class SortedVectorMap
+{
+   public:
+    struct Entry
+    {
+        K first;
+        V second;
+    };
+
+    typedef Entry value_type;
+    typedef Entry* iterator;
+    typedef const Entry* const_iterator;
+
+    SortedVectorMap() : data_(NULL), size_(0), capacity_(0) {}
+    SortedVectorMap(const SortedVectorMap& other) : data_(NULL), size_(0), capacity_(0) { *this = other; }
+    ~SortedVectorMap() { SlabAllocator::Free(data_, capacity_ * sizeof(Entry)); }
+
+    SortedVectorMap& operator=(const SortedVectorMap& other)
+    {
+        if (this == &other) return *this;
+        size_ = 0;
+        reserve(other.size_);
+        if (other.size_ > 0) memcpy(data_, other.data_, other.size_ * sizeof(Entry));
+        size_ = other.size_;
+        return *this;
+    }
+
+    /// Returns the value stored under 'key', inserting a value-initialized
+    /// one first if there is none.
+    V& operator[](const K& key)
+    {
+        Entry* pos = LowerBound(key);
+        if (pos != data_ + size_ && !(key < pos->first)) return pos->second;
+        size_t index = pos - data_;
+        if (size_ == capacity_) Grow(size_ + 1);
+        memmove(data_ + index + 1, data_ + index, (size_ - index) * sizeof(Entry));
+        data_[index].first  = key;
+        data_[index].second = V();
+        size_++;
+        return data_[index].second;
+    }
+
+    iterator find(const K& key)
+    {
+        Entry* pos = LowerBound(key);
+        return (pos != data_ + size_ && !(key < pos->first)) ? pos : end();
+    }
+
+    const_iterator find(const K& key) const { return const_cast<SortedVectorMap*>(this)->find(key); }
+
+    size_t count(const K& key) const { return find(key) == end() ? 0 : 1; }
+
+    iterator begin() { return data_; }
+    iterator end() { return data_ + size_; }
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_ + size_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    void clear() { size_ = 0; }
+
+    /// Makes room for 'n' entries without further allocation.
+    void reserve(size_t n)
+    {
+        if (n > capacity_) Grow(n);
+    }
+
+   private:
+    static const size_t kMinCapacity = 8;
+
+    Entry* LowerBound(const K& key)
+    {
+        size_t lo = 0;
+        size_t hi = size_;
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            if (data_[mid].first < key)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return data_ + lo;
+    }
+
+    // Reallocates to hold at least 'n' entries, doubling the capacity.
+    void Grow(size_t n)
+    {
+        size_t capacity = capacity_ == 0 ? kMinCapacity : 2 * capacity_;
+        while (capacity < n) capacity *= 2;
+        Entry* data = static_cast<Entry*>(SlabAllocator::Allocate(capacity * sizeof(Entry)));
+        if (size_ > 0) memcpy(data, data_, size_ * sizeof(Entry));
+        SlabAllocator::Free(data_, capacity_ * sizeof(Entry));
+        data_     = data;
+        capacity_ = capacity;
+    }
+
+    Entry* data_;
+    size_t size_;
+    size_t capacity_;
+};
+
+#endif  // _DB_UTILS_SORTED_VECTOR_H_
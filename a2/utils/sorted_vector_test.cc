@@ -0,0 +1,73 @@
+#include "utils/sorted_vector.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <map>
+#include <set>
+
+#include "utils/testing.h"
+
+TEST(SortedVectorSet_MatchesStdSet)
+{
+    SortedVectorSet<uint64_t> set;
+    std::set<uint64_t> expected;
+    for (int i = 0; i < 1000; i++)
+    {
+        uint64_t x = rand() % 300;
+        EXPECT_EQ(expected.insert(x).second, set.insert(x));
+    }
+    EXPECT_EQ(expected.size(), set.size());
+
+    std::set<uint64_t>::iterator it = expected.begin();
+    for (SortedVectorSet<uint64_t>::iterator jt = set.begin(); jt != set.end(); ++jt, ++it) EXPECT_EQ(*it, *jt);
+    for (uint64_t x = 0; x < 300; x++) EXPECT_EQ(expected.count(x), set.count(x));
+
+    SortedVectorSet<uint64_t> copy(set);
+    set.clear();
+    EXPECT_TRUE(set.empty());
+    EXPECT_EQ(expected.size(), copy.size());
+
+    copy.assign(expected.begin(), expected.end());
+    EXPECT_EQ(expected.size(), copy.size());
+
+    END;
+}
+
+TEST(SortedVectorMap_MatchesStdMap)
+{
+    SortedVectorMap<uint64_t, uint64_t> map;
+    std::map<uint64_t, uint64_t> expected;
+    for (int i = 0; i < 1000; i++)
+    {
+        uint64_t k = rand() % 300;
+        map[k] += i;
+        expected[k] += i;
+    }
+    EXPECT_EQ(expected.size(), map.size());
+
+    std::map<uint64_t, uint64_t>::iterator it = expected.begin();
+    for (SortedVectorMap<uint64_t, uint64_t>::iterator jt = map.begin(); jt != map.end(); ++jt, ++it)
+    {
+        EXPECT_EQ(it->first, jt->first);
+        EXPECT_EQ(it->second, jt->second);
+    }
+    for (uint64_t k = 0; k < 300; k++)
+    {
+        EXPECT_EQ(expected.count(k), map.count(k));
+        if (expected.count(k)) EXPECT_EQ(expected[k], map.find(k)->second);
+    }
+
+    SortedVectorMap<uint64_t, uint64_t> copy;
+    copy = map;
+    map.clear();
+    EXPECT_TRUE((map.find(0) == map.end()));
+    EXPECT_EQ(expected.size(), copy.size());
+
+    END;
+}
+
+int main(int argc, char** argv)
+{
+    SortedVectorSet_MatchesStdSet();
+    SortedVectorMap_MatchesStdMap();
+}
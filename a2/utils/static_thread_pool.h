@@ -1,7 +1,7 @@
-
 #ifndef _DB_UTILS_STATIC_THREAD_POOL_H_
 #define _DB_UTILS_STATIC_THREAD_POOL_H_
 
+#include <atomic>
 #include <queue>
 #include <string>
 #include <utility>
@@ -10,6 +10,9 @@
 #include "pthread.h"
 #include "stdlib.h"
 #include "utils/atomic.h"
+#include "utils/cpu_topology.h"
+#include "utils/mutex.h"
+#include "utils/slab.h"
 #include "utils/thread_pool.h"
 
 using std::queue;
@@ -17,179 +20,186 @@ using std::string;
 using std::vector;
 using std::pair;
 
-//
+/// @class StaticThreadPool
+///
+/// Fixed-size work-stealing thread pool.
+///
+/// Each worker owns a Chase-Lev deque. Tasks submitted from outside the pool
+/// (e.g. by the TxnProcessor scheduler thread) go through one lock-free global
+/// queue; an idle worker moves a small batch of them into its own deque, where
+/// siblings can steal them. Tasks submitted from inside a task go straight to
+/// the running worker's deque. A worker that finds no work anywhere parks on
+/// an EventCount instead of sleeping for a fixed interval, and is woken as
+/// soon as new work is submitted.
+///
+/// Workers may be pinned according to a CpuPlacement. Each worker allocates
+/// its own deque after it has been pinned, so on NUMA machines the deque is
+/// first-touched on the worker's node.
 class StaticThreadPool : public ThreadPool
 {
    public:
-    StaticThreadPool(int nthreads) : thread_count_(nthreads), stopped_(false) { Start(); }
+    // Per-pool execution counters, aggregated over all workers.
+    struct Stats
+    {
+        uint64_t executed;  // Tasks run.
+        uint64_t steals;    // Tasks taken from a sibling's deque.
+        uint64_t parks;     // Times a worker went to sleep for lack of work.
+        uint64_t wakeups;   // Times a parked worker was woken up.
+    };
+
+    // Starts 'nthreads' workers, pinned as described by 'placement' (or left
+    // unpinned if 'placement' is NULL).
+    explicit StaticThreadPool(int nthreads, const CpuPlacement* placement = NULL)
+        : thread_count_(nthreads), global_(kGlobalQueueCapacity), started_(0), stopped_(false)
+    {
+        Start(placement);
+    }
     ~StaticThreadPool()
     {
         stopped_ = true;
+        idle_.NotifyAll();
         for (int i = 0; i < thread_count_; i++) pthread_join(threads_[i], NULL);
+        for (int i = 0; i < thread_count_; i++) delete workers_[i];
     }
 
     bool Active() { return !stopped_; }
-    virtual void AddTask(Task&& task)
+    virtual void AddTask(Task&& task) { Submit(new (SlabAllocator::Allocate(sizeof(Task))) Task(std::forward<Task>(task))); }
+    virtual void AddTask(const Task& task) { Submit(new (SlabAllocator::Allocate(sizeof(Task))) Task(task)); }
+    virtual int ThreadCount() { return thread_count_; }
+    // Returns the sum of all workers' counters.
+    Stats GetStats()
     {
-        assert(!stopped_);
-        while (!queues_[rand() % thread_count_].PushNonBlocking(std::forward<Task>(task)))
+        Stats stats = {0, 0, 0, 0};
+        for (int i = 0; i < thread_count_; i++)
         {
+            stats.executed += workers_[i]->executed_.load(std::memory_order_relaxed);
+            stats.steals += workers_[i]->steals_.load(std::memory_order_relaxed);
+            stats.parks += workers_[i]->parks_.load(std::memory_order_relaxed);
+            stats.wakeups += workers_[i]->wakeups_.load(std::memory_order_relaxed);
         }
+        return stats;
+    }
+
+   private:
+    // Maximum number of tasks waiting in the global submission queue.
+    static const size_t kGlobalQueueCapacity = 65536;
+
+    // Maximum number of tasks held in one worker's deque.
+    static const size_t kDequeCapacity = 1024;
+
+    // Number of tasks an idle worker moves from the global queue into its own
+    // deque at once (besides the one it runs immediately).
+    static const int kGlobalBatch = 4;
+
+    // Number of times an idle worker re-scans for work before parking.
+    static const int kSpinRounds = 64;
+
+    // State owned by one worker thread. Counters are only written by the owner.
+    struct Worker
+    {
+        Worker() : deque_(kDequeCapacity), executed_(0), steals_(0), parks_(0), wakeups_(0) {}
+        WorkStealingDeque<Task*> deque_;
+        std::atomic<uint64_t> executed_;
+        std::atomic<uint64_t> steals_;
+        std::atomic<uint64_t> parks_;
+        std::atomic<uint64_t> wakeups_;
+        uint32_t rand_state_;
+        char pad_[CACHE_LINE_SIZE];
+    };
+
+    // Identifies the pool and worker index of the calling thread, if it is a
+    // pool worker.
+    static StaticThreadPool*& CurrentPool()
+    {
+        static thread_local StaticThreadPool* pool = NULL;
+        return pool;
+    }
+    static int& CurrentWorker()
+    {
+        static thread_local int index = -1;
+        return index;
     }
 
-    virtual void AddTask(const Task& task)
+    void Submit(Task* task)
     {
         assert(!stopped_);
-        while (!queues_[rand() % thread_count_].PushNonBlocking(task))
+        // Tasks spawned by one of our own workers stay local; everything else
+        // (in particular the scheduler thread) takes the global fast path.
+        if (CurrentPool() != this || !workers_[CurrentWorker()]->deque_.Push(task))
         {
+            global_.Push(task);
         }
+        idle_.NotifyOne();
     }
 
-    virtual int ThreadCount() { return thread_count_; }
-   private:
-    void Start()
+    void Start(const CpuPlacement* placement)
     {
         threads_.resize(thread_count_);
-        queues_.resize(thread_count_);
-
-        pthread_attr_t attr;
-        pthread_attr_init(&attr);
-
-        #if !defined(_MSC_VER) && !defined(__APPLE__)
-        // Pin all threads in the thread pool to CPU Core 0 ~ 6
-        cpu_set_t cpuset;
-        CPU_ZERO(&cpuset);
-        for (int i = 0; i < 7; i++)
-        {
-            CPU_SET(i, &cpuset);
-        }
-
-        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
-        #endif
+        workers_.assign(thread_count_, NULL);
 
         for (int i = 0; i < thread_count_; i++)
         {
+            pthread_attr_t attr;
+            pthread_attr_init(&attr);
+            if (placement != NULL) SetThreadAffinity(&attr, placement->worker_cpus_[i]);
             pthread_create(&threads_[i], &attr, RunThread,
                            reinterpret_cast<void*>(new pair<int, StaticThreadPool*>(i, this)));
+            pthread_attr_destroy(&attr);
         }
+
+        // Wait until every worker has allocated its deque, so that AddTask may
+        // steal-scan all of them.
+        while (started_.load(std::memory_order_acquire) < thread_count_) sched_yield();
     }
 
-    // Function executed by each pthread.
-    static void* RunThread(void* arg)
+    // Finds a task for worker 'id': its own deque first, then a batch from the
+    // global queue, then a steal from a randomly chosen sibling.
+    bool FindTask(int id, Task** task)
     {
-        int queue_id         = reinterpret_cast<pair<int, StaticThreadPool*>*>(arg)->first;
-        StaticThreadPool* tp = reinterpret_cast<pair<int, StaticThreadPool*>*>(arg)->second;
+        Worker* self = workers_[id];
+        if (self->deque_.Pop(task)) return true;
 
-        Task task;
-        int sleep_duration = 1;  // in microseconds
-        while (true)
+        if (global_.Pop(task))
         {
-            if (tp->queues_[queue_id].PopNonBlocking(&task))
-            {
-                task();
-                // Reset backoff.
-                sleep_duration = 1;
-            }
-            else
-            {
-                usleep(sleep_duration);
-                // Back off exponentially.
-                if (sleep_duration < 32) sleep_duration *= 2;
-            }
-
-            if (tp->stopped_)
+            Task* extra;
+            for (int i = 0; i < kGlobalBatch && global_.Pop(&extra); i++)
             {
-                // Go through ALL queues looking for a remaining task.
-                while (tp->queues_[queue_id].Pop(&task))
+                if (!self->deque_.Push(extra))
                 {
-                    task();
+                    global_.Push(extra);
+                    break;
                 }
-
-                break;
             }
+            return true;
         }
-        return NULL;
-    }
-
-    int thread_count_;
-    vector<pthread_t> threads_;
-
-    // Task queues.
-    vector<AtomicQueue<Task>> queues_;
-
-    bool stopped_;
-};
-
-#endif  // _DB_UTILS_STATIC_THREAD_POOL_H_
-/// @file
-/// @author Alexander Thomson <thomson@cs.yale.edu>
-// Modified by: Kun Ren (kun.ren@yale.edu)
-
-#ifndef _DB_UTILS_STATIC_THREAD_POOL_H_
-#define _DB_UTILS_STATIC_THREAD_POOL_H_
-
-#include <queue>
-#include <string>
-#include <utility>
-#include <vector>
-#include "assert.h"
-#include "pthread.h"
-#include "stdlib.h"
-#include "utils/atomic.h"
-#include "utils/thread_pool.h"
-
-using std::queue;
-using std::string;
-using std::vector;
-using std::pair;
-
-//
-class StaticThreadPool : public ThreadPool
-{
-   public:
-    StaticThreadPool(int nthreads) : thread_count_(nthreads), stopped_(false) { Start(); }
-    ~StaticThreadPool()
-    {
-        stopped_ = true;
-        for (int i = 0; i < thread_count_; i++) pthread_join(threads_[i], NULL);
-    }
 
-    bool Active() { return !stopped_; }
-    virtual void RunTask(Task* task)
-    {
-        assert(!stopped_);
-        while (!queues_[rand() % thread_count_].PushNonBlocking(task))
+        // xorshift32 picks the first victim; then walk all siblings.
+        uint32_t x = self->rand_state_;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        self->rand_state_ = x;
+        for (int i = 0; i < thread_count_; i++)
         {
+            int victim = (x + i) % thread_count_;
+            if (victim != id && workers_[victim]->deque_.Steal(task))
+            {
+                self->steals_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
         }
+        return false;
     }
 
-    virtual int ThreadCount() { return thread_count_; }
-   private:
-    void Start()
+    // Returns true if any queue in the pool appears to hold a task.
+    bool HasWork()
     {
-        threads_.resize(thread_count_);
-        queues_.resize(thread_count_);
-
-        pthread_attr_t attr;
-        pthread_attr_init(&attr);
-
-        #if !defined(_MSC_VER) && !defined(__APPLE__)
-        // Pin all threads in the thread pool to CPU Core 0 ~ 6
-        cpu_set_t cpuset;
-        CPU_ZERO(&cpuset);
-        for (int i = 0; i < 19; i++)
-        {
-            CPU_SET(i, &cpuset);
-        }
-
-        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
-        #endif
-
+        if (global_.Size() > 0) return true;
         for (int i = 0; i < thread_count_; i++)
         {
-            pthread_create(&threads_[i], &attr, RunThread,
-                           reinterpret_cast<void*>(new pair<int, StaticThreadPool*>(i, this)));
+            if (workers_[i]->deque_.Size() > 0) return true;
         }
+        return false;
     }
 
     // Function executed by each pthread.
@@ -197,36 +207,59 @@ class StaticThreadPool : public ThreadPool
     {
         int queue_id         = reinterpret_cast<pair<int, StaticThreadPool*>*>(arg)->first;
         StaticThreadPool* tp = reinterpret_cast<pair<int, StaticThreadPool*>*>(arg)->second;
+        delete reinterpret_cast<pair<int, StaticThreadPool*>*>(arg);
+
+        // Allocate this worker's state from the (already pinned) worker thread
+        // itself so that its pages are local to the worker's NUMA node.
+        Worker* self      = new Worker();
+        self->rand_state_ = 2654435761u * (queue_id + 1);
+        tp->workers_[queue_id] = self;
+        tp->started_.fetch_add(1, std::memory_order_release);
+        while (tp->started_.load(std::memory_order_acquire) < tp->thread_count_) sched_yield();
+
+        CurrentPool()   = tp;
+        CurrentWorker() = queue_id;
 
         Task* task;
-        int sleep_duration = 1;  // in microseconds
+        int idle_rounds = 0;
         while (true)
         {
-            if (tp->queues_[queue_id].PopNonBlocking(&task))
+            if (tp->FindTask(queue_id, &task))
             {
-                task->Run();
-                delete task;
-                // Reset backoff.
-                sleep_duration = 1;
+                (*task)();
+                task->~Task();
+                SlabAllocator::Free(task, sizeof(Task));
+                self->executed_.fetch_add(1, std::memory_order_relaxed);
+                idle_rounds = 0;
+                continue;
             }
-            else
+
+            if (tp->stopped_)
             {
-                usleep(sleep_duration);
-                // Back off exponentially.
-                if (sleep_duration < 32) sleep_duration *= 2;
+                // Everything has been drained (FindTask just came up empty and
+                // no new tasks may be submitted once stopped).
+                break;
             }
 
-            if (tp->stopped_)
+            if (++idle_rounds < kSpinRounds)
             {
-                // Go through ALL queues looking for a remaining task.
-                while (tp->queues_[queue_id].Pop(&task))
-                {
-                    task->Run();
-                    delete task;
-                }
+                sched_yield();
+                continue;
+            }
 
-                break;
+            // Park until new work is submitted (or the pool is stopped).
+            uint32_t key = tp->idle_.PrepareWait();
+            if (tp->HasWork() || tp->stopped_)
+            {
+                tp->idle_.CancelWait();
+            }
+            else
+            {
+                self->parks_.fetch_add(1, std::memory_order_relaxed);
+                tp->idle_.Wait(key);
+                self->wakeups_.fetch_add(1, std::memory_order_relaxed);
             }
+            idle_rounds = 0;
         }
         return NULL;
     }
@@ -234,10 +267,19 @@ class StaticThreadPool : public ThreadPool
     int thread_count_;
     vector<pthread_t> threads_;
 
-    // Task queues.
-    vector<AtomicQueue<Task*>> queues_;
+    // Per-worker deques and counters.
+    vector<Worker*> workers_;
+
+    // Submission queue for tasks added from outside the pool.
+    MPMCQueue<Task*> global_;
+
+    // Parking lot for idle workers.
+    EventCount idle_;
+
+    // Number of workers that have allocated their state.
+    std::atomic<int> started_;
 
-    bool stopped_;
+    std::atomic<bool> stopped_;
 };
 
 #endif  // _DB_UTILS_STATIC_THREAD_POOL_H_
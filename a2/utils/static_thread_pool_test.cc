@@ -0,0 +1,95 @@
+#include "utils/static_thread_pool.h"
+
+#include <sys/time.h>
+
+#include "utils/testing.h"
+
+// Returns the current wall-clock time in seconds.
+static double Now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// Busy-waits for roughly 'seconds'.
+static void Spin(double seconds)
+{
+    double begin = Now();
+    while (Now() - begin < seconds)
+    {
+    }
+}
+
+TEST(WorkStealingDeque_OwnerAndThief)
+{
+    WorkStealingDeque<int*> d(4);
+    int items[5];
+    int* x;
+
+    EXPECT_FALSE(d.Pop(&x));
+    EXPECT_FALSE(d.Steal(&x));
+    for (int i = 0; i < 4; i++) EXPECT_TRUE(d.Push(&items[i]));
+    EXPECT_FALSE(d.Push(&items[4]));  // Full.
+
+    // Owner pops LIFO, thieves steal FIFO.
+    EXPECT_TRUE(d.Pop(&x));
+    EXPECT_EQ(&items[3], x);
+    EXPECT_TRUE(d.Steal(&x));
+    EXPECT_EQ(&items[0], x);
+    EXPECT_EQ(2, d.Size());
+
+    END;
+}
+
+TEST(StaticThreadPool_RunsEveryTask)
+{
+    std::atomic<int> count(0);
+    {
+        StaticThreadPool tp(4);
+        for (int i = 0; i < 10000; i++) tp.AddTask([&count]() { count++; });
+        // Nested submission lands on the worker's own deque.
+        for (int i = 0; i < 100; i++)
+        {
+            tp.AddTask([&tp, &count]() {
+                for (int j = 0; j < 10; j++) tp.AddTask([&count]() { count++; });
+            });
+        }
+        while (tp.GetStats().executed < 11100) usleep(100);
+        EXPECT_EQ(11000, count.load());
+    }
+
+    END;
+}
+
+// Mimics RMW txns whose busy-loop durations vary widely: one in eight tasks
+// is 100x longer than the rest.
+void SkewedBenchmark()
+{
+    const int kTasks = 4000;
+    std::atomic<int> done(0);
+
+    StaticThreadPool tp(8);
+    double start = Now();
+    for (int i = 0; i < kTasks; i++)
+    {
+        double duration = (i % 8 == 0) ? 0.001 : 0.00001;
+        tp.AddTask([&done, duration]() {
+            Spin(duration);
+            done++;
+        });
+    }
+    while (done.load() < kTasks) usleep(100);
+    double end = Now();
+
+    StaticThreadPool::Stats stats = tp.GetStats();
+    cout << "\t\tSkewed tasks: " << kTasks / (end - start) << " tasks/s, " << stats.steals << " steals, "
+         << stats.parks << " parks, " << stats.wakeups << " wakeups" << endl;
+}
+
+int main(int argc, char** argv)
+{
+    WorkStealingDeque_OwnerAndThief();
+    StaticThreadPool_RunsEveryTask();
+    SkewedBenchmark();
+}